@@ -0,0 +1,183 @@
+#include "BatchDetectionTool.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include "../../OpenCVRuntimeComponent/OpenCVRuntimeComponent/BatchDetector.h"
+#include "../../OpenCVRuntimeComponent/OpenCVRuntimeComponent/IntrinsicCalibration.h"
+
+using namespace OpenCVRuntimeComponent::ArUcoTracking;
+
+namespace
+{
+	struct BatchOptions
+	{
+		std::string input;
+		std::string outputPath = "batch.bin";
+		std::string intrinsicsPath;
+		bool isEstimatingMarkers = false;
+		bool isTuning = false;
+		int blockSize = 256;
+		int runLength = 32;
+		int numThreads = 0; // OpenCV default if not positive
+	};
+
+	void PrintUsage()
+	{
+		std::cout << "Usage: CustomArUcoBoards --batch-detect <video file | image sequence pattern> "
+			"[--output <file>] [--intrinsics <file>] [--marker-poses] "
+			"[--tune] [--block <n>] [--run <n>] [--threads <n>]" << std::endl;
+	}
+
+	bool ParseBatchOptions(
+		int argc,
+		char** argv,
+		BatchOptions& options)
+	{
+		if (argc < 3)
+		{
+			return false;
+		}
+
+		options.input = argv[2];
+
+		for (int i = 3; i < argc; i++)
+		{
+			const std::string arg = argv[i];
+			const bool hasValue = i + 1 < argc;
+
+			if (arg == "--output" && hasValue)
+			{
+				options.outputPath = argv[++i];
+			}
+			else if (arg == "--intrinsics" && hasValue)
+			{
+				options.intrinsicsPath = argv[++i];
+			}
+			else if (arg == "--marker-poses")
+			{
+				options.isEstimatingMarkers = true;
+			}
+			else if (arg == "--tune")
+			{
+				options.isTuning = true;
+			}
+			else if (arg == "--block" && hasValue)
+			{
+				options.blockSize = std::atoi(argv[++i]);
+			}
+			else if (arg == "--run" && hasValue)
+			{
+				options.runLength = std::atoi(argv[++i]);
+			}
+			else if (arg == "--threads" && hasValue)
+			{
+				options.numThreads = std::atoi(argv[++i]);
+			}
+			else
+			{
+				std::cout << "Unknown or incomplete argument: " + arg << std::endl;
+				return false;
+			}
+		}
+
+		return options.blockSize > 0 && options.runLength > 0;
+	}
+
+	// Counts the frames with a board, results go to the file
+	class CountingSink : public BatchResultSink
+	{
+	public:
+		explicit CountingSink(BatchResultSink& sink)
+			: numDetected(0),
+			_sink(sink)
+		{
+		}
+
+		void Write(
+			const std::vector<BatchFrameResult>& frames,
+			const std::vector<BatchMarkerResult>& markers) override
+		{
+			for (const auto& frame : frames)
+			{
+				numDetected += frame.boardDetected;
+			}
+			_sink.Write(frames, markers);
+		}
+
+		int64_t numDetected;
+
+	private:
+		BatchResultSink& _sink;
+	};
+}
+
+int RunBatchDetection(
+	int argc,
+	char** argv,
+	const cv::Ptr<cv::aruco::Board>& board,
+	const cv::Mat& cameraIntrinsics,
+	const cv::Mat& distortionCoeffs,
+	float markerLength)
+{
+	BatchOptions options;
+	if (!ParseBatchOptions(argc, argv, options))
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	if (options.numThreads > 0)
+	{
+		cv::setNumThreads(options.numThreads);
+	}
+
+	BatchDetectionSettings settings;
+	settings.board = board;
+	settings.cameraMatrix = cameraIntrinsics;
+	settings.distortionCoefficients = distortionCoeffs;
+	settings.markerLength = options.isEstimatingMarkers ? markerLength : 0.0f;
+	settings.tuneDetector = options.isTuning;
+	settings.blockSize = options.blockSize;
+	settings.runLength = options.runLength;
+
+	if (!options.intrinsicsPath.empty())
+	{
+		CameraIntrinsics intrinsics;
+		if (!ReadCameraIntrinsicsFile(options.intrinsicsPath, intrinsics))
+		{
+			std::cout << "Cannot read intrinsics from " + options.intrinsicsPath << std::endl;
+			return 1;
+		}
+		settings.cameraMatrix = intrinsics.cameraMatrix;
+		settings.distortionCoefficients = intrinsics.distortionCoefficients;
+	}
+
+	BatchResultFile file(options.outputPath);
+	if (!file.IsOpen())
+	{
+		std::cout << "Could not open " + options.outputPath << std::endl;
+		return 1;
+	}
+	CountingSink sink(file);
+
+	auto start = std::chrono::steady_clock::now();
+
+	BatchDetector detector(settings);
+	const int64_t numFrames = detector.ProcessCapture(options.input, sink);
+	if (numFrames < 0)
+	{
+		std::cout << "Could not open batch input " + options.input << std::endl;
+		return 1;
+	}
+
+	const double elapsedS = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	std::cout << "Detected " + std::to_string(numFrames) + " frames in " +
+		std::to_string(elapsedS) + " s (" +
+		std::to_string(elapsedS > 0.0 ? numFrames / elapsedS : 0.0) + " fps), board detected in " +
+		std::to_string(sink.numDetected) + " frames" << std::endl;
+
+	return 0;
+}
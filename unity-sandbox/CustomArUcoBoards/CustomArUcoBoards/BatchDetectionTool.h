@@ -0,0 +1,20 @@
+#pragma once
+
+#include <opencv2/aruco.hpp>
+#include <opencv2/core.hpp>
+
+// Offline board and marker detection of a recording with BatchDetector
+//	CustomArUcoBoards --batch-detect <video file | image sequence pattern>
+//		[--output <file>] [--intrinsics <file>] [--marker-poses]
+//		[--tune] [--block <n>] [--run <n>] [--threads <n>]
+// Results are written to the binary results file of BatchResultFile,
+// with the single marker poses if --marker-poses is given.
+// Unlike --replay there is no quality control, the results only depend
+// on the frames and the options. Returns the process exit code.
+int RunBatchDetection(
+	int argc,
+	char** argv,
+	const cv::Ptr<cv::aruco::Board>& board,
+	const cv::Mat& cameraIntrinsics,
+	const cv::Mat& distortionCoeffs,
+	float markerLength);
@@ -0,0 +1,118 @@
+#include "BoardCompiler.h"
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include "../../OpenCVRuntimeComponent/OpenCVRuntimeComponent/BoardLayout.h"
+
+using namespace OpenCVRuntimeComponent::ArUcoTracking;
+
+namespace
+{
+	void PrintUsage()
+	{
+		std::cout << "Usage: CustomArUcoBoards --compile-board <fiducial file> "
+			"[--binary <file>] [--header <file>] [--name <symbol>] "
+			"[--marker-length <m>] [--first-id <n>] "
+			"[--meters-per-unit <m>] [--no-mirror]" << std::endl;
+	}
+}
+
+int RunBoardCompiler(
+	int argc,
+	char** argv)
+{
+	if (argc < 3)
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	const std::string fiducialPath = argv[2];
+	std::string binaryPath;
+	std::string headerPath;
+	std::string symbol;
+	float markerLength = 0.04f; // 40 mm
+	int firstMarkerId = 0;
+	FiducialConversion conversion;
+
+	for (int i = 3; i < argc; i++)
+	{
+		const std::string arg = argv[i];
+		const bool hasValue = i + 1 < argc;
+
+		if (arg == "--binary" && hasValue)
+		{
+			binaryPath = argv[++i];
+		}
+		else if (arg == "--header" && hasValue)
+		{
+			headerPath = argv[++i];
+		}
+		else if (arg == "--name" && hasValue)
+		{
+			symbol = argv[++i];
+		}
+		else if (arg == "--marker-length" && hasValue)
+		{
+			markerLength = (float)std::atof(argv[++i]);
+		}
+		else if (arg == "--first-id" && hasValue)
+		{
+			firstMarkerId = std::atoi(argv[++i]);
+		}
+		else if (arg == "--meters-per-unit" && hasValue)
+		{
+			conversion.metersPerUnit = std::atof(argv[++i]);
+		}
+		else if (arg == "--no-mirror")
+		{
+			conversion.mirrorX = false;
+		}
+		else
+		{
+			std::cout << "Unknown or incomplete argument: " + arg << std::endl;
+			PrintUsage();
+			return 1;
+		}
+	}
+
+	BoardLayout layout;
+	std::string error;
+	if (!ReadFiducialFile(fiducialPath, conversion, layout, error))
+	{
+		std::cout << "Cannot compile board: " + error << std::endl;
+		return 1;
+	}
+	layout.markerLength = markerLength;
+	layout.firstMarkerId = firstMarkerId;
+
+	if (symbol.empty())
+	{
+		symbol = layout.name.empty() ? "Board" : layout.name;
+	}
+
+	std::cout << "Board " + symbol + ": " << layout.markerLocations.size() << " markers" << std::endl;
+	for (size_t i = 0; i < layout.markerLocations.size(); i++)
+	{
+		const BoardPoint& p = layout.markerLocations[i];
+		std::cout << "Marker " << layout.firstMarkerId + (int)i << ": "
+			<< std::to_string(p.x) + " , " + std::to_string(p.y) + " , " + std::to_string(p.z)
+			<< std::endl;
+	}
+
+	if (!binaryPath.empty() && !WriteBoardLayoutFile(binaryPath, layout))
+	{
+		std::cout << "Cannot write " + binaryPath << std::endl;
+		return 1;
+	}
+
+	if (!headerPath.empty() && !WriteBoardLayoutHeader(headerPath, layout, symbol, fiducialPath))
+	{
+		std::cout << "Cannot write " + headerPath << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
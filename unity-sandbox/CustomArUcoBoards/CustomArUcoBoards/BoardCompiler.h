@@ -0,0 +1,12 @@
+#pragma once
+
+// Compile a Slicer fiducial file into board layouts for the runtime
+// component
+//	CustomArUcoBoards --compile-board <fiducial file>
+//		[--binary <file>] [--header <file>] [--name <symbol>]
+//		[--marker-length <m>] [--first-id <n>]
+//		[--meters-per-unit <m>] [--no-mirror]
+// Returns the process exit code.
+int RunBoardCompiler(
+	int argc,
+	char** argv);
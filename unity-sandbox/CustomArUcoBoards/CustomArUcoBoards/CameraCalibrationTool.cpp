@@ -0,0 +1,243 @@
+#include "CameraCalibrationTool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <opencv2/aruco/charuco.hpp>
+#include <opencv2/videoio.hpp>
+
+#include "../../OpenCVRuntimeComponent/OpenCVRuntimeComponent/IntrinsicCalibration.h"
+
+using namespace OpenCVRuntimeComponent::ArUcoTracking;
+
+namespace
+{
+	struct CalibrationOptions
+	{
+		std::string input;
+		std::string outputPath = "camera.yml";
+
+		// ChArUco board, squares and markers in meters
+		bool isGridBoard = false;
+		int squaresX = 5;
+		int squaresY = 7;
+		float squareLength = 0.04f;
+		float markerLength = 0.02f;
+
+		int maxViews = 40;
+		int minCorners = 12;
+
+		// Every n-th frame of a video is used
+		int stride = 10;
+		int numThreads = 0; // OpenCV default if not positive
+	};
+
+	void PrintUsage()
+	{
+		std::cout << "Usage: CustomArUcoBoards --calibrate <image directory | video file> "
+			"[--output <file>] [--grid] [--squares <x> <y>] "
+			"[--square-length <m>] [--marker-length <m>] "
+			"[--max-views <n>] [--min-corners <n>] [--stride <n>] "
+			"[--threads <n>]" << std::endl;
+	}
+
+	bool ParseCalibrationOptions(
+		int argc,
+		char** argv,
+		CalibrationOptions& options)
+	{
+		if (argc < 3)
+		{
+			return false;
+		}
+		options.input = argv[2];
+
+		for (int i = 3; i < argc; i++)
+		{
+			const std::string arg = argv[i];
+			const bool hasValue = i + 1 < argc;
+
+			if (arg == "--output" && hasValue)
+			{
+				options.outputPath = argv[++i];
+			}
+			else if (arg == "--grid")
+			{
+				options.isGridBoard = true;
+			}
+			else if (arg == "--squares" && i + 2 < argc)
+			{
+				options.squaresX = std::atoi(argv[++i]);
+				options.squaresY = std::atoi(argv[++i]);
+			}
+			else if (arg == "--square-length" && hasValue)
+			{
+				options.squareLength = (float)std::atof(argv[++i]);
+			}
+			else if (arg == "--marker-length" && hasValue)
+			{
+				options.markerLength = (float)std::atof(argv[++i]);
+			}
+			else if (arg == "--max-views" && hasValue)
+			{
+				options.maxViews = std::atoi(argv[++i]);
+			}
+			else if (arg == "--min-corners" && hasValue)
+			{
+				options.minCorners = std::atoi(argv[++i]);
+			}
+			else if (arg == "--stride" && hasValue)
+			{
+				options.stride = (std::max)(1, std::atoi(argv[++i]));
+			}
+			else if (arg == "--threads" && hasValue)
+			{
+				options.numThreads = std::atoi(argv[++i]);
+			}
+			else
+			{
+				std::cout << "Unknown or incomplete argument: " + arg << std::endl;
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	// Image files of a directory in name order, empty if the input is
+	// not a directory
+	std::vector<std::string> ListImages(const std::string& input)
+	{
+		std::vector<cv::String> files;
+		try
+		{
+			cv::glob(input + "/*", files, false);
+		}
+		catch (const cv::Exception&)
+		{
+			files.clear();
+		}
+
+		std::vector<std::string> images;
+		for (const auto& file : files)
+		{
+			std::string extension = file.substr(file.find_last_of('.') + 1);
+			std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+			if (extension == "png" || extension == "jpg" || extension == "jpeg" ||
+				extension == "bmp" || extension == "tif" || extension == "tiff")
+			{
+				images.push_back(file);
+			}
+		}
+
+		std::sort(images.begin(), images.end());
+		return images;
+	}
+
+	double SecondsSince(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+}
+
+int RunCameraCalibration(
+	int argc,
+	char** argv)
+{
+	CalibrationOptions options;
+	if (!ParseCalibrationOptions(argc, argv, options))
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	if (options.numThreads > 0)
+	{
+		cv::setNumThreads(options.numThreads);
+	}
+
+	cv::Ptr<cv::aruco::Dictionary> dict = cv::aruco::getPredefinedDictionary(cv::aruco::DICT_6X6_250);
+
+	IntrinsicCalibrationSettings settings;
+	settings.maxViews = options.maxViews;
+	settings.minCorners = options.minCorners;
+	if (options.isGridBoard)
+	{
+		// Grid board of the board tracking sandbox
+		settings.board = cv::aruco::GridBoard::create(5, 6, 30 / 1000.0f, 10 / 1000.0f, dict);
+	}
+	else
+	{
+		settings.board = cv::aruco::CharucoBoard::create(
+			options.squaresX,
+			options.squaresY,
+			options.squareLength,
+			options.markerLength,
+			dict);
+	}
+
+	IntrinsicCalibrator calibrator(settings);
+	auto start = std::chrono::steady_clock::now();
+
+	// Images are decoded by the detection workers, video frames have to
+	// be decoded in order first
+	size_t numImages = 0;
+	const std::vector<std::string> images = ListImages(options.input);
+	if (!images.empty())
+	{
+		numImages = images.size();
+		calibrator.DetectViews(images);
+	}
+	else
+	{
+		cv::VideoCapture capture(options.input);
+		if (!capture.isOpened())
+		{
+			std::cout << "Cannot open " + options.input << std::endl;
+			return 1;
+		}
+
+		std::vector<cv::Mat> frames;
+		cv::Mat frame;
+		for (int index = 0; capture.read(frame); index++)
+		{
+			if (index % options.stride == 0)
+			{
+				frames.push_back(frame.clone());
+			}
+		}
+
+		numImages = frames.size();
+		calibrator.DetectViews(frames);
+	}
+
+	std::cout << "Detected the board in " << calibrator.Views().size() << " of " << numImages
+		<< " images (" << SecondsSince(start) << " s)" << std::endl;
+
+	start = std::chrono::steady_clock::now();
+	const std::vector<int> selected = calibrator.SelectViews();
+
+	CameraIntrinsics intrinsics;
+	if (!calibrator.Calibrate(selected, intrinsics))
+	{
+		std::cout << "Calibration failed, " << selected.size() << " usable views" << std::endl;
+		return 1;
+	}
+
+	std::cout << "Calibrated from " << selected.size() << " views (" << SecondsSince(start) << " s), "
+		<< "reprojection error " << intrinsics.reprojectionRms << " px" << std::endl
+		<< "Camera matrix: " << intrinsics.cameraMatrix << std::endl
+		<< "Distortion: " << intrinsics.distortionCoefficients << std::endl;
+
+	if (!WriteCameraIntrinsics(options.outputPath, intrinsics))
+	{
+		std::cout << "Cannot write " + options.outputPath << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+// Calibrate the camera intrinsics from images of a ChArUco board (or the
+// 5 x 6 marker grid board) and write them for
+// CameraCalibrationParams::FromCalibrationFile
+//	CustomArUcoBoards --calibrate <image directory | video file>
+//		[--output <file>] [--grid] [--squares <x> <y>]
+//		[--square-length <m>] [--marker-length <m>]
+//		[--max-views <n>] [--min-corners <n>] [--stride <n>]
+//		[--threads <n>]
+// Returns the process exit code.
+int RunCameraCalibration(
+	int argc,
+	char** argv);
@@ -10,6 +10,16 @@
 #include <opencv2/videoio.hpp>
 #include <opencv2/calib3d/calib3d.hpp>
 
+#include "BatchDetectionTool.h"
+#include "BoardCompiler.h"
+#include "CameraCalibrationTool.h"
+#include "DetectionRegressionTool.h"
+#include "Replay.h"
+#include "SyntheticFramesTool.h"
+#include "TraceEvaluation.h"
+#include "../../OpenCVRuntimeComponent/OpenCVRuntimeComponent/GeneratedBoards.h"
+#include "../../OpenCVRuntimeComponent/OpenCVRuntimeComponent/IntrinsicCalibration.h"
+
 // Calculate positions for ArUco markers on board.
 // Assuming markers are all in same orientation, 
 // otherwise require 2 points to set corner positions.
@@ -81,14 +91,6 @@ std::pair<std::vector<std::vector<cv::Point3f>>, std::vector<int>> SetCustomObjP
 		std::cout << "Added marker id: " + std::to_string(i) << std::endl;
 	}
 
-	/*
-	Centered Markup
-	9.56385,8.93296
-	-5.74237,8.93345
-	-5.68413,-6.27982
-	9.52103,-6.31107
-	*/
-
 	const float H = 279.4;
 	const float W = 215.9;
 
@@ -98,14 +100,13 @@ std::pair<std::vector<std::vector<cv::Point3f>>, std::vector<int>> SetCustomObjP
 	// |
 	//  _______> x
 
-	// Scale points for meters in Unity
-	// Centered in Slicer
-	// Multiply components by 10, multiply X values by -1
+	// Marker locations in meters compiled from the Slicer markups in
+	// data/MarkerConfig/F.fcsv, see --compile-board
 	std::vector<cv::Point3f> markerLocations;
-	markerLocations.push_back(cv::Point3f(-95.6385, 89.3296, 0) / 1000.0); // convert from mm to m for unity
-	markerLocations.push_back(cv::Point3f(57.4237, 89.3345, 0) / 1000.0);
-	markerLocations.push_back(cv::Point3f(56.8413, -62.7982, 0) / 1000.0);
-	markerLocations.push_back(cv::Point3f(-95.2103, -63.1107, 0) / 1000.0);
+	for (const auto& location : OpenCVRuntimeComponent::ArUcoTracking::Boards::F.markerLocations)
+	{
+		markerLocations.push_back(cv::Point3f(location.x, location.y, location.z));
+	}
 
 	// Call FillPositions to calculate Board object points.
 	for (int i = 0; i < nMarkers; i++)
@@ -194,8 +195,8 @@ cv::Mat SetCameraIntrinsics()
 {
 	cv::Mat cIntr = cv::Mat::zeros(cv::Size(3, 3), CV_32F);
 
-	// Currently populating by hand. TODO: automate calibration procedure.
-	// TODO: try out the ArUco chessboard calibration.
+	// Populated by hand, CustomArUcoBoards --calibrate writes calibrated
+	// intrinsics that replay reads with --intrinsics.
 	// [[658.9556826920646, 0.0, 324.9187535049604], [0.0, 656.5978474059713, 196.8665186210343], [0.0, 0.0, 1.0]]
 	// Populate the matrix.
 	cIntr.at<float>(0, 0) = 658.9556826920646;
@@ -227,7 +228,7 @@ cv::Mat SetDistortionParams()
 	return dCoeff;
 }
 
-int main()
+int main(int argc, char** argv)
 {
 	// Not using custom markers, but using a custom configuration of them
 	// as in the data/GroundTruths folder
@@ -267,6 +268,109 @@ int main()
 
 	}
 
+	// Slicer fiducial file to binary and constexpr board layouts
+	if (argc > 1 && std::string(argv[1]) == "--compile-board")
+	{
+		return RunBoardCompiler(argc, argv);
+	}
+
+	// Camera intrinsics from images of a ChArUco board
+	if (argc > 1 && std::string(argv[1]) == "--calibrate")
+	{
+		return RunCameraCalibration(argc, argv);
+	}
+
+	// Metrics of scanned user traces against their truth templates
+	if (argc > 1 && std::string(argv[1]) == "--evaluate-traces")
+	{
+		return RunTraceEvaluation(argc, argv, isCustomMarkers ? customDict : dict);
+	}
+
+	// Headless replay of a recording with the custom board, no windows
+	// are opened
+	if (argc > 1)
+	{
+		std::pair<
+			std::vector<std::vector<cv::Point3f>>,
+			std::vector<int>>
+			returnVals = SetCustomObjPoints(
+				nMarkers,
+				markerLength);
+
+		cv::Ptr<cv::aruco::Board> replayBoard = cv::aruco::Board::create(
+			returnVals.first,
+			isCustomMarkers ? customDict : dict,
+			returnVals.second);
+
+		// Frames of the same board rendered at known poses
+		if (std::string(argv[1]) == "--synthesize")
+		{
+			return RunSyntheticFrames(
+				argc,
+				argv,
+				replayBoard,
+				SetCameraIntrinsics(),
+				SetDistortionParams(),
+				markerLength);
+		}
+
+		// Deterministic offline detection of a recording
+		if (std::string(argv[1]) == "--batch-detect")
+		{
+			return RunBatchDetection(
+				argc,
+				argv,
+				replayBoard,
+				SetCameraIntrinsics(),
+				SetDistortionParams(),
+				markerLength);
+		}
+
+		// Accuracy and latency of the detection configurations against
+		// a baseline
+		if (std::string(argv[1]) == "--regression")
+		{
+			return RunDetectionRegression(
+				argc,
+				argv,
+				replayBoard,
+				SetCameraIntrinsics(),
+				SetDistortionParams());
+		}
+
+		ReplayOptions replayOptions;
+		if (!ParseReplayOptions(argc, argv, replayOptions))
+		{
+			std::cout << "Usage: CustomArUcoBoards --replay <video file | image directory> "
+				"[--csv <file>] [--binary <file>] [--annotate <directory>] [--intrinsics <file>] "
+				"[--threads <n>] [--queue <n>] [--budget <ms>] [--slowdown <factor>]" << std::endl;
+			return 1;
+		}
+
+		cv::Mat replayIntrinsics = SetCameraIntrinsics();
+		cv::Mat replayDistortion = SetDistortionParams();
+		if (!replayOptions.intrinsicsPath.empty())
+		{
+			OpenCVRuntimeComponent::ArUcoTracking::CameraIntrinsics intrinsics;
+			if (!OpenCVRuntimeComponent::ArUcoTracking::ReadCameraIntrinsicsFile(
+				replayOptions.intrinsicsPath,
+				intrinsics))
+			{
+				std::cout << "Cannot read intrinsics from " + replayOptions.intrinsicsPath << std::endl;
+				return 1;
+			}
+			replayIntrinsics = intrinsics.cameraMatrix;
+			replayDistortion = intrinsics.distortionCoefficients;
+		}
+
+		return RunReplay(
+			replayOptions,
+			replayBoard,
+			replayIntrinsics,
+			replayDistortion,
+			0.1f);
+	}
+
 	// Draw the custom markers and save
 	//DrawMarkers(nMarkers, 0, nPixels, customDict);
 	//DrawMarkers(nMarkers, 0, nPixels, dict);
@@ -0,0 +1,290 @@
+#include "DetectionRegressionTool.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../../OpenCVRuntimeComponent/OpenCVRuntimeComponent/DetectionRegression.h"
+
+using namespace OpenCVRuntimeComponent::ArUcoTracking;
+
+namespace
+{
+	struct RegressionOptions
+	{
+		std::string baselinePath;
+		std::string resultsPath;
+		std::vector<std::string> recordedDirectories;
+		std::vector<std::string> configurationNames; // all if empty
+		int numFrames = 300;
+		int repetitions = 3;
+		std::string intrinsicsPath;
+		cv::Size imageSize = cv::Size(640, 360);
+		int numThreads = 0; // OpenCV default if not positive
+
+		RegressionThresholds thresholds;
+	};
+
+	// Fixed synthetic sequences, the seeds must not change or the
+	// baselines are no longer comparable
+	struct SyntheticSequence
+	{
+		const char* name;
+		bool isTrajectory;
+		double blurSigma;
+		double noiseSigma;
+		double lightingGradient;
+		int numOccluders;
+		uint64_t seed;
+	};
+
+	const SyntheticSequence SyntheticSequences[] =
+	{
+		{ "synthetic-trajectory", true, 0.0, 0.0, 0.0, 0, 1 },
+		{ "synthetic-degraded", true, 0.8, 3.0, 0.3, 1, 2 },
+		{ "synthetic-poses", false, 0.0, 1.0, 0.0, 0, 3 },
+	};
+
+	void PrintUsage()
+	{
+		std::cout << "Usage: CustomArUcoBoards --regression [--baseline <file>] [--results <file>] "
+			"[--recorded <directory>]... [--configuration <name>]... "
+			"[--frames <n>] [--repetitions <n>] [--intrinsics <file>] "
+			"[--size <width> <height>] [--accuracy-tolerance <fraction>] "
+			"[--latency-tolerance <fraction>] [--threads <n>]" << std::endl;
+	}
+
+	bool ParseRegressionOptions(
+		int argc,
+		char** argv,
+		RegressionOptions& options)
+	{
+		for (int i = 2; i < argc; i++)
+		{
+			const std::string arg = argv[i];
+			const bool hasValue = i + 1 < argc;
+
+			if (arg == "--baseline" && hasValue)
+			{
+				options.baselinePath = argv[++i];
+			}
+			else if (arg == "--results" && hasValue)
+			{
+				options.resultsPath = argv[++i];
+			}
+			else if (arg == "--recorded" && hasValue)
+			{
+				options.recordedDirectories.push_back(argv[++i]);
+			}
+			else if (arg == "--configuration" && hasValue)
+			{
+				options.configurationNames.push_back(argv[++i]);
+			}
+			else if (arg == "--frames" && hasValue)
+			{
+				options.numFrames = std::atoi(argv[++i]);
+			}
+			else if (arg == "--repetitions" && hasValue)
+			{
+				options.repetitions = std::atoi(argv[++i]);
+			}
+			else if (arg == "--intrinsics" && hasValue)
+			{
+				options.intrinsicsPath = argv[++i];
+			}
+			else if (arg == "--size" && i + 2 < argc)
+			{
+				options.imageSize.width = std::atoi(argv[++i]);
+				options.imageSize.height = std::atoi(argv[++i]);
+			}
+			else if (arg == "--accuracy-tolerance" && hasValue)
+			{
+				options.thresholds.accuracyTolerance = std::atof(argv[++i]);
+			}
+			else if (arg == "--latency-tolerance" && hasValue)
+			{
+				options.thresholds.latencyTolerance = std::atof(argv[++i]);
+			}
+			else if (arg == "--threads" && hasValue)
+			{
+				options.numThreads = std::atoi(argv[++i]);
+			}
+			else
+			{
+				std::cout << "Unknown or incomplete argument: " + arg << std::endl;
+				return false;
+			}
+		}
+
+		return options.numFrames > 0 && options.repetitions > 0 && options.imageSize.area() > 0;
+	}
+
+	void PrintResult(const RegressionResult& result)
+	{
+		char line[256];
+		std::snprintf(line, sizeof(line),
+			"%-22s %-20s %5d/%-5d %8.3f %8.3f %8.3f %8.3f %8.3f %8.3f",
+			result.sequence.c_str(),
+			result.configuration.c_str(),
+			result.numDetected,
+			result.numFrames,
+			result.translationP50,
+			result.translationP99,
+			result.rotationP50,
+			result.rotationP99,
+			result.latencyP50,
+			result.latencyP99);
+		std::cout << line << std::endl;
+	}
+}
+
+int RunDetectionRegression(
+	int argc,
+	char** argv,
+	const cv::Ptr<cv::aruco::Board>& board,
+	const cv::Mat& cameraIntrinsics,
+	const cv::Mat& distortionCoeffs)
+{
+	RegressionOptions options;
+	if (!ParseRegressionOptions(argc, argv, options))
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	if (options.numThreads > 0)
+	{
+		cv::setNumThreads(options.numThreads);
+	}
+
+	CameraIntrinsics camera;
+	if (!options.intrinsicsPath.empty())
+	{
+		if (!ReadCameraIntrinsicsFile(options.intrinsicsPath, camera))
+		{
+			std::cout << "Cannot read intrinsics from " + options.intrinsicsPath << std::endl;
+			return 1;
+		}
+	}
+	else
+	{
+		camera.cameraMatrix = cameraIntrinsics;
+		camera.distortionCoefficients = distortionCoeffs;
+		camera.imageSize = options.imageSize;
+	}
+
+	std::vector<DetectionConfiguration> configurations = TrackerDetectionConfigurations();
+	if (!options.configurationNames.empty())
+	{
+		const std::vector<std::string>& names = options.configurationNames;
+		configurations.erase(
+			std::remove_if(configurations.begin(), configurations.end(),
+				[&](const DetectionConfiguration& configuration)
+			{
+				return std::find(names.begin(), names.end(), configuration.name) == names.end();
+			}),
+			configurations.end());
+
+		if (configurations.empty())
+		{
+			std::cout << "No configuration matches, configurations are:";
+			for (const auto& configuration : TrackerDetectionConfigurations())
+			{
+				std::cout << " " << configuration.name;
+			}
+			std::cout << std::endl;
+			return 1;
+		}
+	}
+
+	// Sequences are rendered or decoded up front so only detection is timed
+	std::vector<RegressionSequence> sequences;
+	for (const auto& synthetic : SyntheticSequences)
+	{
+		SyntheticPoseRange range;
+		range.isTrajectory = synthetic.isTrajectory;
+
+		SyntheticFrameSettings settings;
+		settings.blurSigma = synthetic.blurSigma;
+		settings.noiseSigma = synthetic.noiseSigma;
+		settings.lightingGradient = synthetic.lightingGradient;
+		settings.numOccluders = synthetic.numOccluders;
+		settings.seed = synthetic.seed;
+
+		const SyntheticFrameGenerator generator(camera, board, settings);
+		sequences.push_back(CreateSyntheticSequence(
+			synthetic.name,
+			generator,
+			SampleSyntheticPoses(camera, board, range, options.numFrames, synthetic.seed)));
+	}
+
+	for (const auto& directory : options.recordedDirectories)
+	{
+		RegressionSequence recorded;
+		std::string error;
+		if (!ReadRecordedSequence(directory, camera, recorded, error))
+		{
+			std::cout << "Cannot read recorded sequence: " + error << std::endl;
+			return 1;
+		}
+		sequences.push_back(std::move(recorded));
+	}
+
+	std::cout << "sequence               configuration        detected    t50 mm   t99 mm   r50 deg  r99 deg  l50 ms   l99 ms" << std::endl;
+
+	// Configurations run one after the other, running them in parallel
+	// would skew the latencies
+	std::vector<RegressionResult> results;
+	for (const auto& sequence : sequences)
+	{
+		for (const auto& configuration : configurations)
+		{
+			results.push_back(RunDetectionConfiguration(
+				configuration,
+				sequence,
+				board,
+				options.repetitions));
+			PrintResult(results.back());
+		}
+	}
+
+	if (!options.resultsPath.empty() &&
+		!WriteRegressionResults(options.resultsPath, results))
+	{
+		std::cout << "Cannot write results to " + options.resultsPath << std::endl;
+		return 1;
+	}
+
+	if (options.baselinePath.empty())
+	{
+		return 0;
+	}
+
+	std::vector<RegressionResult> baseline;
+	if (!ReadRegressionResults(options.baselinePath, baseline))
+	{
+		std::cout << "Cannot read baseline from " + options.baselinePath << std::endl;
+		return 1;
+	}
+
+	const std::vector<std::string> regressions = CompareRegressionResults(
+		baseline,
+		results,
+		options.thresholds);
+	if (regressions.empty())
+	{
+		std::cout << "No regression against " + options.baselinePath << std::endl;
+		return 0;
+	}
+
+	std::cout << regressions.size() << " regressions against " + options.baselinePath << ":" << std::endl;
+	for (const auto& regression : regressions)
+	{
+		std::cout << "  " << regression << std::endl;
+	}
+	return 2;
+}
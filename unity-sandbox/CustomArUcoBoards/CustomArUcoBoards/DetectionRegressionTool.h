@@ -0,0 +1,23 @@
+#pragma once
+
+#include <opencv2/aruco.hpp>
+#include <opencv2/core.hpp>
+
+// Accuracy and latency of every detection configuration of the tracker
+// on fixed synthetic sequences and recorded sequences with ground truth
+//	CustomArUcoBoards --regression [--baseline <file>] [--results <file>]
+//		[--recorded <directory>]... [--configuration <name>]...
+//		[--frames <n>] [--repetitions <n>] [--intrinsics <file>]
+//		[--size <width> <height>] [--accuracy-tolerance <fraction>]
+//		[--latency-tolerance <fraction>] [--threads <n>]
+// Recorded directories have the layout written by --synthesize. The
+// results table is compared to the baseline table (a results table of
+// an earlier run with the same sequences and configurations) when
+// given. Returns 0 if nothing regressed, 2 if a value regressed beyond
+// its threshold or a row is in only one of the tables, and 1 on errors.
+int RunDetectionRegression(
+	int argc,
+	char** argv,
+	const cv::Ptr<cv::aruco::Board>& board,
+	const cv::Mat& cameraIntrinsics,
+	const cv::Mat& distortionCoeffs);
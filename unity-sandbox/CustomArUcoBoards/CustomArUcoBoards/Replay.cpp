@@ -0,0 +1,506 @@
+// Replay.cpp : Headless replay of recorded frames for throughput and
+// regression runs of board layouts.
+//
+
+#include "Replay.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
+#include <opencv2/videoio.hpp>
+
+#include "../../OpenCVRuntimeComponent/OpenCVRuntimeComponent/BoardDetectionPipeline.h"
+#include "../../OpenCVRuntimeComponent/OpenCVRuntimeComponent/QualityController.h"
+
+using OpenCVRuntimeComponent::ArUcoTracking::BoardDetectionPipeline;
+using OpenCVRuntimeComponent::ArUcoTracking::BoardFrameResult;
+using OpenCVRuntimeComponent::ArUcoTracking::QualityController;
+using OpenCVRuntimeComponent::ArUcoTracking::QualitySettings;
+using OpenCVRuntimeComponent::ArUcoTracking::StageTimings;
+
+namespace
+{
+	// Queue between two pipeline stages, Push waits while the queue is
+	// full and Pop waits while it is empty. Pop returns false once the
+	// queue is closed and drained.
+	template <typename T>
+	class BoundedQueue
+	{
+	public:
+		explicit BoundedQueue(size_t capacity)
+			: _capacity((std::max)(capacity, (size_t)1)),
+			_isClosed(false)
+		{
+		}
+
+		void Push(T item)
+		{
+			std::unique_lock<std::mutex> lock(_lock);
+			_notFull.wait(lock, [this] { return _items.size() < _capacity; });
+			_items.push_back(std::move(item));
+			_notEmpty.notify_one();
+		}
+
+		bool Pop(T& item)
+		{
+			std::unique_lock<std::mutex> lock(_lock);
+			_notEmpty.wait(lock, [this] { return !_items.empty() || _isClosed; });
+			if (_items.empty())
+			{
+				return false;
+			}
+
+			item = std::move(_items.front());
+			_items.pop_front();
+			_notFull.notify_one();
+			return true;
+		}
+
+		void Close()
+		{
+			std::lock_guard<std::mutex> lock(_lock);
+			_isClosed = true;
+			_notEmpty.notify_all();
+		}
+
+	private:
+		const size_t _capacity;
+		std::mutex _lock;
+		std::condition_variable _notFull;
+		std::condition_variable _notEmpty;
+		std::deque<T> _items;
+		bool _isClosed;
+	};
+
+	struct DecodedFrame
+	{
+		int64_t index = 0;
+		cv::Mat image;
+		double decodeMs = 0.0;
+	};
+
+	struct FrameResult
+	{
+		int64_t index = 0;
+		cv::Mat image; // kept for annotation only
+		std::vector<int> ids;
+		std::vector<std::vector<cv::Point2f>> corners;
+		bool isDetected = false;
+		cv::Vec3d rvec;
+		cv::Vec3d tvec;
+		double decodeMs = 0.0;
+		StageTimings timings;
+		int level = 0;
+	};
+
+	// Fixed size record of the binary output, after the header "ARR1"
+	struct ReplayRecord
+	{
+		int64_t frame;
+		int32_t detected;
+		int32_t markers;
+		double rvec[3];
+		double tvec[3];
+		double decodeMs;
+		double convertMs;
+		double detectMs;
+		double poseMs;
+		int32_t level;
+		int32_t reserved;
+	};
+
+	double ElapsedMilliseconds(
+		std::chrono::steady_clock::time_point start,
+		std::chrono::steady_clock::time_point end)
+	{
+		return std::chrono::duration<double, std::milli>(end - start).count();
+	}
+
+	// Frame source of a video file or a directory of images (sorted by
+	// file name)
+	class FrameSource
+	{
+	public:
+		bool Open(const std::string& input)
+		{
+			// Anything that is not a directory is opened as a video
+			std::vector<cv::String> files;
+			try
+			{
+				cv::glob(input + "/*", files, false);
+			}
+			catch (const cv::Exception&)
+			{
+				files.clear();
+			}
+
+			for (const auto& file : files)
+			{
+				std::string extension = file.substr(file.find_last_of('.') + 1);
+				std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+				if (extension == "png" || extension == "jpg" || extension == "jpeg" ||
+					extension == "bmp" || extension == "tif" || extension == "tiff")
+				{
+					_files.push_back(file);
+				}
+			}
+
+			if (!_files.empty())
+			{
+				std::sort(_files.begin(), _files.end());
+				return true;
+			}
+
+			return _capture.open(input);
+		}
+
+		bool Read(cv::Mat& image)
+		{
+			if (_capture.isOpened())
+			{
+				return _capture.read(image);
+			}
+
+			if (_next >= _files.size())
+			{
+				return false;
+			}
+
+			image = cv::imread(_files[_next++], cv::IMREAD_COLOR);
+			return !image.empty();
+		}
+
+	private:
+		cv::VideoCapture _capture;
+		std::vector<cv::String> _files;
+		size_t _next = 0;
+	};
+}
+
+bool ParseReplayOptions(
+	int argc,
+	char** argv,
+	ReplayOptions& options)
+{
+	bool isReplay = false;
+
+	for (int i = 1; i < argc; i++)
+	{
+		const std::string arg = argv[i];
+		const bool hasValue = i + 1 < argc;
+
+		if (arg == "--replay" && hasValue)
+		{
+			options.input = argv[++i];
+			isReplay = true;
+		}
+		else if (arg == "--csv" && hasValue)
+		{
+			options.csvPath = argv[++i];
+		}
+		else if (arg == "--binary" && hasValue)
+		{
+			options.binaryPath = argv[++i];
+		}
+		else if (arg == "--annotate" && hasValue)
+		{
+			options.annotateDirectory = argv[++i];
+		}
+		else if (arg == "--intrinsics" && hasValue)
+		{
+			options.intrinsicsPath = argv[++i];
+		}
+		else if (arg == "--threads" && hasValue)
+		{
+			options.numThreads = std::atoi(argv[++i]);
+		}
+		else if (arg == "--queue" && hasValue)
+		{
+			options.queueCapacity = std::atoi(argv[++i]);
+		}
+		else if (arg == "--budget" && hasValue)
+		{
+			options.budgetMs = std::atof(argv[++i]);
+		}
+		else if (arg == "--slowdown" && hasValue)
+		{
+			options.slowdown = std::atof(argv[++i]);
+		}
+		else
+		{
+			std::cout << "Unknown or incomplete argument: " + arg << std::endl;
+			return false;
+		}
+	}
+
+	return isReplay;
+}
+
+int RunReplay(
+	const ReplayOptions& options,
+	const cv::Ptr<cv::aruco::Board>& board,
+	const cv::Mat& cameraIntrinsics,
+	const cv::Mat& distortionCoeffs,
+	float axisLength)
+{
+	FrameSource source;
+	if (!source.Open(options.input))
+	{
+		std::cout << "Could not open replay input " + options.input << std::endl;
+		return 1;
+	}
+
+	std::ofstream csv(options.csvPath);
+	if (!csv.is_open())
+	{
+		std::cout << "Could not open " + options.csvPath << std::endl;
+		return 1;
+	}
+	csv << "frame,detected,markers,rx,ry,rz,tx,ty,tz,decode_ms,convert_ms,detect_ms,pose_ms,level" << std::endl;
+
+	std::ofstream binary;
+	if (!options.binaryPath.empty())
+	{
+		binary.open(options.binaryPath, std::ios::binary | std::ios::trunc);
+		binary.write("ARR1", 4);
+	}
+
+	const bool isAnnotating = !options.annotateDirectory.empty();
+
+	// The controller sees the timings in frame order, the workers pick up
+	// its level when they start a frame. Levels lag by the frames in
+	// flight, one thread and a queue of one replays the live behaviour.
+	// Each worker detects with its own pipeline of the tracker, the
+	// state it carries between frames (the board region searched by the
+	// levels with a region of interest) is that of its previous frame.
+	QualityController qualityController;
+	qualityController.Configure(options.budgetMs > 0.0, options.budgetMs);
+	qualityController.SetInjectedSlowdown(options.slowdown);
+	std::mutex qualityLock;
+
+	const int numThreads = options.numThreads > 0
+		? options.numThreads
+		: (std::max)(1, (int)std::thread::hardware_concurrency());
+
+	// Detection workers use their own threads
+	cv::setNumThreads(1);
+
+	BoundedQueue<DecodedFrame> decoded(options.queueCapacity);
+	BoundedQueue<FrameResult> detected(options.queueCapacity);
+	BoundedQueue<FrameResult> annotated(options.queueCapacity);
+
+	auto replayStart = std::chrono::steady_clock::now();
+
+	std::thread decoder([&]()
+	{
+		for (int64_t index = 0;; index++)
+		{
+			DecodedFrame frame;
+			frame.index = index;
+
+			auto start = std::chrono::steady_clock::now();
+			if (!source.Read(frame.image))
+			{
+				break;
+			}
+			frame.decodeMs = ElapsedMilliseconds(start, std::chrono::steady_clock::now());
+
+			decoded.Push(std::move(frame));
+		}
+
+		decoded.Close();
+	});
+
+	std::atomic<int> activeWorkers(numThreads);
+	std::vector<std::thread> workers;
+	for (int i = 0; i < numThreads; i++)
+	{
+		workers.emplace_back([&]()
+		{
+			BoardDetectionPipeline pipeline;
+			pipeline.SetBoard(board);
+
+			BoardFrameResult detection;
+			cv::Mat bgraImage;
+
+			DecodedFrame frame;
+			while (decoded.Pop(frame))
+			{
+				FrameResult result;
+				result.index = frame.index;
+				result.decodeMs = frame.decodeMs;
+
+				QualitySettings settings;
+				bool isQualityControlled;
+				{
+					std::lock_guard<std::mutex> lock(qualityLock);
+					isQualityControlled = qualityController.IsEnabled();
+					settings = qualityController.Settings();
+					result.level = qualityController.Level();
+				}
+
+				// The pipeline detects with the level of the shared
+				// controller, which adapts to the timings in frame order
+				if (isQualityControlled)
+				{
+					pipeline.QualityControl().Hold(settings);
+				}
+
+				// Camera frames are BGRA on the device, the conversion
+				// is not part of the timings
+				if (frame.image.channels() == 3)
+				{
+					cv::cvtColor(frame.image, bgraImage, cv::COLOR_BGR2BGRA);
+				}
+				else
+				{
+					bgraImage = frame.image;
+				}
+
+				pipeline.Process(
+					bgraImage,
+					cameraIntrinsics,
+					distortionCoeffs,
+					detection);
+
+				result.ids = detection.markerIds;
+				result.corners = detection.markers;
+				result.isDetected = detection.isDetected;
+				result.rvec = detection.rVec;
+				result.tvec = detection.tVec;
+				result.timings = detection.timings;
+
+				if (isAnnotating)
+				{
+					result.image = frame.image;
+				}
+
+				detected.Push(std::move(result));
+			}
+
+			if (--activeWorkers == 0)
+			{
+				detected.Close();
+			}
+		});
+	}
+
+	std::thread annotator([&]()
+	{
+		FrameResult result;
+		while (annotated.Pop(result))
+		{
+			cv::Mat image = result.image;
+			if (!result.ids.empty())
+			{
+				cv::aruco::drawDetectedMarkers(
+					image,
+					result.corners,
+					result.ids);
+			}
+			if (result.isDetected)
+			{
+				cv::aruco::drawAxis(
+					image,
+					cameraIntrinsics, distortionCoeffs,
+					result.rvec, result.tvec, axisLength);
+			}
+
+			char name[32];
+			std::snprintf(name, sizeof(name), "/frame_%06lld.png", (long long)result.index);
+			cv::imwrite(options.annotateDirectory + name, image);
+		}
+	});
+
+	// Results arrive in completion order, write them in frame order
+	std::map<int64_t, FrameResult> pending;
+	int64_t nextIndex = 0;
+	int64_t numDetected = 0;
+	double totalDetectMs = 0.0;
+
+	FrameResult result;
+	while (detected.Pop(result))
+	{
+		const int64_t index = result.index;
+		pending[index] = std::move(result);
+
+		for (auto it = pending.find(nextIndex); it != pending.end(); it = pending.find(++nextIndex))
+		{
+			FrameResult& r = it->second;
+
+			{
+				std::lock_guard<std::mutex> lock(qualityLock);
+				qualityController.Report(r.timings);
+			}
+
+			csv << r.index << "," << (r.isDetected ? 1 : 0) << "," << r.ids.size() << ","
+				<< r.rvec[0] << "," << r.rvec[1] << "," << r.rvec[2] << ","
+				<< r.tvec[0] << "," << r.tvec[1] << "," << r.tvec[2] << ","
+				<< r.decodeMs << "," << r.timings.convertMs << ","
+				<< r.timings.detectMs << "," << r.timings.poseMs << ","
+				<< r.level << "\n";
+
+			if (binary.is_open())
+			{
+				ReplayRecord record;
+				std::memset(&record, 0, sizeof(record));
+				record.frame = r.index;
+				record.detected = r.isDetected ? 1 : 0;
+				record.markers = (int32_t)r.ids.size();
+				for (int k = 0; k < 3; k++)
+				{
+					record.rvec[k] = r.rvec[k];
+					record.tvec[k] = r.tvec[k];
+				}
+				record.decodeMs = r.decodeMs;
+				record.convertMs = r.timings.convertMs;
+				record.detectMs = r.timings.detectMs;
+				record.poseMs = r.timings.poseMs;
+				record.level = r.level;
+				binary.write(reinterpret_cast<const char*>(&record), sizeof(record));
+			}
+
+			numDetected += r.isDetected ? 1 : 0;
+			totalDetectMs += r.timings.Total();
+
+			if (isAnnotating)
+			{
+				annotated.Push(std::move(r));
+			}
+			pending.erase(it);
+		}
+	}
+
+	decoder.join();
+	for (auto& worker : workers)
+	{
+		worker.join();
+	}
+	annotated.Close();
+	annotator.join();
+
+	const double elapsedS = ElapsedMilliseconds(replayStart, std::chrono::steady_clock::now()) / 1000.0;
+	std::cout << "Replayed " + std::to_string(nextIndex) + " frames in " +
+		std::to_string(elapsedS) + " s (" +
+		std::to_string(elapsedS > 0.0 ? nextIndex / elapsedS : 0.0) + " fps), board detected in " +
+		std::to_string(numDetected) + " frames, mean processing " +
+		std::to_string(nextIndex > 0 ? totalDetectMs / nextIndex : 0.0) + " ms" << std::endl;
+
+	return 0;
+}
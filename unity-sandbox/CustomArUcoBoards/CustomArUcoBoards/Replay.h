@@ -0,0 +1,51 @@
+#pragma once
+
+#include <string>
+
+#include <opencv2/aruco.hpp>
+#include <opencv2/core.hpp>
+
+// Options of the headless replay mode
+//	CustomArUcoBoards --replay <video file | image directory>
+//		[--csv <file>] [--binary <file>] [--annotate <directory>]
+//		[--intrinsics <file>]
+//		[--threads <n>] [--queue <n>] [--budget <ms>] [--slowdown <factor>]
+struct ReplayOptions
+{
+	std::string input;
+	std::string csvPath = "replay.csv";
+	std::string binaryPath;
+	std::string annotateDirectory;
+
+	// Calibrated intrinsics (see --calibrate), the hand-typed ones if empty
+	std::string intrinsicsPath;
+
+	// Detection workers and capacity of each queue between the stages
+	int numThreads = 0; // hardware concurrency if not positive
+	int queueCapacity = 8;
+
+	// Quality control of the runtime component, off without a budget.
+	// The slowdown scales the measured timings to reproduce the level
+	// changes of a throttled device.
+	double budgetMs = 0.0;
+	double slowdown = 1.0;
+};
+
+// Parse the replay options, false if replay mode was not requested or
+// the arguments are invalid
+bool ParseReplayOptions(
+	int argc,
+	char** argv,
+	ReplayOptions& options);
+
+// Decode, detect and write the results of every frame of the input
+// without a display. Decoding, detection (on numThreads workers, with
+// the board detection pipeline of the tracker) and annotation run in
+// their own threads connected by bounded queues, results are written in
+// frame order. Returns the process exit code.
+int RunReplay(
+	const ReplayOptions& options,
+	const cv::Ptr<cv::aruco::Board>& board,
+	const cv::Mat& cameraIntrinsics,
+	const cv::Mat& distortionCoeffs,
+	float axisLength);
@@ -0,0 +1,214 @@
+#include "SyntheticFramesTool.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include <opencv2/imgcodecs.hpp>
+
+#include "../../OpenCVRuntimeComponent/OpenCVRuntimeComponent/SyntheticFrames.h"
+
+using namespace OpenCVRuntimeComponent::ArUcoTracking;
+
+namespace
+{
+	struct SyntheticOptions
+	{
+		std::string outputDirectory;
+		int numFrames = 1000;
+		bool isSingleMarker = false;
+		bool isWritingImages = true;
+		std::string intrinsicsPath;
+		cv::Size imageSize = cv::Size(640, 360);
+		int numThreads = 0; // OpenCV default if not positive
+
+		SyntheticPoseRange range;
+		SyntheticFrameSettings settings;
+	};
+
+	void PrintUsage()
+	{
+		std::cout << "Usage: CustomArUcoBoards --synthesize <output directory> "
+			"[--frames <n>] [--single-marker] [--trajectory] [--seed <n>] "
+			"[--intrinsics <file>] [--size <width> <height>] "
+			"[--distance <min m> <max m>] [--max-tilt <degrees>] "
+			"[--blur <sigma>] [--noise <sigma>] [--occluders <n>] "
+			"[--lighting <gradient>] [--no-images] [--threads <n>]" << std::endl;
+	}
+
+	bool ParseSyntheticOptions(
+		int argc,
+		char** argv,
+		SyntheticOptions& options)
+	{
+		if (argc < 3)
+		{
+			return false;
+		}
+		options.outputDirectory = argv[2];
+
+		for (int i = 3; i < argc; i++)
+		{
+			const std::string arg = argv[i];
+			const bool hasValue = i + 1 < argc;
+
+			if (arg == "--frames" && hasValue)
+			{
+				options.numFrames = std::atoi(argv[++i]);
+			}
+			else if (arg == "--single-marker")
+			{
+				options.isSingleMarker = true;
+			}
+			else if (arg == "--trajectory")
+			{
+				options.range.isTrajectory = true;
+			}
+			else if (arg == "--seed" && hasValue)
+			{
+				options.settings.seed = std::strtoull(argv[++i], nullptr, 10);
+			}
+			else if (arg == "--intrinsics" && hasValue)
+			{
+				options.intrinsicsPath = argv[++i];
+			}
+			else if (arg == "--size" && i + 2 < argc)
+			{
+				options.imageSize.width = std::atoi(argv[++i]);
+				options.imageSize.height = std::atoi(argv[++i]);
+			}
+			else if (arg == "--distance" && i + 2 < argc)
+			{
+				options.range.minDistance = std::atof(argv[++i]);
+				options.range.maxDistance = std::atof(argv[++i]);
+			}
+			else if (arg == "--max-tilt" && hasValue)
+			{
+				options.range.maxTilt = std::atof(argv[++i]);
+			}
+			else if (arg == "--blur" && hasValue)
+			{
+				options.settings.blurSigma = std::atof(argv[++i]);
+			}
+			else if (arg == "--noise" && hasValue)
+			{
+				options.settings.noiseSigma = std::atof(argv[++i]);
+			}
+			else if (arg == "--occluders" && hasValue)
+			{
+				options.settings.numOccluders = std::atoi(argv[++i]);
+			}
+			else if (arg == "--lighting" && hasValue)
+			{
+				options.settings.lightingGradient = std::atof(argv[++i]);
+			}
+			else if (arg == "--no-images")
+			{
+				options.isWritingImages = false;
+			}
+			else if (arg == "--threads" && hasValue)
+			{
+				options.numThreads = std::atoi(argv[++i]);
+			}
+			else
+			{
+				std::cout << "Unknown or incomplete argument: " + arg << std::endl;
+				return false;
+			}
+		}
+
+		return options.numFrames > 0 && options.imageSize.area() > 0;
+	}
+}
+
+int RunSyntheticFrames(
+	int argc,
+	char** argv,
+	const cv::Ptr<cv::aruco::Board>& board,
+	const cv::Mat& cameraIntrinsics,
+	const cv::Mat& distortionCoeffs,
+	float markerLength)
+{
+	SyntheticOptions options;
+	if (!ParseSyntheticOptions(argc, argv, options))
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	if (options.numThreads > 0)
+	{
+		cv::setNumThreads(options.numThreads);
+	}
+
+	CameraIntrinsics camera;
+	if (!options.intrinsicsPath.empty())
+	{
+		if (!ReadCameraIntrinsicsFile(options.intrinsicsPath, camera))
+		{
+			std::cout << "Cannot read intrinsics from " + options.intrinsicsPath << std::endl;
+			return 1;
+		}
+	}
+	else
+	{
+		camera.cameraMatrix = cameraIntrinsics;
+		camera.distortionCoefficients = distortionCoeffs;
+		camera.imageSize = options.imageSize;
+	}
+
+	const cv::Ptr<cv::aruco::Board> renderedBoard = options.isSingleMarker
+		? CreateSingleMarkerBoard(board->dictionary, board->ids.front(), markerLength)
+		: board;
+
+	auto start = std::chrono::steady_clock::now();
+	const std::vector<SyntheticPose> poses = SampleSyntheticPoses(
+		camera,
+		renderedBoard,
+		options.range,
+		options.numFrames,
+		options.settings.seed);
+	const SyntheticFrameGenerator generator(camera, renderedBoard, options.settings);
+
+	std::ofstream groundTruth(options.outputDirectory + "/groundtruth.csv");
+	if (!groundTruth.is_open())
+	{
+		std::cout << "Cannot write to " + options.outputDirectory << std::endl;
+		return 1;
+	}
+	groundTruth << "frame,rx,ry,rz,tx,ty,tz,visible_markers" << std::endl;
+
+	generator.Generate(poses, [&](const std::vector<SyntheticFrame>& frames)
+	{
+		if (options.isWritingImages)
+		{
+			// Encoding dominates the generation, encode the block in parallel
+			cv::parallel_for_(cv::Range(0, (int)frames.size()), [&](const cv::Range& range)
+			{
+				for (int i = range.start; i < range.end; i++)
+				{
+					char name[32];
+					std::snprintf(name, sizeof(name), "/frame_%06lld.png", (long long)frames[i].frameIndex);
+					cv::imwrite(options.outputDirectory + name, frames[i].image);
+				}
+			});
+		}
+
+		for (const auto& frame : frames)
+		{
+			groundTruth << frame.frameIndex << ","
+				<< frame.pose.rVec[0] << "," << frame.pose.rVec[1] << "," << frame.pose.rVec[2] << ","
+				<< frame.pose.tVec[0] << "," << frame.pose.tVec[1] << "," << frame.pose.tVec[2] << ","
+				<< frame.visibleMarkerIds.size() << std::endl;
+		}
+	});
+
+	const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	std::cout << "Generated " << poses.size() << " frames in " << seconds << " s ("
+		<< poses.size() / seconds << " frames/s)" << std::endl;
+
+	return 0;
+}
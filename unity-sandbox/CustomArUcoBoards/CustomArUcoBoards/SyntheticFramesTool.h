@@ -0,0 +1,23 @@
+#pragma once
+
+#include <opencv2/aruco.hpp>
+#include <opencv2/core.hpp>
+
+// Render frames of the board (or a single marker) at sampled poses with
+// their ground truth poses
+//	CustomArUcoBoards --synthesize <output directory>
+//		[--frames <n>] [--single-marker] [--trajectory] [--seed <n>]
+//		[--intrinsics <file>] [--size <width> <height>]
+//		[--distance <min m> <max m>] [--max-tilt <degrees>]
+//		[--blur <sigma>] [--noise <sigma>] [--occluders <n>]
+//		[--lighting <gradient>] [--no-images] [--threads <n>]
+// Frames are written as frame_<index>.png (the image directory layout
+// read by --replay) and the poses to groundtruth.csv. Returns the
+// process exit code.
+int RunSyntheticFrames(
+	int argc,
+	char** argv,
+	const cv::Ptr<cv::aruco::Board>& board,
+	const cv::Mat& cameraIntrinsics,
+	const cv::Mat& distortionCoeffs,
+	float markerLength);
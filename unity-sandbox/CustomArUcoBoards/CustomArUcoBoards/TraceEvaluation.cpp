@@ -0,0 +1,424 @@
+// TraceEvaluation.cpp : Batch scoring of scanned user traces, replaces the
+// interactive Main.m of data/SampleResults/Matlab.
+//
+
+#include "TraceEvaluation.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
+
+#include "TraceMetrics.h"
+#include "TraceRegistration.h"
+
+namespace
+{
+	struct TraceEvaluationOptions
+	{
+		std::string traceDirectory;
+		std::string truthDirectory;
+		std::string regionsPath; // regions.yml of the truth directory if empty
+		std::string outputPath = "trace_metrics.csv";
+		std::string pointsPath;
+		std::string registeredDirectory;
+		bool isRegistering = true;
+		int numThreads = 0; // OpenCV default if not positive
+
+		TraceMetricSettings settings;
+		TraceRegistrationSettings registrationSettings;
+	};
+
+	struct TracePair
+	{
+		std::string tracePath;
+		std::string truthName;
+		std::string error;
+		TraceRegistration registration;
+		TraceMetrics metrics;
+	};
+
+	void PrintUsage()
+	{
+		std::cout << "Usage: CustomArUcoBoards --evaluate-traces <trace directory> <truth directory> "
+			"[--regions <file>] [--output <file>] [--points <file>] "
+			"[--point-count <n>] [--no-register] [--save-registered <directory>] "
+			"[--threads <n>]" << std::endl;
+	}
+
+	bool ParseTraceEvaluationOptions(
+		int argc,
+		char** argv,
+		TraceEvaluationOptions& options)
+	{
+		if (argc < 4)
+		{
+			return false;
+		}
+		options.traceDirectory = argv[2];
+		options.truthDirectory = argv[3];
+
+		for (int i = 4; i < argc; i++)
+		{
+			const std::string arg = argv[i];
+			const bool hasValue = i + 1 < argc;
+
+			if (arg == "--regions" && hasValue)
+			{
+				options.regionsPath = argv[++i];
+			}
+			else if (arg == "--output" && hasValue)
+			{
+				options.outputPath = argv[++i];
+			}
+			else if (arg == "--points" && hasValue)
+			{
+				options.pointsPath = argv[++i];
+			}
+			else if (arg == "--point-count" && hasValue)
+			{
+				options.settings.numPoints = std::atoi(argv[++i]);
+			}
+			else if (arg == "--no-register")
+			{
+				options.isRegistering = false;
+			}
+			else if (arg == "--save-registered" && hasValue)
+			{
+				options.registeredDirectory = argv[++i];
+			}
+			else if (arg == "--threads" && hasValue)
+			{
+				options.numThreads = std::atoi(argv[++i]);
+			}
+			else
+			{
+				std::cout << "Unknown or incomplete argument: " + arg << std::endl;
+				return false;
+			}
+		}
+
+		if (options.regionsPath.empty())
+		{
+			options.regionsPath = options.truthDirectory + "/regions.yml";
+		}
+
+		return options.settings.numPoints > 0;
+	}
+
+	std::string ToLower(std::string text)
+	{
+		std::transform(text.begin(), text.end(), text.begin(), ::tolower);
+		return text;
+	}
+
+	std::string FileStem(const std::string& path)
+	{
+		const size_t start = path.find_last_of("/\\") + 1;
+		return path.substr(start, path.find_last_of('.') - start);
+	}
+
+	std::vector<std::string> ListImages(const std::string& directory)
+	{
+		std::vector<cv::String> files;
+		try
+		{
+			cv::glob(directory + "/*", files, false);
+		}
+		catch (const cv::Exception&)
+		{
+			files.clear();
+		}
+
+		std::vector<std::string> images;
+		for (const auto& file : files)
+		{
+			const std::string extension = ToLower(file.substr(file.find_last_of('.') + 1));
+			if (extension == "png" || extension == "jpg" || extension == "jpeg" ||
+				extension == "bmp" || extension == "tif" || extension == "tiff")
+			{
+				images.push_back(file);
+			}
+		}
+
+		std::sort(images.begin(), images.end());
+		return images;
+	}
+
+	// GT_<nn> of a trace named <anything>gt_<nn>, empty if none
+	std::string TruthNameOf(const std::string& tracePath)
+	{
+		const std::string stem = ToLower(FileStem(tracePath));
+		const size_t position = stem.rfind("gt_");
+		if (position == std::string::npos)
+		{
+			return std::string();
+		}
+
+		size_t end = position + 3;
+		while (end < stem.size() && std::isdigit((unsigned char)stem[end]))
+		{
+			end++;
+		}
+		if (end == position + 3)
+		{
+			return std::string();
+		}
+
+		return "GT_" + stem.substr(position + 3, end - position - 3);
+	}
+
+	// Gray scan at 300 DPI, resampled if scanned at another resolution
+	cv::Mat ReadScan(const std::string& path)
+	{
+		cv::Mat scan = cv::imread(path, cv::IMREAD_GRAYSCALE);
+		if (!scan.empty() && scan.size() != TraceScanSize)
+		{
+			const bool isShrinking = scan.cols > TraceScanSize.width;
+			cv::resize(scan, scan, TraceScanSize, 0, 0, isShrinking ? cv::INTER_AREA : cv::INTER_CUBIC);
+		}
+		return scan;
+	}
+
+	bool WriteMetricsTable(
+		const std::string& path,
+		const std::vector<TracePair>& pairs)
+	{
+		std::ofstream stream(path);
+		if (!stream.is_open())
+		{
+			return false;
+		}
+
+		stream << "trace,truth,registration,markers,rotation_deg,shift_x_px,shift_y_px,correlation,"
+			"trace_points,truth_points,tre_mean_mm,tre_std_mm,tre_rms_mm,dice,assd_mm,mssd_mm" << std::endl;
+		for (const auto& pair : pairs)
+		{
+			if (!pair.error.empty())
+			{
+				continue;
+			}
+
+			const TraceRegistration& registration = pair.registration;
+			const TraceMetrics& metrics = pair.metrics;
+			stream << FileStem(pair.tracePath) << "," << pair.truthName << ","
+				<< ToString(registration.initialization) << "," << registration.numMarkers << ","
+				<< std::atan2(registration.warp(1, 0), registration.warp(0, 0)) * 180.0 / CV_PI << ","
+				<< registration.warp(0, 2) << "," << registration.warp(1, 2) << ","
+				<< registration.correlation << ","
+				<< metrics.tracePoints.size() << "," << metrics.truthPoints.size() << ","
+				<< metrics.treMean << "," << metrics.treStd << "," << metrics.treRms << ","
+				<< metrics.dice << "," << metrics.assd << "," << metrics.mssd << std::endl;
+		}
+		return true;
+	}
+
+	bool WritePointsTable(
+		const std::string& path,
+		const std::vector<TracePair>& pairs)
+	{
+		std::ofstream stream(path);
+		if (!stream.is_open())
+		{
+			return false;
+		}
+
+		stream << "trace,truth,point,truth_x,truth_y,trace_x,trace_y,tre_mm" << std::endl;
+		for (const auto& pair : pairs)
+		{
+			const TraceMetrics& metrics = pair.metrics;
+			for (size_t i = 0; i < metrics.pointErrors.size(); i++)
+			{
+				const TracePoint& truthPoint = metrics.truthPoints[i];
+				const TracePoint& tracePoint = metrics.tracePoints[metrics.nearestTracePoint[i]];
+				stream << FileStem(pair.tracePath) << "," << pair.truthName << "," << i << ","
+					<< truthPoint.center.x << "," << truthPoint.center.y << ","
+					<< tracePoint.center.x << "," << tracePoint.center.y << ","
+					<< metrics.pointErrors[i] << std::endl;
+			}
+		}
+		return true;
+	}
+}
+
+int RunTraceEvaluation(
+	int argc,
+	char** argv,
+	const cv::Ptr<cv::aruco::Dictionary>& dictionary)
+{
+	TraceEvaluationOptions options;
+	if (!ParseTraceEvaluationOptions(argc, argv, options))
+	{
+		PrintUsage();
+		return 1;
+	}
+	options.registrationSettings.dictionary = dictionary;
+
+	if (options.numThreads > 0)
+	{
+		cv::setNumThreads(options.numThreads);
+	}
+
+	std::map<std::string, TraceRegions> regions;
+	if (!ReadTraceRegions(options.regionsPath, regions))
+	{
+		std::cout << "Cannot read regions from " + options.regionsPath << std::endl;
+		return 1;
+	}
+
+	const std::vector<std::string> tracePaths = ListImages(options.traceDirectory);
+	if (tracePaths.empty())
+	{
+		std::cout << "No trace images in " + options.traceDirectory << std::endl;
+		return 1;
+	}
+
+	std::map<std::string, std::string> truthPaths;
+	for (const auto& path : ListImages(options.truthDirectory))
+	{
+		truthPaths[ToLower(FileStem(path))] = path;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+
+	// Pair the traces, then decode each truth used once
+	std::vector<TracePair> pairs(tracePaths.size());
+	std::vector<std::string> truthNames;
+	for (size_t i = 0; i < tracePaths.size(); i++)
+	{
+		TracePair& pair = pairs[i];
+		pair.tracePath = tracePaths[i];
+		pair.truthName = TruthNameOf(pair.tracePath);
+
+		if (pair.truthName.empty())
+		{
+			pair.error = "no gt_<nn> in the file name";
+		}
+		else if (truthPaths.count(ToLower(pair.truthName)) == 0)
+		{
+			pair.error = "no truth " + pair.truthName + " in " + options.truthDirectory;
+		}
+		else if (regions.count(pair.truthName) == 0)
+		{
+			pair.error = "no regions of " + pair.truthName + " in " + options.regionsPath;
+		}
+		else if (std::find(truthNames.begin(), truthNames.end(), pair.truthName) == truthNames.end())
+		{
+			truthNames.push_back(pair.truthName);
+		}
+	}
+
+	// Truths are shared by the traces, their pyramids and markers are
+	// prepared once
+	std::vector<cv::Mat> truths(truthNames.size());
+	std::vector<ScanPyramid> truthPyramids(truthNames.size());
+	cv::parallel_for_(cv::Range(0, (int)truthNames.size()), [&](const cv::Range& range)
+	{
+		for (int i = range.start; i < range.end; i++)
+		{
+			truths[i] = ReadScan(truthPaths.at(ToLower(truthNames[i])));
+			if (options.isRegistering && !truths[i].empty())
+			{
+				BuildScanPyramid(truths[i], options.registrationSettings, truthPyramids[i]);
+			}
+		}
+	});
+
+	// Traces are decoded, registered and scored by one worker each, only
+	// the scans in flight are held in memory
+	cv::parallel_for_(cv::Range(0, (int)pairs.size()), [&](const cv::Range& range)
+	{
+		for (int i = range.start; i < range.end; i++)
+		{
+			TracePair& pair = pairs[i];
+			if (!pair.error.empty())
+			{
+				continue;
+			}
+
+			const size_t truthIndex =
+				std::find(truthNames.begin(), truthNames.end(), pair.truthName) - truthNames.begin();
+			const cv::Mat& truth = truths[truthIndex];
+			cv::Mat trace = ReadScan(pair.tracePath);
+			if (trace.empty() || truth.empty())
+			{
+				pair.error = "cannot read the trace or its truth";
+				continue;
+			}
+
+			if (options.isRegistering)
+			{
+				ScanPyramid tracePyramid;
+				BuildScanPyramid(trace, options.registrationSettings, tracePyramid);
+				RegisterTrace(
+					tracePyramid,
+					truthPyramids[truthIndex],
+					options.registrationSettings,
+					pair.registration);
+
+				cv::Mat registered;
+				WarpTrace(trace, pair.registration, truth.size(), registered);
+				trace = registered;
+			}
+
+			if (!options.registeredDirectory.empty())
+			{
+				cv::imwrite(options.registeredDirectory + "/" + FileStem(pair.tracePath) + "_registered.png", trace);
+			}
+
+			ComputeTraceMetrics(
+				trace,
+				truth,
+				regions.at(pair.truthName),
+				options.settings,
+				pair.metrics);
+		}
+	}, (double)pairs.size());
+
+	const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	int numScored = 0;
+	for (const auto& pair : pairs)
+	{
+		if (!pair.error.empty())
+		{
+			std::cout << FileStem(pair.tracePath) << ": skipped, " << pair.error << std::endl;
+			continue;
+		}
+
+		numScored++;
+		std::cout << FileStem(pair.tracePath) << " vs " << pair.truthName;
+		if (options.isRegistering)
+		{
+			std::cout << " (registered from " << ToString(pair.registration.initialization)
+				<< ", correlation " << pair.registration.correlation << ")";
+		}
+		std::cout << ": TRE " << pair.metrics.treMean << " +/- " << pair.metrics.treStd
+			<< " mm (" << pair.metrics.pointErrors.size() << " points), DICE " << pair.metrics.dice
+			<< ", ASSD " << pair.metrics.assd << " mm, MSSD " << pair.metrics.mssd << " mm" << std::endl;
+	}
+	std::cout << "Scored " << numScored << " of " << pairs.size() << " traces in " << seconds << " s" << std::endl;
+
+	if (!WriteMetricsTable(options.outputPath, pairs))
+	{
+		std::cout << "Cannot write results to " + options.outputPath << std::endl;
+		return 1;
+	}
+
+	if (!options.pointsPath.empty() && !WritePointsTable(options.pointsPath, pairs))
+	{
+		std::cout << "Cannot write points to " + options.pointsPath << std::endl;
+		return 1;
+	}
+
+	return numScored > 0 ? 0 : 1;
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <opencv2/aruco.hpp>
+
+// Score every scanned trace of a directory against its truth template
+//	CustomArUcoBoards --evaluate-traces <trace directory> <truth directory>
+//		[--regions <file>] [--output <file>] [--points <file>]
+//		[--point-count <n>] [--no-register] [--save-registered <directory>]
+//		[--threads <n>]
+// A trace is paired with the truth named by the gt_<nn> part of its file
+// name (calib_gt_02.jpg is scored against GT_02.jpg) and the regions of
+// that truth, read from regions.yml in the truth directory by default.
+// Traces are registered to their truth (markers of the dictionary, or
+// features), scored in parallel and written to the output table (one row
+// per trace) and optionally the points table (one row per truth point).
+// Returns the process exit code.
+int RunTraceEvaluation(
+	int argc,
+	char** argv,
+	const cv::Ptr<cv::aruco::Dictionary>& dictionary);
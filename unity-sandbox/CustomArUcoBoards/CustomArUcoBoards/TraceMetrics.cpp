@@ -0,0 +1,326 @@
+// TraceMetrics.cpp : Accuracy of scanned user traces against their truth
+// templates, the metrics of the Matlab scripts in data/SampleResults/Matlab.
+//
+
+#include "TraceMetrics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include <opencv2/imgproc.hpp>
+
+namespace
+{
+	// Closing of the contour and of the injection points (strel disk 4
+	// and disk 1 of compute_assd.m and compute_tre.m)
+	const int ContourClosingRadius = 4;
+	const int PointClosingRadius = 1;
+
+	// Erosion defining the border of a filled contour (strel sphere 2)
+	const int BorderRadius = 2;
+
+	cv::Mat Disk(int radius)
+	{
+		return cv::getStructuringElement(
+			cv::MORPH_ELLIPSE,
+			cv::Size(2 * radius + 1, 2 * radius + 1));
+	}
+
+	std::vector<cv::Point2f> ReadPolygon(const cv::FileNode& node)
+	{
+		std::vector<float> values;
+		node >> values;
+
+		std::vector<cv::Point2f> polygon;
+		for (size_t i = 0; i + 1 < values.size(); i += 2)
+		{
+			polygon.push_back(cv::Point2f(values[i], values[i + 1]));
+		}
+		return polygon;
+	}
+
+	void BorderOf(const cv::Mat& filled, cv::Mat& border)
+	{
+		cv::Mat eroded;
+		cv::erode(filled, eroded, Disk(BorderRadius));
+		cv::subtract(filled, eroded, border);
+	}
+
+	// Sum and maximum of the distances from the pixels of from to the
+	// nearest pixel of to
+	void DirectedDistances(
+		const cv::Mat& from,
+		const cv::Mat& to,
+		double& sum,
+		double& maximum)
+	{
+		// Distance transform measures the distance to the nearest zero pixel
+		cv::Mat inverted, distance;
+		cv::bitwise_not(to, inverted);
+		cv::distanceTransform(inverted, distance, cv::DIST_L2, cv::DIST_MASK_PRECISE);
+
+		sum = cv::mean(distance, from)[0] * cv::countNonZero(from);
+		cv::minMaxLoc(distance, nullptr, &maximum, nullptr, nullptr, from);
+	}
+}
+
+bool ReadTraceRegions(
+	const std::string& path,
+	std::map<std::string, TraceRegions>& regions)
+{
+	std::map<std::string, TraceRegions> read;
+	try
+	{
+		cv::FileStorage storage(path, cv::FileStorage::READ);
+		if (!storage.isOpened())
+		{
+			return false;
+		}
+
+		const cv::FileNode root = storage.root();
+		for (auto it = root.begin(); it != root.end(); ++it)
+		{
+			const cv::FileNode node = *it;
+			TraceRegions truthRegions;
+			truthRegions.outer = ReadPolygon(node["outer"]);
+			truthRegions.inner = ReadPolygon(node["inner"]);
+			if (truthRegions.outer.size() < 3 || truthRegions.inner.size() < 3)
+			{
+				return false;
+			}
+			read[node.name()] = truthRegions;
+		}
+	}
+	catch (const cv::Exception&)
+	{
+		return false;
+	}
+
+	regions = read;
+	return !regions.empty();
+}
+
+void SegmentTraceRegion(
+	const cv::Mat& grayScan,
+	const std::vector<cv::Point2f>& region,
+	int closingRadius,
+	cv::Mat& filled,
+	cv::Rect& bounds)
+{
+	// Region coordinates are 1-based
+	std::vector<cv::Point2f> points;
+	for (const auto& point : region)
+	{
+		points.push_back(point - cv::Point2f(1.0f, 1.0f));
+	}
+	bounds = cv::boundingRect(points) & cv::Rect(0, 0, grayScan.cols, grayScan.rows);
+	if (bounds.area() == 0)
+	{
+		bounds = cv::Rect(0, 0, 1, 1);
+		filled = cv::Mat::zeros(bounds.size(), CV_8U);
+		return;
+	}
+
+	// Polygon in crop pixels with 8 fractional bits
+	std::vector<std::vector<cv::Point>> polygon(1);
+	for (const auto& point : points)
+	{
+		polygon[0].push_back(cv::Point(
+			cvRound((point.x - bounds.x) * 256.0f),
+			cvRound((point.y - bounds.y) * 256.0f)));
+	}
+
+	cv::Mat mask = cv::Mat::zeros(bounds.size(), CV_8U);
+	cv::fillPoly(mask, polygon, cv::Scalar(255), cv::LINE_8, 8);
+
+	cv::Mat crop(bounds.size(), CV_8U, cv::Scalar(255));
+	grayScan(bounds).copyTo(crop, mask);
+
+	// Ink is darker than the paper
+	cv::Mat ink;
+	cv::threshold(crop, ink, 0, 255, cv::THRESH_BINARY_INV | cv::THRESH_OTSU);
+	cv::morphologyEx(ink, ink, cv::MORPH_CLOSE, Disk(closingRadius));
+
+	// Filling the outer contours fills the holes
+	std::vector<std::vector<cv::Point>> contours;
+	cv::findContours(ink, contours, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE);
+	filled = cv::Mat::zeros(bounds.size(), CV_8U);
+	cv::drawContours(filled, contours, -1, cv::Scalar(255), cv::FILLED);
+}
+
+std::vector<TracePoint> FindTracePoints(
+	const cv::Mat& filled,
+	const cv::Point2d& offset,
+	double minRadius,
+	double maxRadius,
+	double minCircularity,
+	int maxPoints)
+{
+	std::vector<std::vector<cv::Point>> contours;
+	cv::findContours(filled.clone(), contours, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_NONE);
+
+	std::vector<TracePoint> candidates;
+	for (const auto& contour : contours)
+	{
+		const cv::Moments moments = cv::moments(contour);
+		const double perimeter = cv::arcLength(contour, true);
+		if (moments.m00 <= 0.0 || perimeter <= 0.0)
+		{
+			continue;
+		}
+
+		TracePoint point;
+		point.radius = std::sqrt(moments.m00 / CV_PI);
+		point.circularity = (std::min)(1.0, 4.0 * CV_PI * moments.m00 / (perimeter * perimeter));
+		if (point.radius < minRadius || point.radius > maxRadius ||
+			point.circularity < minCircularity)
+		{
+			continue;
+		}
+
+		point.center = offset + cv::Point2d(moments.m10 / moments.m00, moments.m01 / moments.m00);
+		candidates.push_back(point);
+	}
+
+	std::stable_sort(candidates.begin(), candidates.end(),
+		[](const TracePoint& a, const TracePoint& b)
+	{
+		return a.circularity > b.circularity;
+	});
+
+	std::vector<TracePoint> points;
+	for (const auto& candidate : candidates)
+	{
+		if ((int)points.size() >= maxPoints)
+		{
+			break;
+		}
+
+		const bool isOverlapping = std::any_of(points.begin(), points.end(),
+			[&](const TracePoint& point)
+		{
+			return cv::norm(point.center - candidate.center) < point.radius + candidate.radius;
+		});
+		if (!isOverlapping)
+		{
+			points.push_back(candidate);
+		}
+	}
+
+	return points;
+}
+
+double DiceCoefficient(const cv::Mat& a, const cv::Mat& b)
+{
+	const int areas = cv::countNonZero(a) + cv::countNonZero(b);
+	if (areas == 0)
+	{
+		return 0.0;
+	}
+
+	cv::Mat intersection;
+	cv::bitwise_and(a, b, intersection);
+	return 2.0 * cv::countNonZero(intersection) / areas;
+}
+
+void SymmetricSurfaceDistance(
+	const cv::Mat& a,
+	const cv::Mat& b,
+	double& average,
+	double& maximum)
+{
+	cv::Mat borderA, borderB;
+	BorderOf(a, borderA);
+	BorderOf(b, borderB);
+
+	const int countA = cv::countNonZero(borderA);
+	const int countB = cv::countNonZero(borderB);
+	if (countA == 0 || countB == 0)
+	{
+		average = maximum = std::sqrt((double)a.cols * a.cols + (double)a.rows * a.rows);
+		return;
+	}
+
+	double sumAB, maxAB, sumBA, maxBA;
+	DirectedDistances(borderA, borderB, sumAB, maxAB);
+	DirectedDistances(borderB, borderA, sumBA, maxBA);
+
+	average = (sumAB + sumBA) / (countA + countB);
+	maximum = (std::max)(maxAB, maxBA);
+}
+
+void ComputeTraceMetrics(
+	const cv::Mat& trace,
+	const cv::Mat& truth,
+	const TraceRegions& regions,
+	const TraceMetricSettings& settings,
+	TraceMetrics& metrics)
+{
+	metrics = TraceMetrics();
+	cv::Mat traceFilled, truthFilled;
+	cv::Rect bounds;
+
+	// Contour (compute_similarity.m, compute_assd.m)
+	SegmentTraceRegion(trace, regions.outer, ContourClosingRadius, traceFilled, bounds);
+	SegmentTraceRegion(truth, regions.outer, ContourClosingRadius, truthFilled, bounds);
+
+	metrics.dice = DiceCoefficient(truthFilled, traceFilled);
+	SymmetricSurfaceDistance(truthFilled, traceFilled, metrics.assd, metrics.mssd);
+	metrics.assd /= TracePixelsPerMillimeter;
+	metrics.mssd /= TracePixelsPerMillimeter;
+
+	// Injection points (compute_tre.m)
+	SegmentTraceRegion(trace, regions.inner, PointClosingRadius, traceFilled, bounds);
+	SegmentTraceRegion(truth, regions.inner, PointClosingRadius, truthFilled, bounds);
+
+	const cv::Point2d offset(bounds.x, bounds.y);
+	metrics.tracePoints = FindTracePoints(
+		traceFilled, offset,
+		settings.traceMinRadius, settings.traceMaxRadius,
+		settings.minCircularity, settings.numPoints);
+	metrics.truthPoints = FindTracePoints(
+		truthFilled, offset,
+		settings.truthMinRadius, settings.truthMaxRadius,
+		settings.minCircularity, settings.numPoints);
+
+	const double nan = std::numeric_limits<double>::quiet_NaN();
+	metrics.treMean = metrics.treStd = metrics.treRms = nan;
+	if (metrics.tracePoints.empty() || metrics.truthPoints.empty())
+	{
+		return;
+	}
+
+	for (const auto& truthPoint : metrics.truthPoints)
+	{
+		int nearest = 0;
+		double nearestDistance = std::numeric_limits<double>::max();
+		for (size_t i = 0; i < metrics.tracePoints.size(); i++)
+		{
+			const double distance = cv::norm(metrics.tracePoints[i].center - truthPoint.center);
+			if (distance < nearestDistance)
+			{
+				nearest = (int)i;
+				nearestDistance = distance;
+			}
+		}
+		metrics.nearestTracePoint.push_back(nearest);
+		metrics.pointErrors.push_back(nearestDistance / TracePixelsPerMillimeter);
+	}
+
+	const size_t count = metrics.pointErrors.size();
+	double sum = 0.0;
+	for (double error : metrics.pointErrors)
+	{
+		sum += error;
+	}
+	metrics.treMean = sum / count;
+
+	double squares = 0.0;
+	for (double error : metrics.pointErrors)
+	{
+		squares += (error - metrics.treMean) * (error - metrics.treMean);
+	}
+	metrics.treStd = count > 1 ? std::sqrt(squares / (count - 1)) : 0.0;
+	metrics.treRms = std::sqrt(metrics.treMean * metrics.treMean + metrics.treStd * metrics.treStd);
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+// Scans are evaluated at 300 DPI, 2550 x 3300 pixels
+const cv::Size TraceScanSize(2550, 3300);
+const double TracePixelsPerMillimeter = 300.0 / 25.4;
+
+// Regions of interest of a truth template in scan pixels. The outer
+// polygon encloses the traced contour, the inner polygon the injection
+// points.
+struct TraceRegions
+{
+	std::vector<cv::Point2f> outer;
+	std::vector<cv::Point2f> inner;
+};
+
+// Regions of each truth template by name (GT_01), an OpenCV FileStorage
+// document with outer and inner lists of x y coordinates as pasted from
+// roipoly (1-based pixels). See data/SampleResults/Truths/regions.yml.
+bool ReadTraceRegions(
+	const std::string& path,
+	std::map<std::string, TraceRegions>& regions);
+
+struct TraceMetricSettings
+{
+	// Radius range (pixels) of the injection points of the trace and of
+	// the truth, the radius of a point is that of a disk of its area
+	double traceMinRadius = 8.0;
+	double traceMaxRadius = 50.0;
+	double truthMinRadius = 5.0;
+	double truthMaxRadius = 20.0;
+
+	// Points less round than this (4 pi area / perimeter^2) are strokes
+	// of the contour or vessels running through the inner region
+	double minCircularity = 0.6;
+
+	// Roundest non-overlapping points kept of each image
+	int numPoints = 19;
+};
+
+// Filled blob of a binary image
+struct TracePoint
+{
+	cv::Point2d center; // scan pixels
+	double radius;
+	double circularity;
+};
+
+// Accuracy of a trace against its truth, distances in millimeters
+struct TraceMetrics
+{
+	// Target registration error of each truth point to the nearest
+	// trace point, and its mean, standard deviation and
+	// sqrt(mean^2 + std^2)
+	std::vector<TracePoint> tracePoints;
+	std::vector<TracePoint> truthPoints;
+	std::vector<int> nearestTracePoint; // of each truth point
+	std::vector<double> pointErrors;
+	double treMean = 0.0;
+	double treStd = 0.0;
+	double treRms = 0.0;
+
+	// Dice similarity coefficient of the filled contours
+	double dice = 0.0;
+
+	// Average and maximum symmetric surface distance of the contours
+	double assd = 0.0;
+	double mssd = 0.0;
+};
+
+// Binary of the ink within a region of a gray scan, cropped to the
+// bounds of the region: the region is whitened outside the polygon,
+// binarized with Otsu's threshold, closed with a disk of closingRadius
+// and its holes filled (Matlab imbinarize, imclose and imfill)
+void SegmentTraceRegion(
+	const cv::Mat& grayScan,
+	const std::vector<cv::Point2f>& region,
+	int closingRadius,
+	cv::Mat& filled,
+	cv::Rect& bounds);
+
+// Round blobs of a binary image from its outer contours, roundest first,
+// with blobs overlapping a rounder blob removed (filter_circles.m)
+std::vector<TracePoint> FindTracePoints(
+	const cv::Mat& filled,
+	const cv::Point2d& offset,
+	double minRadius,
+	double maxRadius,
+	double minCircularity,
+	int maxPoints);
+
+// 2 |A and B| / (|A| + |B|) of two binary images
+double DiceCoefficient(const cv::Mat& a, const cv::Mat& b);
+
+// Distances (pixels) from the border pixels of each binary image to the
+// nearest border pixel of the other, from distance transforms of the
+// borders. Border pixels are those removed by an erosion with a disk of
+// radius 2. Without borders the distances are the image diagonal.
+void SymmetricSurfaceDistance(
+	const cv::Mat& a,
+	const cv::Mat& b,
+	double& average,
+	double& maximum);
+
+// Metrics of a scanned trace registered to the scanned truth, 8 bit gray
+// scans of TraceScanSize (Main.m)
+void ComputeTraceMetrics(
+	const cv::Mat& trace,
+	const cv::Mat& truth,
+	const TraceRegions& regions,
+	const TraceMetricSettings& settings,
+	TraceMetrics& metrics);
@@ -0,0 +1,305 @@
+// TraceRegistration.cpp : Rigid registration of scanned user traces to their
+// truth templates, replaces register_images.m of data/SampleResults/Matlab.
+//
+
+#include "TraceRegistration.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <opencv2/calib3d.hpp>
+#include <opencv2/features2d.hpp>
+#include <opencv2/imgproc.hpp>
+#include <opencv2/video/tracking.hpp>
+
+namespace
+{
+	// Features matched when the scans share no marker
+	const int NumFeatures = 2000;
+	const double FeatureRansacThreshold = 3.0; // pixels of the detection level
+	const int MinFeatureInliers = 12;
+
+	// Smoothing of each level before the intensity refinement
+	const double RefinementBlurSigma = 1.0;
+
+	// pyrDown keeps the even pixels, a level l pixel x is the scan pixel
+	// x * 2^l and only the translation of a rigid transform scales
+	cv::Matx23d ScaleWarp(const cv::Matx23d& warp, double scale)
+	{
+		cv::Matx23d scaled = warp;
+		scaled(0, 2) *= scale;
+		scaled(1, 2) *= scale;
+		return scaled;
+	}
+
+	cv::Matx23d RigidWarp(double angle, const cv::Point2d& translation)
+	{
+		const double c = std::cos(angle);
+		const double s = std::sin(angle);
+		return cv::Matx23d(
+			c, -s, translation.x,
+			s, c, translation.y);
+	}
+
+	// Least squares rotation and translation mapping from onto to
+	// (2D Kabsch), returns the RMS residual
+	double FitRigid(
+		const std::vector<cv::Point2d>& from,
+		const std::vector<cv::Point2d>& to,
+		cv::Matx23d& warp)
+	{
+		cv::Point2d fromCenter, toCenter;
+		for (size_t i = 0; i < from.size(); i++)
+		{
+			fromCenter += from[i];
+			toCenter += to[i];
+		}
+		fromCenter *= 1.0 / from.size();
+		toCenter *= 1.0 / to.size();
+
+		double sine = 0.0, cosine = 0.0;
+		for (size_t i = 0; i < from.size(); i++)
+		{
+			const cv::Point2d f = from[i] - fromCenter;
+			const cv::Point2d t = to[i] - toCenter;
+			sine += f.x * t.y - f.y * t.x;
+			cosine += f.x * t.x + f.y * t.y;
+		}
+
+		const double angle = std::atan2(sine, cosine);
+		const double c = std::cos(angle);
+		const double s = std::sin(angle);
+		warp = RigidWarp(angle, toCenter - cv::Point2d(
+			c * fromCenter.x - s * fromCenter.y,
+			s * fromCenter.x + c * fromCenter.y));
+
+		double squares = 0.0;
+		for (size_t i = 0; i < from.size(); i++)
+		{
+			const cv::Point2d mapped(
+				warp(0, 0) * from[i].x + warp(0, 1) * from[i].y + warp(0, 2),
+				warp(1, 0) * from[i].x + warp(1, 1) * from[i].y + warp(1, 2));
+			const cv::Point2d residual = mapped - to[i];
+			squares += residual.dot(residual);
+		}
+		return std::sqrt(squares / from.size());
+	}
+
+	// Rigid transform from the corners of the markers both scans share
+	bool InitializeFromMarkers(
+		const ScanPyramid& trace,
+		const ScanPyramid& truth,
+		const TraceRegistrationSettings& settings,
+		TraceRegistration& registration)
+	{
+		std::vector<cv::Point2d> truthCorners, traceCorners;
+		int numMarkers = 0;
+		for (size_t i = 0; i < truth.markerIds.size(); i++)
+		{
+			const auto match = std::find(trace.markerIds.begin(), trace.markerIds.end(), truth.markerIds[i]);
+			if (match == trace.markerIds.end())
+			{
+				continue;
+			}
+
+			const auto& traceMarker = trace.markers[match - trace.markerIds.begin()];
+			for (int c = 0; c < 4; c++)
+			{
+				truthCorners.push_back(truth.markers[i][c]);
+				traceCorners.push_back(traceMarker[c]);
+			}
+			numMarkers++;
+		}
+
+		if (numMarkers == 0)
+		{
+			return false;
+		}
+
+		cv::Matx23d warp;
+		if (FitRigid(truthCorners, traceCorners, warp) > settings.maxMarkerResidual)
+		{
+			return false;
+		}
+
+		registration.warp = warp;
+		registration.initialization = RegistrationInitialization::Markers;
+		registration.numMarkers = numMarkers;
+		return true;
+	}
+
+	// Rotation and translation of a RANSAC similarity fit to matched ORB
+	// features of the detection level
+	bool InitializeFromFeatures(
+		const ScanPyramid& trace,
+		const ScanPyramid& truth,
+		const TraceRegistrationSettings& settings,
+		TraceRegistration& registration)
+	{
+		const int level = (std::min)(settings.detectionLevel, (int)truth.levels.size() - 1);
+		cv::Ptr<cv::ORB> orb = cv::ORB::create(NumFeatures);
+
+		std::vector<cv::KeyPoint> truthKeyPoints, traceKeyPoints;
+		cv::Mat truthDescriptors, traceDescriptors;
+		orb->detectAndCompute(truth.levels[level], cv::noArray(), truthKeyPoints, truthDescriptors);
+		orb->detectAndCompute(trace.levels[level], cv::noArray(), traceKeyPoints, traceDescriptors);
+		if (truthDescriptors.empty() || traceDescriptors.empty())
+		{
+			return false;
+		}
+
+		std::vector<cv::DMatch> matches;
+		cv::BFMatcher(cv::NORM_HAMMING, true).match(truthDescriptors, traceDescriptors, matches);
+		if ((int)matches.size() < MinFeatureInliers)
+		{
+			return false;
+		}
+
+		std::vector<cv::Point2f> truthPoints, tracePoints;
+		for (const auto& match : matches)
+		{
+			truthPoints.push_back(truthKeyPoints[match.queryIdx].pt);
+			tracePoints.push_back(traceKeyPoints[match.trainIdx].pt);
+		}
+
+		std::vector<uchar> inliers;
+		const cv::Mat similarity = cv::estimateAffinePartial2D(
+			truthPoints,
+			tracePoints,
+			inliers,
+			cv::RANSAC,
+			FeatureRansacThreshold);
+		if (similarity.empty() || cv::countNonZero(inliers) < MinFeatureInliers)
+		{
+			return false;
+		}
+
+		// Refit the inliers without the scale of the similarity
+		std::vector<cv::Point2d> truthInliers, traceInliers;
+		for (size_t i = 0; i < inliers.size(); i++)
+		{
+			if (inliers[i])
+			{
+				truthInliers.push_back(truthPoints[i]);
+				traceInliers.push_back(tracePoints[i]);
+			}
+		}
+
+		cv::Matx23d warp;
+		FitRigid(truthInliers, traceInliers, warp);
+		registration.warp = ScaleWarp(warp, (double)(1 << level));
+		registration.initialization = RegistrationInitialization::Features;
+		return true;
+	}
+}
+
+const char* ToString(RegistrationInitialization initialization)
+{
+	switch (initialization)
+	{
+	case RegistrationInitialization::Markers:
+		return "markers";
+	case RegistrationInitialization::Features:
+		return "features";
+	default:
+		return "none";
+	}
+}
+
+void BuildScanPyramid(
+	const cv::Mat& grayScan,
+	const TraceRegistrationSettings& settings,
+	ScanPyramid& pyramid)
+{
+	pyramid = ScanPyramid();
+	cv::buildPyramid(grayScan, pyramid.levels, (std::max)(settings.numLevels, 1) - 1);
+
+	if (settings.dictionary.empty())
+	{
+		return;
+	}
+
+	const int level = (std::min)(settings.detectionLevel, (int)pyramid.levels.size() - 1);
+	cv::Ptr<cv::aruco::DetectorParameters> params = cv::aruco::DetectorParameters::create();
+	params->cornerRefinementMethod = cv::aruco::CORNER_REFINE_SUBPIX;
+	cv::aruco::detectMarkers(
+		pyramid.levels[level],
+		settings.dictionary,
+		pyramid.markers,
+		pyramid.markerIds,
+		params);
+
+	const float scale = (float)(1 << level);
+	for (auto& marker : pyramid.markers)
+	{
+		for (auto& corner : marker)
+		{
+			corner *= scale;
+		}
+	}
+}
+
+void RegisterTrace(
+	const ScanPyramid& trace,
+	const ScanPyramid& truth,
+	const TraceRegistrationSettings& settings,
+	TraceRegistration& registration)
+{
+	registration = TraceRegistration();
+	if (!InitializeFromMarkers(trace, truth, settings, registration))
+	{
+		InitializeFromFeatures(trace, truth, settings, registration);
+	}
+
+	const int numLevels = (int)(std::min)(trace.levels.size(), truth.levels.size());
+	const cv::TermCriteria criteria(
+		cv::TermCriteria::COUNT + cv::TermCriteria::EPS,
+		settings.maxIterations,
+		settings.epsilon);
+
+	cv::Mat truthLevel, traceLevel;
+	for (int level = numLevels - 1; level >= (std::max)(settings.finestLevel, 0); level--)
+	{
+		const double scale = 1.0 / (1 << level);
+		cv::GaussianBlur(truth.levels[level], truthLevel, cv::Size(), RefinementBlurSigma);
+		cv::GaussianBlur(trace.levels[level], traceLevel, cv::Size(), RefinementBlurSigma);
+
+		cv::Mat warp;
+		cv::Mat(ScaleWarp(registration.warp, scale)).convertTo(warp, CV_32F);
+		try
+		{
+			registration.correlation = cv::findTransformECC(
+				truthLevel,
+				traceLevel,
+				warp,
+				cv::MOTION_EUCLIDEAN,
+				criteria,
+				cv::noArray());
+		}
+		catch (const cv::Exception&)
+		{
+			// Not converged on this level, keep the previous estimate
+			continue;
+		}
+
+		cv::Mat refined;
+		warp.convertTo(refined, CV_64F);
+		registration.warp = ScaleWarp(cv::Matx23d(refined.ptr<double>()), 1.0 / scale);
+	}
+}
+
+void WarpTrace(
+	const cv::Mat& grayTrace,
+	const TraceRegistration& registration,
+	const cv::Size& truthSize,
+	cv::Mat& registered)
+{
+	cv::warpAffine(
+		grayTrace,
+		registered,
+		cv::Mat(registration.warp),
+		truthSize,
+		cv::INTER_LINEAR | cv::WARP_INVERSE_MAP,
+		cv::BORDER_CONSTANT,
+		cv::Scalar(255));
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <opencv2/aruco.hpp>
+#include <opencv2/core.hpp>
+
+struct TraceRegistrationSettings
+{
+	// Markers printed on the trace template
+	cv::Ptr<cv::aruco::Dictionary> dictionary;
+
+	// Pyramid levels, level 0 is the scan and each level halves the
+	// previous one. Markers and features are detected on the detection
+	// level, intensity refinement runs from the coarsest level down to
+	// the finest level. The full resolution scan is only warped once.
+	int numLevels = 4;
+	int detectionLevel = 2;
+	int finestLevel = 1;
+
+	// Per-level termination of the intensity refinement
+	int maxIterations = 50;
+	double epsilon = 1e-5;
+
+	// Largest RMS distance (scan pixels) of the marker corners after the
+	// rigid fit, larger residuals fall back to feature matching
+	double maxMarkerResidual = 20.0;
+};
+
+// Scan prepared for registration: its Gaussian pyramid and the markers
+// detected on the detection level (corners in scan pixels)
+struct ScanPyramid
+{
+	std::vector<cv::Mat> levels;
+	std::vector<int> markerIds;
+	std::vector<std::vector<cv::Point2f>> markers;
+};
+
+void BuildScanPyramid(
+	const cv::Mat& grayScan,
+	const TraceRegistrationSettings& settings,
+	ScanPyramid& pyramid);
+
+enum class RegistrationInitialization
+{
+	None,
+	Markers,
+	Features
+};
+
+// Rigid transform of truth pixels to trace pixels (rotation and
+// translation, scans share the resolution)
+struct TraceRegistration
+{
+	cv::Matx23d warp = cv::Matx23d(1.0, 0.0, 0.0, 0.0, 1.0, 0.0);
+	RegistrationInitialization initialization = RegistrationInitialization::None;
+	int numMarkers = 0;
+
+	// Correlation coefficient of the finest level the refinement
+	// converged on, 0 if it converged on none
+	double correlation = 0.0;
+};
+
+const char* ToString(RegistrationInitialization initialization);
+
+// Coarse-to-fine registration of a trace to its truth (register_images.m,
+// imregister 'rigid'). The transform is initialized from the markers
+// both scans share, or from matched ORB features if they share none, and
+// refined with the enhanced correlation coefficient on the pyramid levels.
+void RegisterTrace(
+	const ScanPyramid& trace,
+	const ScanPyramid& truth,
+	const TraceRegistrationSettings& settings,
+	TraceRegistration& registration);
+
+// Trace resampled into the truth frame at full resolution, the area
+// outside the trace is paper white
+void WarpTrace(
+	const cv::Mat& grayTrace,
+	const TraceRegistration& registration,
+	const cv::Size& truthSize,
+	cv::Mat& registered);
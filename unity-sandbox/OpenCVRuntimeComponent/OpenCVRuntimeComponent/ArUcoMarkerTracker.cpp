@@ -3,6 +3,7 @@
 #include "DetectedArUcoMarker.h"
 #include <iostream>
 #include "CvUtils.h"
+#include "GeneratedBoards.h"
 #include <Trace.h>
 
 
@@ -29,6 +30,13 @@ namespace OpenCVRuntimeComponent
 			_nMarkers = numMarkers;
 			_dictId = dictId;
 			_customObjectPoints = customObjectPoints;
+			_boardFrameIndex = 0;
+			_markersFrameIndex = 0;
+			_boardsFrameIndex = 0;
+			_lastDetectedBoard = nullptr;
+			_lastDetectedMarkers = nullptr;
+			_lastDetectedBoards = nullptr;
+			_markerPoseEstimator.SetMarkerLength(markerSize);
 		}
 
 		/// <summary>
@@ -41,6 +49,27 @@ namespace OpenCVRuntimeComponent
 		IVector<DetectedArUcoMarker^>^ ArUcoMarkerTracker::DetectArUcoMarkersInFrame(
 			Windows::Graphics::Imaging::SoftwareBitmap^ softwareBitmap,
 			OpenCVRuntimeComponent::CameraCalibrationParams^ cameraCalibrationParameters)
+		{
+			// Without a capture time repeated frames are recognized by
+			// the sparse hash of their pixels
+			return DetectArUcoMarkersInFrameAtTime(
+				softwareBitmap,
+				cameraCalibrationParameters,
+				Windows::Foundation::TimeSpan{ 0 });
+		}
+
+		/// <summary>
+		/// Detect aruco markers in a frame with a known capture time, the
+		/// time is returned with every detected marker.
+		/// </summary>
+		/// <param name="softwareBitmap"></param>
+		/// <param name="cameraCalibrationParameters"></param>
+		/// <param name="captureTime"></param>
+		/// <returns></returns>
+		IVector<DetectedArUcoMarker^>^ ArUcoMarkerTracker::DetectArUcoMarkersInFrameAtTime(
+			Windows::Graphics::Imaging::SoftwareBitmap^ softwareBitmap,
+			OpenCVRuntimeComponent::CameraCalibrationParams^ cameraCalibrationParameters,
+			Windows::Foundation::TimeSpan captureTime)
 		{
 			// Clear the prior interface vector containing
 			// detected aruco markers
@@ -50,10 +79,16 @@ namespace OpenCVRuntimeComponent
 			// If null sensor frame, return zero detections
 			if (softwareBitmap == nullptr)
 			{
+				{
+					std::lock_guard<std::mutex> lock(_poseLock);
+					_markersFrameIndex++;
+				}
+
 				DetectedArUcoMarker^ zeroMarker = ref new DetectedArUcoMarker(
 					0,
 					Windows::Foundation::Numerics::float3::zero(),
 					Windows::Foundation::Numerics::float3::zero());
+				zeroMarker->Timestamp = captureTime;
 				detectedMarkers->Append(zeroMarker);
 				return detectedMarkers;
 			}
@@ -63,6 +98,25 @@ namespace OpenCVRuntimeComponent
 			std::vector<std::vector<cv::Point2f>> markers, rejectedCandidates;
 			std::vector<int32_t> markerIds;
 
+			// Use wrapper method to get cv::Mat from sensor frame
+			// Can I directly stream gray frames from pv camera?
+			const FrameView frame = OpenCVRuntimeComponent::ConversionUtils::WrapHoloLensSoftwareBitmapWithCvMat(softwareBitmap, wrappedMat);
+
+			// A frame handed in again returns the result of its first detection
+			const FrameIdentity frameIdentity = FrameIdentity::Of(wrappedMat, captureTime.Duration);
+			if (_lastDetectedMarkers != nullptr && frameIdentity.IsSameFrame(_markersFrameIdentity))
+			{
+				dbg::trace(L"ArUcoMarkerTracker::DetectArUcoMarkersInFrame: repeated frame, returning cached markers.");
+				return _lastDetectedMarkers;
+			}
+			_markersFrameIdentity = frameIdentity;
+
+			int64_t frameIndex;
+			{
+				std::lock_guard<std::mutex> lock(_poseLock);
+				frameIndex = ++_markersFrameIndex;
+			}
+
 			// Create the aruco dictionary from id
 			cv::Ptr<cv::aruco::Dictionary> dictionary =
 				cv::aruco::getPredefinedDictionary(_dictId);
@@ -71,10 +125,6 @@ namespace OpenCVRuntimeComponent
 			cv::Ptr<cv::aruco::DetectorParameters> detectorParams
 				= cv::aruco::DetectorParameters::create();
 
-			// Use wrapper method to get cv::Mat from sensor frame
-			// Can I directly stream gray frames from pv camera?
-			OpenCVRuntimeComponent::ConversionUtils::WrapHoloLensSoftwareBitmapWithCvMat(softwareBitmap, wrappedMat);
-
 			// Convert cv::Mat to grayscale for detection
 			cv::Mat grayMat;
 			cv::cvtColor(wrappedMat, grayMat, cv::COLOR_BGRA2GRAY);
@@ -107,15 +157,44 @@ namespace OpenCVRuntimeComponent
 				// Vectors for pose (translation and rotation) estimation
 				std::vector<cv::Vec3d> rVecs;
 				std::vector<cv::Vec3d> tVecs;
+				std::vector<uchar> isSolved;
 
-				// Estimate pose of single markers
-				cv::aruco::estimatePoseSingleMarkers(
+				// Estimate pose of single markers, closed form and in
+				// parallel for many markers
+				const int numSolved = _markerPoseEstimator.Estimate(
 					markers,
-					_markerSize,
+					markerIds,
 					cameraMatrix,
 					distortionCoefficientsMatrix,
 					rVecs,
-					tVecs);
+					tVecs,
+					isSolved);
+
+				// Markers without a pose are not published, fused or drawn
+				if (numSolved < (int)markerIds.size())
+				{
+					dbg::trace(
+						L"ArUcoMarkerTracker::DetectArUcoMarkersInFrame: no pose for %i markers",
+						(int)markerIds.size() - numSolved);
+
+					size_t kept = 0;
+					for (size_t i = 0; i < markerIds.size(); i++)
+					{
+						if (!isSolved[i])
+						{
+							continue;
+						}
+						markers[kept] = markers[i];
+						markerIds[kept] = markerIds[i];
+						rVecs[kept] = rVecs[i];
+						tVecs[kept] = tVecs[i];
+						kept++;
+					}
+					markers.resize(kept);
+					markerIds.resize(kept);
+					rVecs.resize(kept);
+					tVecs.resize(kept);
+				}
 
 				// Iterate across the detected marker ids and cache information of 
 				// pose of each marker as well as marker id
@@ -124,6 +203,12 @@ namespace OpenCVRuntimeComponent
 					//cv::Mat rMat;
 					//cv::Rodrigues(rVecs[i], rMat);
 
+					// Cache the pose for multi-frame fusion
+					{
+						std::lock_guard<std::mutex> lock(_poseLock);
+						_markerPoses[markerIds[i]].Push(frameIndex, rVecs[i], tVecs[i]);
+					}
+
 					// Create marker WinRT marker class instance with current
 					// detected marker parameters and view to unity transform
 					DetectedArUcoMarker^ marker = ref new DetectedArUcoMarker(
@@ -131,11 +216,38 @@ namespace OpenCVRuntimeComponent
 						Windows::Foundation::Numerics::float3((float)tVecs[i][0], (float)tVecs[i][1], (float)tVecs[i][2]),
 						Windows::Foundation::Numerics::float3((float)rVecs[i][0], (float)rVecs[i][1], (float)rVecs[i][2]));
 
+					// Quality of the pose from the four marker corners
+					marker->Quality = ToPoseQualityMetrics(ComputePoseQuality(
+						_markerPoseEstimator.ObjectPoints(),
+						markers[i],
+						cameraMatrix,
+						distortionCoefficientsMatrix,
+						rVecs[i],
+						tVecs[i]));
+					marker->FrameSequence = frameIndex;
+					marker->Timestamp = captureTime;
+
 			// Add the marker to interface vector of markers
 					detectedMarkers->Append(marker);
 				}
+
+				_overlayRenderer.Submit(
+					wrappedMat,
+					frameIndex,
+					markers,
+					markerIds,
+					rVecs,
+					tVecs,
+					cameraMatrix,
+					distortionCoefficientsMatrix,
+					_markerSize);
+			}
+			else
+			{
+				_markerPoseEstimator.Reset();
 			}
 
+			_lastDetectedMarkers = detectedMarkers;
 			return detectedMarkers;
 		}
 
@@ -145,24 +257,234 @@ namespace OpenCVRuntimeComponent
 		DetectedArUcoBoard^ ArUcoMarkerTracker::DetectBoardInFrame(
 			Windows::Graphics::Imaging::SoftwareBitmap^ softwareBitmap,
 			OpenCVRuntimeComponent::CameraCalibrationParams^ cameraCalibrationParameters)
+		{
+			// Without a capture time repeated frames are recognized by
+			// the sparse hash of their pixels
+			return DetectBoardInFrameAtTime(
+				softwareBitmap,
+				cameraCalibrationParameters,
+				Windows::Foundation::TimeSpan{ 0 });
+		}
+
+		/// <summary>
+		/// Detect the ArUco board in a frame with a known capture time
+		/// (system relative time of the media frame), repeated frames
+		/// are recognized by their timestamp.
+		/// </summary>
+		/// <param name="softwareBitmap"></param>
+		/// <param name="cameraCalibrationParameters"></param>
+		/// <param name="captureTime"></param>
+		/// <returns></returns>
+		DetectedArUcoBoard^ ArUcoMarkerTracker::DetectBoardInFrameAtTime(
+			Windows::Graphics::Imaging::SoftwareBitmap^ softwareBitmap,
+			OpenCVRuntimeComponent::CameraCalibrationParams^ cameraCalibrationParameters,
+			Windows::Foundation::TimeSpan captureTime)
+		{
+			// Use wrapper method to get cv::Mat from sensor frame
+			// Can I directly stream gray frames from pv camera?
+			cv::Mat wrappedMat;
+			const FrameView frame = OpenCVRuntimeComponent::ConversionUtils::WrapHoloLensSoftwareBitmapWithCvMat(softwareBitmap, wrappedMat);
+
+			return DetectBoardInImage(
+				wrappedMat,
+				cameraCalibrationParameters,
+				captureTime);
+		}
+
+		/// <summary>
+		/// Detect the ArUco board in an image (BGRA) that stays valid for
+		/// the duration of the call, frames queued for parallel detection
+		/// enter here.
+		/// </summary>
+		/// <param name="wrappedMat"></param>
+		/// <param name="cameraCalibrationParameters"></param>
+		/// <param name="captureTime"></param>
+		/// <returns></returns>
+		DetectedArUcoBoard^ ArUcoMarkerTracker::DetectBoardInImage(
+			const cv::Mat& wrappedMat,
+			OpenCVRuntimeComponent::CameraCalibrationParams^ cameraCalibrationParameters,
+			Windows::Foundation::TimeSpan captureTime)
 		{
 			auto detectedBoard = ref new DetectedArUcoBoard(
 				Windows::Foundation::Numerics::float3::zero(),
 				Windows::Foundation::Numerics::float3::zero(),
 				false); // no board detected
 
-			if (softwareBitmap == nullptr)
+			if (wrappedMat.empty())
 			{
+				std::lock_guard<std::mutex> lock(_poseLock);
+				_boardFrameIndex++;
 				return detectedBoard;
 			}
 
+			// A frame handed in again returns the result of its first detection
+			const FrameIdentity frameIdentity = FrameIdentity::Of(wrappedMat, captureTime.Duration);
+			if (_lastDetectedBoard != nullptr && frameIdentity.IsSameFrame(_boardFrameIdentity))
+			{
+				dbg::trace(L"ArUcoMarkerTracker::DetectBoardInFrame: repeated frame, returning cached board.");
+				return _lastDetectedBoard;
+			}
+			_boardFrameIdentity = frameIdentity;
+
+			int64_t frameIndex;
+			{
+				std::lock_guard<std::mutex> lock(_poseLock);
+				frameIndex = ++_boardFrameIndex;
+			}
+
+			// The board layout does not change between frames, create
+			// the board object once
+			EnsureCustomBoard();
+
+			// Set camera intrinsic parameters and distortion matrix for
+			// aruco based pose estimation
+			cv::Mat cameraMatrix = FormatCameraMatrix(cameraCalibrationParameters);
+			cv::Mat distortionCoefficientsMatrix = FormatDistortionCoefficientsMatrix(cameraCalibrationParameters);
+
 			// https://docs.opencv.org/4.1.1/d5/dae/tutorial_aruco_detection.html
-			cv::Mat wrappedMat;
-			std::vector<int32_t> markerIds;
-			std::vector<std::vector<cv::Point2f>> markers, rejectedCandidates;
+			// Motion gate, corner tracking or marker detection at the
+			// current quality level, then the board pose
+			BoardFrameResult result;
+			_pipeline.Process(
+				wrappedMat,
+				cameraMatrix,
+				distortionCoefficientsMatrix,
+				result);
+
+			// While the board region is static, the last detected board
+			// pose is reused
+			if (result.isSkipped)
+			{
+				dbg::trace(
+					L"ArUcoMarkerTracker::DetectBoardInFrame: static frame (difference %f), reusing last board pose.",
+					_pipeline.MotionGating().LastDifference());
+				_lastDetectedBoard = ReuseBoardForFrame(_lastDetectedBoard, frameIndex, captureTime);
+				return _lastDetectedBoard;
+			}
+
+			if (result.isTracked)
+			{
+				dbg::trace(
+					L"ArUcoMarkerTracker::DetectBoardInFrame: %i markers tracked (forward-backward error %f)",
+					result.markerIds.size(),
+					_pipeline.CornerTracking().LastForwardBackwardError());
+			}
+			else if (!_pipeline.QualityControl().IsEnabled())
+			{
+				const CandidateStatistics& statistics = _pipeline.DetectorTuning().LastStatistics();
+				dbg::trace(
+					L"ArUcoMarkerTracker::DetectBoardInFrame: %i markers found, %i accepted, %i rejected candidates, perimeter %f - %f px, windows %i - %i",
+					result.markerIds.size(),
+					statistics.numAccepted,
+					statistics.numRejected,
+					statistics.minPerimeter,
+					statistics.maxPerimeter,
+					_pipeline.DetectorTuning().Parameters()->adaptiveThreshWinSizeMin,
+					_pipeline.DetectorTuning().Parameters()->adaptiveThreshWinSizeMax);
+			}
+			else
+			{
+				dbg::trace(
+					L"ArUcoMarkerTracker::DetectBoardInFrame: %i markers found (quality level %i)",
+					result.markerIds.size(),
+					_pipeline.QualityControl().Level());
+			}
+
+			// If we have detected the board, compute the transform
+			// to relate WinRT (right-handed row-vector) and Unity
+			// (left-handed column-vector) representations for transforms
+			// WinRT transfrom -> Unity transform by transpose and flip z values
+			std::vector<cv::Vec3d> overlayRVecs;
+			std::vector<cv::Vec3d> overlayTVecs;
+			if (result.isDetected)
+			{
+				dbg::trace(
+					L"ArUcoMarkerTracker::DetectBoardInFrame: detected an ArUco board object.");
+
+				const cv::Vec3d& rVecs = result.rVec;
+				const cv::Vec3d& tVecs = result.tVec;
+
+				// Cache the pose for multi-frame fusion
+				{
+					std::lock_guard<std::mutex> lock(_poseLock);
+					_boardPoses.Push(frameIndex, rVecs, tVecs);
+				}
+
+				// Create marker WinRT marker class instance with current
+				// detected board parameters and view to unity transform
+				DetectedArUcoBoard^ board = ref new DetectedArUcoBoard(
+					Windows::Foundation::Numerics::float3((float)tVecs[0], (float)tVecs[1], (float)tVecs[2]),
+					Windows::Foundation::Numerics::float3((float)rVecs[0], (float)rVecs[1], (float)rVecs[2]),
+					true); // board detected
+
+				// Quality of the pose from the markers of the board
+				board->Quality = ToPoseQualityMetrics(ComputeBoardPoseQuality(
+					_customBoard,
+					result.markers,
+					result.markerIds,
+					cameraMatrix,
+					distortionCoefficientsMatrix,
+					rVecs,
+					tVecs));
+
+				// Add the marker to interface vector of markers
+				detectedBoard = board;
+
+				overlayRVecs.push_back(rVecs);
+				overlayTVecs.push_back(tVecs);
+			}
+
+			detectedBoard->FrameSequence = frameIndex;
+			detectedBoard->Timestamp = captureTime;
+
+			// Board axes are drawn twice the marker size
+			_overlayRenderer.Submit(
+				wrappedMat,
+				frameIndex,
+				result.markers,
+				result.markerIds,
+				overlayRVecs,
+				overlayTVecs,
+				cameraMatrix,
+				distortionCoefficientsMatrix,
+				2.0 * _markerSize);
+
+			_lastDetectedBoard = detectedBoard;
+			return detectedBoard;
+		}
+
+		/// <summary>
+		/// Copy of a board result for a later frame that reuses its pose.
+		/// </summary>
+		DetectedArUcoBoard^ ArUcoMarkerTracker::ReuseBoardForFrame(
+			DetectedArUcoBoard^ board,
+			int64_t frameSequence,
+			Windows::Foundation::TimeSpan timestamp)
+		{
+			auto reused = ref new DetectedArUcoBoard(
+				board->Position,
+				board->Rotation,
+				board->IsDetected);
+			reused->BoardIndex = board->BoardIndex;
+			reused->Quality = board->Quality;
+			reused->FrameSequence = frameSequence;
+			reused->Timestamp = timestamp;
+			return reused;
+		}
+
+		/// <summary>
+		/// Create the board of the constructor parameters, the detector
+		/// state that depends on the dictionary is created with it.
+		/// </summary>
+		void ArUcoMarkerTracker::EnsureCustomBoard()
+		{
+			if (!_customBoard.empty())
+			{
+				return;
+			}
+
 			std::vector<std::vector<cv::Point3f>> objPoints;
 			std::vector<int32_t> boardIds;
-			cv::Ptr<cv::aruco::Board> customBoard;
 
 			// Set the custom object points for the board, force these
 			// parameters
@@ -178,83 +500,399 @@ namespace OpenCVRuntimeComponent
 				cv::aruco::getPredefinedDictionary(_dictId);
 
 			// Create the custom board
-			customBoard = cv::aruco::Board::create(
+			_customBoard = cv::aruco::Board::create(
 				objPoints,
 				dictionary,
 				boardIds);
 			dbg::trace(L"Created aruco custom board object.");
 
-			// Create detector parameters
-			cv::Ptr<cv::aruco::DetectorParameters> detectorParams
-				= cv::aruco::DetectorParameters::create();
+			// Boards of four markers solve their pose with fixed size arrays
+			_pipeline.SetBoard(_customBoard);
 
-			// Use wrapper method to get cv::Mat from sensor frame
-			// Can I directly stream gray frames from pv camera?
-			OpenCVRuntimeComponent::ConversionUtils::WrapHoloLensSoftwareBitmapWithCvMat(softwareBitmap, wrappedMat);
+			// The board of the constructor is board 0 of multi-board detection
+			_boards.push_back(RegisteredBoard{ _customBoard, 0, _nMarkers });
+		}
 
-			// Convert cv::Mat to grayscale for detection
-			cv::Mat grayMat;
-			cv::cvtColor(wrappedMat, grayMat, cv::COLOR_BGRA2GRAY);
+		/// <summary>
+		/// Register an additional board with its own marker size and layout
+		/// for multi-board detection. Markers of the board use the ids
+		/// firstMarkerId to firstMarkerId + number of object points - 1 of
+		/// the tracker dictionary.
+		/// </summary>
+		/// <param name="markerSize"></param>
+		/// <param name="firstMarkerId"></param>
+		/// <param name="customObjectPoints">Top left corner of each marker, as for the constructor board</param>
+		/// <returns>Index of the board in multi-board results, -1 if the id range is in use</returns>
+		/// <exception cref="Platform::InvalidArgumentException">customObjectPoints is null or empty</exception>
+		int ArUcoMarkerTracker::RegisterBoard(
+			float markerSize,
+			int firstMarkerId,
+			IVector<float3>^ customObjectPoints)
+		{
+			if (customObjectPoints == nullptr || customObjectPoints->Size == 0)
+			{
+				throw ref new Platform::InvalidArgumentException(
+					L"ArUcoMarkerTracker::RegisterBoard: customObjectPoints must hold a point per marker.");
+			}
 
-			// Detect markers
-			cv::aruco::detectMarkers(
-				grayMat,
-				dictionary,
-				markers,
-				markerIds,
-				detectorParams,
-				rejectedCandidates);
+			EnsureCustomBoard();
 
-			dbg::trace(
-				L"ArUcoMarkerTracker::DetectBoardInFrame: %i markers found",
-				markerIds.size());
+			const int numMarkers = (int)customObjectPoints->Size;
+			for (const RegisteredBoard& registered : _boards)
+			{
+				if (firstMarkerId < registered.firstMarkerId + registered.numMarkers &&
+					registered.firstMarkerId < firstMarkerId + numMarkers)
+				{
+					dbg::trace(
+						L"ArUcoMarkerTracker::RegisterBoard: marker ids %i - %i overlap a registered board.",
+						firstMarkerId,
+						firstMarkerId + numMarkers - 1);
+					return -1;
+				}
+			}
 
-			// If we have detected markers, compute the transform
-			// to relate WinRT (right-handed row-vector) and Unity
-			// (left-handed column-vector) representations for transforms
-			// WinRT transfrom -> Unity transform by transpose and flip z values
-			if (markerIds.size() > 1)
+			std::vector<std::vector<cv::Point3f>> objPoints;
+			std::vector<int32_t> boardIds;
+			for (int i = 0; i < numMarkers; i++)
 			{
-				// Set camera intrinsic parameters for aruco based pose estimation
-				cv::Mat cameraMatrix = FormatCameraMatrix(cameraCalibrationParameters);
+				const float3 p = customObjectPoints->GetAt(i);
+				objPoints.push_back(FillPositions(markerSize, cv::Point3f(p.x, p.y, p.z)));
+				boardIds.push_back(firstMarkerId + i);
+			}
 
-				// Set distortion matrix for aruco based pose estimation
-				cv::Mat distortionCoefficientsMatrix = FormatDistortionCoefficientsMatrix(cameraCalibrationParameters);
+			_boards.push_back(RegisteredBoard{
+				cv::aruco::Board::create(objPoints, _customBoard->dictionary, boardIds),
+				firstMarkerId,
+				numMarkers });
 
-				// Vectors for pose (translation and rotation) estimation
-				cv::Vec3d rVecs;
-				cv::Vec3d tVecs;
+			return (int)_boards.size() - 1;
+		}
 
-				// Estimate pose of the custom board
-				int valid = cv::aruco::estimatePoseBoard(
-					markers, markerIds,
-					customBoard,
-					cameraMatrix,
-					distortionCoefficientsMatrix,
-					rVecs, tVecs);
+		/// <summary>
+		/// Detect the markers of all registered boards in a single pass
+		/// and estimate the pose of each board from its own markers.
+		/// </summary>
+		/// <param name="softwareBitmap"></param>
+		/// <param name="cameraCalibrationParameters"></param>
+		/// <returns>One result per registered board, in board index order</returns>
+		IVector<DetectedArUcoBoard^>^ ArUcoMarkerTracker::DetectBoardsInFrame(
+			Windows::Graphics::Imaging::SoftwareBitmap^ softwareBitmap,
+			OpenCVRuntimeComponent::CameraCalibrationParams^ cameraCalibrationParameters)
+		{
+			return DetectBoardsInFrameAtTime(
+				softwareBitmap,
+				cameraCalibrationParameters,
+				Windows::Foundation::TimeSpan{ 0 });
+		}
+
+		/// <summary>
+		/// Multi-board detection in a frame with a known capture time, the
+		/// time is returned with every board result.
+		/// </summary>
+		/// <param name="softwareBitmap"></param>
+		/// <param name="cameraCalibrationParameters"></param>
+		/// <param name="captureTime"></param>
+		/// <returns>One result per registered board, in board index order</returns>
+		IVector<DetectedArUcoBoard^>^ ArUcoMarkerTracker::DetectBoardsInFrameAtTime(
+			Windows::Graphics::Imaging::SoftwareBitmap^ softwareBitmap,
+			OpenCVRuntimeComponent::CameraCalibrationParams^ cameraCalibrationParameters,
+			Windows::Foundation::TimeSpan captureTime)
+		{
+			EnsureCustomBoard();
+
+			Windows::Foundation::Collections::IVector<ArUcoTracking::DetectedArUcoBoard^>^ detectedBoards
+				= ref new Platform::Collections::Vector<ArUcoTracking::DetectedArUcoBoard^>();
+
+			// Markers of all boards from one detection
+			std::vector<int32_t> markerIds;
+			std::vector<std::vector<cv::Point2f>> markers, rejectedCandidates;
+			cv::Mat wrappedMat;
+			FrameView frame;
+			if (softwareBitmap != nullptr)
+			{
+				frame = OpenCVRuntimeComponent::ConversionUtils::WrapHoloLensSoftwareBitmapWithCvMat(softwareBitmap, wrappedMat);
+
+				// A frame handed in again returns the result of its first detection
+				const FrameIdentity frameIdentity = FrameIdentity::Of(wrappedMat, captureTime.Duration);
+				if (_lastDetectedBoards != nullptr && frameIdentity.IsSameFrame(_boardsFrameIdentity))
+				{
+					dbg::trace(L"ArUcoMarkerTracker::DetectBoardsInFrame: repeated frame, returning cached boards.");
+					return _lastDetectedBoards;
+				}
+				_boardsFrameIdentity = frameIdentity;
+			}
+
+			int64_t frameIndex;
+			{
+				std::lock_guard<std::mutex> lock(_poseLock);
+				frameIndex = ++_boardsFrameIndex;
+			}
 
-				//cv::Mat rMat;
-				//cv::Rodrigues(rVecs, rMat);
+			if (softwareBitmap != nullptr)
+			{
+				cv::Mat grayMat;
+				cv::cvtColor(wrappedMat, grayMat, cv::COLOR_BGRA2GRAY);
 
-				// If one board marker detected
-				if (valid > 0)
+				_pipeline.DetectorTuning().Detect(
+					grayMat,
+					_customBoard->dictionary,
+					markers,
+					markerIds,
+					rejectedCandidates);
+
+				dbg::trace(
+					L"ArUcoMarkerTracker::DetectBoardsInFrame: %i markers found",
+					markerIds.size());
+			}
+
+			cv::Mat cameraMatrix;
+			cv::Mat distortionCoefficientsMatrix;
+			if (!markerIds.empty())
+			{
+				cameraMatrix = FormatCameraMatrix(cameraCalibrationParameters);
+				distortionCoefficientsMatrix = FormatDistortionCoefficientsMatrix(cameraCalibrationParameters);
+			}
+
+			for (size_t b = 0; b < _boards.size(); b++)
+			{
+				const RegisteredBoard& registered = _boards[b];
+
+				// Assign the markers in the id range of the board
+				std::vector<int32_t> boardMarkerIds;
+				std::vector<std::vector<cv::Point2f>> boardMarkers;
+				for (size_t i = 0; i < markerIds.size(); i++)
 				{
-					dbg::trace(
-						L"ArUcoMarkerTracker::DetectBoardInFrame: detected an ArUco board object.");
+					if (markerIds[i] >= registered.firstMarkerId &&
+						markerIds[i] < registered.firstMarkerId + registered.numMarkers)
+					{
+						boardMarkerIds.push_back(markerIds[i]);
+						boardMarkers.push_back(markers[i]);
+					}
+				}
 
-					// Create marker WinRT marker class instance with current
-					// detected board parameters and view to unity transform
-					DetectedArUcoBoard^ board = ref new DetectedArUcoBoard(
-						Windows::Foundation::Numerics::float3((float)tVecs[0], (float)tVecs[1], (float)tVecs[2]),
-						Windows::Foundation::Numerics::float3((float)rVecs[0], (float)rVecs[1], (float)rVecs[2]),
-						true); // board detected
-
-					// Add the marker to interface vector of markers
-					detectedBoard = board;
+				auto detectedBoard = ref new DetectedArUcoBoard(
+					Windows::Foundation::Numerics::float3::zero(),
+					Windows::Foundation::Numerics::float3::zero(),
+					false); // no board detected
+
+				if (boardMarkerIds.size() > 1)
+				{
+					cv::Vec3d rVecs;
+					cv::Vec3d tVecs;
+
+					int valid = b == 0
+						? _pipeline.EstimatePose(
+							boardMarkers, boardMarkerIds,
+							cameraMatrix,
+							distortionCoefficientsMatrix,
+							rVecs, tVecs)
+						: cv::aruco::estimatePoseBoard(
+							boardMarkers, boardMarkerIds,
+							registered.board,
+							cameraMatrix,
+							distortionCoefficientsMatrix,
+							rVecs, tVecs);
+
+					if (valid > 0)
+					{
+						detectedBoard = ref new DetectedArUcoBoard(
+							Windows::Foundation::Numerics::float3((float)tVecs[0], (float)tVecs[1], (float)tVecs[2]),
+							Windows::Foundation::Numerics::float3((float)rVecs[0], (float)rVecs[1], (float)rVecs[2]),
+							true); // board detected
+
+						detectedBoard->Quality = ToPoseQualityMetrics(ComputeBoardPoseQuality(
+							registered.board,
+							boardMarkers,
+							boardMarkerIds,
+							cameraMatrix,
+							distortionCoefficientsMatrix,
+							rVecs,
+							tVecs));
+					}
 				}
+
+				detectedBoard->BoardIndex = (int)b;
+				detectedBoard->FrameSequence = frameIndex;
+				detectedBoard->Timestamp = captureTime;
+				detectedBoards->Append(detectedBoard);
 			}
 
-			return detectedBoard;
+			if (softwareBitmap != nullptr)
+			{
+				_lastDetectedBoards = detectedBoards;
+			}
+			return detectedBoards;
+		}
+
+		/// <summary>
+		/// Configure the narrowing of the detector parameters to the
+		/// threshold windows and marker sizes found in recent frames.
+		/// </summary>
+		/// <param name="isEnabled"></param>
+		/// <param name="rewidenPeriod">The full parameter range is probed again every rewidenPeriod frames</param>
+		void ArUcoMarkerTracker::ConfigureDetectorTuning(
+			bool isEnabled,
+			int rewidenPeriod)
+		{
+			_pipeline.DetectorTuning().Configure(isEnabled, rewidenPeriod);
+		}
+
+		/// <summary>
+		/// Configure the controller that adapts the detection settings to
+		/// keep the per-frame processing time within a latency budget.
+		/// </summary>
+		/// <param name="isEnabled"></param>
+		/// <param name="budgetMilliseconds"></param>
+		void ArUcoMarkerTracker::ConfigureQualityControl(
+			bool isEnabled,
+			float budgetMilliseconds)
+		{
+			_pipeline.QualityControl().Configure(isEnabled, budgetMilliseconds);
+		}
+
+		/// <summary>
+		/// Scale the measured stage timings reported to the quality
+		/// controller, emulates a throttled device.
+		/// </summary>
+		/// <param name="factor"></param>
+		void ArUcoMarkerTracker::SetInjectedSlowdown(float factor)
+		{
+			_pipeline.QualityControl().SetInjectedSlowdown(factor);
+		}
+
+		int ArUcoMarkerTracker::QualityLevel::get()
+		{
+			return _pipeline.QualityControl().Level();
+		}
+
+		/// <summary>
+		/// Configure the debug preview of the detections, drawn on a low
+		/// priority worker into recycled bitmaps.
+		/// </summary>
+		/// <param name="isEnabled"></param>
+		/// <param name="maxFramesPerSecond">Frames arriving faster are not drawn</param>
+		void ArUcoMarkerTracker::ConfigureOverlay(
+			bool isEnabled,
+			float maxFramesPerSecond)
+		{
+			_overlayRenderer.Configure(isEnabled, maxFramesPerSecond);
+		}
+
+		SoftwareBitmap^ ArUcoMarkerTracker::LatestOverlay()
+		{
+			int64_t frameSequence;
+			return _overlayRenderer.LatestOverlay(frameSequence);
+		}
+
+		/// <summary>
+		/// Configure the motion gate that skips board detection on frames
+		/// where the board region has not changed.
+		/// </summary>
+		/// <param name="isEnabled"></param>
+		/// <param name="threshold">Mean absolute gray level difference of the downsampled board region</param>
+		/// <param name="refreshPeriod">Detection is forced at least every refreshPeriod frames</param>
+		void ArUcoMarkerTracker::ConfigureMotionGating(
+			bool isEnabled,
+			float threshold,
+			int refreshPeriod)
+		{
+			_pipeline.MotionGating().Configure(isEnabled, threshold, refreshPeriod);
+		}
+
+		/// <summary>
+		/// Configure optical flow tracking of the board marker corners
+		/// between full marker detections.
+		/// </summary>
+		/// <param name="isEnabled"></param>
+		/// <param name="redetectPeriod">Full detection is run at least every redetectPeriod frames</param>
+		/// <param name="maxForwardBackwardError">Markers with a larger corner forward-backward error (pixels) are dropped</param>
+		/// <param name="minTrackedFraction">Fraction of the detected markers required to keep tracking</param>
+		void ArUcoMarkerTracker::ConfigureCornerTracking(
+			bool isEnabled,
+			int redetectPeriod,
+			float maxForwardBackwardError,
+			float minTrackedFraction)
+		{
+			_pipeline.CornerTracking().Configure(
+				isEnabled,
+				redetectPeriod,
+				maxForwardBackwardError,
+				minTrackedFraction);
+		}
+
+		/// <summary>
+		/// Fuse the board poses detected within the last numFrames frames,
+		/// rejecting outliers, to reduce detection jitter in a single pose.
+		/// </summary>
+		/// <param name="numFrames"></param>
+		/// <returns></returns>
+		FusedArUcoPose^ ArUcoMarkerTracker::FuseBoardPoses(int numFrames)
+		{
+			FusedPose fused;
+			{
+				std::lock_guard<std::mutex> lock(_poseLock);
+				fused = _boardPoses.Fuse(_boardFrameIndex, numFrames);
+			}
+
+			return ToFusedArUcoPose(fused);
+		}
+
+		/// <summary>
+		/// Fuse the poses of a single marker detected within the last
+		/// numFrames frames, rejecting outliers.
+		/// </summary>
+		/// <param name="markerId"></param>
+		/// <param name="numFrames"></param>
+		/// <returns></returns>
+		FusedArUcoPose^ ArUcoMarkerTracker::FuseMarkerPoses(int markerId, int numFrames)
+		{
+			FusedPose fused;
+			{
+				std::lock_guard<std::mutex> lock(_poseLock);
+				auto markerPoses = _markerPoses.find(markerId);
+				if (markerPoses != _markerPoses.end())
+				{
+					fused = markerPoses->second.Fuse(_markersFrameIndex, numFrames);
+				}
+			}
+
+			return ToFusedArUcoPose(fused);
+		}
+
+		FusedArUcoPose^ ArUcoMarkerTracker::ToFusedArUcoPose(const FusedPose& fused)
+		{
+			dbg::trace(
+				L"ArUcoMarkerTracker::ToFusedArUcoPose: %i of %i poses fused, spread %f m, %f rad",
+				fused.numInliers, fused.numSamples, fused.positionSpread, fused.rotationSpread);
+
+			return ref new FusedArUcoPose(
+				Windows::Foundation::Numerics::float3((float)fused.tVec[0], (float)fused.tVec[1], (float)fused.tVec[2]),
+				Windows::Foundation::Numerics::float3((float)fused.rVec[0], (float)fused.rVec[1], (float)fused.rVec[2]),
+				(float)fused.positionSpread,
+				(float)fused.rotationSpread,
+				fused.numSamples,
+				fused.numInliers,
+				fused.isValid);
+		}
+
+		PoseQualityMetrics^ ArUcoMarkerTracker::ToPoseQualityMetrics(const PoseQuality& quality)
+		{
+			auto covariance = ref new Platform::Collections::Vector<float>();
+			for (int r = 0; r < 6; r++)
+			{
+				for (int c = 0; c < 6; c++)
+				{
+					covariance->Append((float)quality.covariance(r, c));
+				}
+			}
+
+			return ref new PoseQualityMetrics(
+				(float)quality.reprojectionRms,
+				quality.numMarkers,
+				quality.numCorners,
+				(float)quality.markerArea,
+				covariance,
+				quality.isValid);
 		}
 
 		// Fill object points structure with corner positions 
@@ -266,6 +904,18 @@ namespace OpenCVRuntimeComponent
 			//std::vector<int> markerIds;
 			//std::vector<std::vector<cv::Point3f>> objPoints;
 
+			// Without object points from the app, use the layout compiled
+			// from data/MarkerConfig/F.fcsv
+			if (_customObjectPoints == nullptr || _customObjectPoints->Size == 0)
+			{
+				BoardLayout layout = ToBoardLayout(Boards::F);
+				layout.markerLength = _markerSize;
+				BoardObjectPoints(layout, objPoints, markerIds);
+				_nMarkers = (int)markerIds.size();
+				dbg::trace(L"Using the compiled board layout with %i markers.", _nMarkers);
+				return;
+			}
+
 			// Fill board ids vector with marker ids from custom dictionary
 			// Assuming we start at index zero
 			for (int i = 0; i < _nMarkers; i++)
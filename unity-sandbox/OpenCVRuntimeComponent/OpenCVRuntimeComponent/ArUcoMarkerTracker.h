@@ -2,7 +2,17 @@
 
 #include <opencv2/aruco.hpp>
 #include <opencv2/core.hpp>
+#include <map>
+#include <mutex>
 #include"CameraCalibrationParams.h"
+#include "PoseFusion.h"
+#include "BoardDetectionPipeline.h"
+#include "MarkerPoseEstimator.h"
+#include "PoseQuality.h"
+#include "FrameIdentity.h"
+#include "OverlayRenderer.h"
+#include "FusedArUcoPose.h"
+#include "BoardLayout.h"
 
 using namespace Windows::Foundation::Collections;
 using namespace Windows::Foundation::Numerics;
@@ -12,6 +22,14 @@ namespace OpenCVRuntimeComponent
 {
 	namespace ArUcoTracking
 	{
+		// Board of multi-board detection and its marker id range
+		struct RegisteredBoard
+		{
+			cv::Ptr<cv::aruco::Board> board;
+			int firstMarkerId;
+			int numMarkers;
+		};
+
 		public ref class ArUcoMarkerTracker sealed 
 		{
 		public:
@@ -25,10 +43,96 @@ namespace OpenCVRuntimeComponent
 				SoftwareBitmap^ softwareBitmap,
 				OpenCVRuntimeComponent::CameraCalibrationParams^ cameraCalibrationParameters);
 
+			// Marker detection for a frame with known capture time, the
+			// markers carry it as their timestamp
+			IVector<DetectedArUcoMarker^>^ DetectArUcoMarkersInFrameAtTime(
+				SoftwareBitmap^ softwareBitmap,
+				OpenCVRuntimeComponent::CameraCalibrationParams^ cameraCalibrationParameters,
+				Windows::Foundation::TimeSpan captureTime);
+
 			DetectedArUcoBoard^ DetectBoardInFrame(
 				SoftwareBitmap^ softwareBitmap,
 				OpenCVRuntimeComponent::CameraCalibrationParams^ cameraCalibrationParameters);
 
+			// Board detection for a frame with known capture time, a frame
+			// with the same capture time as the last returns its result
+			DetectedArUcoBoard^ DetectBoardInFrameAtTime(
+				SoftwareBitmap^ softwareBitmap,
+				OpenCVRuntimeComponent::CameraCalibrationParams^ cameraCalibrationParameters,
+				Windows::Foundation::TimeSpan captureTime);
+
+			// Additional boards with their own layout and marker id range,
+			// returns the board index or -1 if the ids are in use
+			int RegisterBoard(
+				float markerSize,
+				int firstMarkerId,
+				IVector<float3>^ customObjectPoints);
+
+			// Poses of the constructor board (index 0) and all registered
+			// boards from a single marker detection
+			IVector<DetectedArUcoBoard^>^ DetectBoardsInFrame(
+				SoftwareBitmap^ softwareBitmap,
+				OpenCVRuntimeComponent::CameraCalibrationParams^ cameraCalibrationParameters);
+			IVector<DetectedArUcoBoard^>^ DetectBoardsInFrameAtTime(
+				SoftwareBitmap^ softwareBitmap,
+				OpenCVRuntimeComponent::CameraCalibrationParams^ cameraCalibrationParameters,
+				Windows::Foundation::TimeSpan captureTime);
+
+			// Skip board detection while the board region is static, off
+			// by default
+			void ConfigureMotionGating(
+				bool isEnabled,
+				float threshold,
+				int refreshPeriod);
+
+			// Track the board marker corners with optical flow between
+			// full detections, off by default
+			void ConfigureCornerTracking(
+				bool isEnabled,
+				int redetectPeriod,
+				float maxForwardBackwardError,
+				float minTrackedFraction);
+
+			// Narrow the detector parameters to what works for the
+			// current scene, re-widened every rewidenPeriod frames. Off by
+			// default.
+			void ConfigureDetectorTuning(
+				bool isEnabled,
+				int rewidenPeriod);
+
+			// Adapt detection settings to keep the per-frame processing
+			// time within budgetMilliseconds. The injected slowdown scales
+			// the measured timings to emulate a throttled device.
+			void ConfigureQualityControl(
+				bool isEnabled,
+				float budgetMilliseconds);
+			void SetInjectedSlowdown(float factor);
+
+			// Current quality level, 0 is full quality
+			property int QualityLevel { int get(); }
+
+			// Debug preview with the detections drawn, rendered off the
+			// detection thread at no more than maxFramesPerSecond
+			void ConfigureOverlay(
+				bool isEnabled,
+				float maxFramesPerSecond);
+
+			// Newest preview frame, null before the first one is drawn
+			SoftwareBitmap^ LatestOverlay();
+
+			// Robust average of the board or marker poses detected
+			// within the last numFrames frames processed by board or
+			// marker detection respectively.
+			FusedArUcoPose^ FuseBoardPoses(int numFrames);
+			FusedArUcoPose^ FuseMarkerPoses(int markerId, int numFrames);
+
+		internal:
+			// Board detection on an image wrapped or copied from a frame
+			DetectedArUcoBoard^ DetectBoardInImage(
+				const cv::Mat& wrappedMat,
+				OpenCVRuntimeComponent::CameraCalibrationParams^ cameraCalibrationParameters,
+				Windows::Foundation::TimeSpan captureTime);
+
 		private:
 			// Cached parameters for aruco marker detection
 			float _markerSize;
@@ -36,6 +140,52 @@ namespace OpenCVRuntimeComponent
 			int _nMarkers;
 			IVector<float3>^ _customObjectPoints;
 
+			// Index of the current frame of each detection method and the
+			// recent detected poses used for multi-frame pose fusion, fusion
+			// is requested from the app thread while frames are processed.
+			// Each pose history counts the frames of its own method, so
+			// calling several methods per frame keeps the fusion window.
+			std::mutex _poseLock;
+			int64_t _boardFrameIndex;
+			int64_t _markersFrameIndex;
+			int64_t _boardsFrameIndex;
+			PoseFusionBuffer _boardPoses;
+			std::map<int, PoseFusionBuffer> _markerPoses;
+
+			FusedArUcoPose^ ToFusedArUcoPose(const FusedPose& fused);
+			PoseQualityMetrics^ ToPoseQualityMetrics(const PoseQuality& quality);
+
+			// Single marker pose solver, keeps the marker rotations of the
+			// previous frame to resolve ambiguous poses
+			MarkerPoseEstimator _markerPoseEstimator;
+
+			// Board returned for frames the motion gate skips
+			DetectedArUcoBoard^ _lastDetectedBoard;
+
+			// Identity and result of the last frame of each detection
+			// method, repeated frames return the cached result
+			FrameIdentity _boardFrameIdentity;
+			FrameIdentity _markersFrameIdentity;
+			FrameIdentity _boardsFrameIdentity;
+			IVector<DetectedArUcoMarker^>^ _lastDetectedMarkers;
+			IVector<DetectedArUcoBoard^>^ _lastDetectedBoards;
+
+			DetectedArUcoBoard^ ReuseBoardForFrame(
+				DetectedArUcoBoard^ board,
+				int64_t frameSequence,
+				Windows::Foundation::TimeSpan timestamp);
+
+			// Board and the per-frame detection of the constructor board
+			// (motion gate, corner tracking, tuned detector, quality
+			// control and pose), state is reused across frames
+			cv::Ptr<cv::aruco::Board> _customBoard;
+			std::vector<RegisteredBoard> _boards;
+			BoardDetectionPipeline _pipeline;
+			void EnsureCustomBoard();
+
+			// Throttled debug preview of the detections
+			OverlayRenderer _overlayRenderer;
+
 			// Set the custom object points from Slicer for the ArUco board.
 			void SetCustomObjPoints(std::vector<std::vector<cv::Point3f>> &objPoints, std::vector<int> &boardPoints);
 			//std::pair<std::vector<std::vector<cv::Point3f>>, std::vector<int>> SetCustomObjPoints();
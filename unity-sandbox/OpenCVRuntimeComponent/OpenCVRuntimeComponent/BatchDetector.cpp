@@ -0,0 +1,344 @@
+#include "BatchDetector.h"
+#include "PoseQuality.h"
+
+#include <cstring>
+#include <opencv2/imgproc.hpp>
+#include <opencv2/videoio.hpp>
+
+namespace OpenCVRuntimeComponent
+{
+	namespace ArUcoTracking
+	{
+		struct BatchDetector::DetectorState
+		{
+			DetectorParameterTuner tuner;
+			MarkerPoseEstimator poseEstimator;
+			cv::Mat grayImage;
+		};
+
+		struct BatchDetector::FrameScratch
+		{
+			std::vector<std::vector<cv::Point2f>> markers;
+			std::vector<std::vector<cv::Point2f>> rejectedCandidates;
+			std::vector<int32_t> markerIds;
+			std::vector<cv::Vec3d> rVecs;
+			std::vector<cv::Vec3d> tVecs;
+			std::vector<uchar> isPoseSolved;
+			bool boardDetected = false;
+			cv::Vec3d boardRVec;
+			cv::Vec3d boardTVec;
+			double reprojectionRms = 0.0;
+		};
+
+		namespace
+		{
+			const char FileMagic[4] = { 'A', 'B', 'R', '1' };
+
+			void ToGray(const cv::Mat& frame, cv::Mat& gray)
+			{
+				switch (frame.channels())
+				{
+				case 4:
+					cv::cvtColor(frame, gray, cv::COLOR_BGRA2GRAY);
+					break;
+				case 3:
+					cv::cvtColor(frame, gray, cv::COLOR_BGR2GRAY);
+					break;
+				default:
+					frame.convertTo(gray, CV_8U, frame.depth() == CV_16U ? 1.0 / 256.0 : 1.0);
+					break;
+				}
+			}
+		}
+
+		void BatchResultVector::Write(
+			const std::vector<BatchFrameResult>& frameResults,
+			const std::vector<BatchMarkerResult>& markerResults)
+		{
+			frames.insert(frames.end(), frameResults.begin(), frameResults.end());
+			markers.insert(markers.end(), markerResults.begin(), markerResults.end());
+		}
+
+		BatchResultFile::BatchResultFile(const std::string& path)
+			: _stream(path, std::ios::binary | std::ios::trunc)
+		{
+			if (!_stream.is_open())
+			{
+				return;
+			}
+
+			const uint32_t recordSizes[2] = {
+				(uint32_t)sizeof(BatchFrameResult),
+				(uint32_t)sizeof(BatchMarkerResult) };
+			_stream.write(FileMagic, sizeof(FileMagic));
+			_stream.write(reinterpret_cast<const char*>(recordSizes), sizeof(recordSizes));
+		}
+
+		void BatchResultFile::Write(
+			const std::vector<BatchFrameResult>& frames,
+			const std::vector<BatchMarkerResult>& markers)
+		{
+			if (!_stream.is_open())
+			{
+				return;
+			}
+
+			for (const auto& frame : frames)
+			{
+				_stream.write(reinterpret_cast<const char*>(&frame), sizeof(frame));
+
+				if (frame.markerCount > 0)
+				{
+					// Marker results of the block follow its first frame
+					const size_t first = (size_t)(frame.firstMarker - frames.front().firstMarker);
+					_stream.write(
+						reinterpret_cast<const char*>(&markers[first]),
+						frame.markerCount * sizeof(BatchMarkerResult));
+				}
+			}
+		}
+
+		BatchDetector::BatchDetector(const BatchDetectionSettings& settings)
+			: _settings(settings),
+			_nextMarker(0)
+		{
+			_dictionary = _settings.board->dictionary;
+			_settings.blockSize = (std::max)(_settings.blockSize, 1);
+			_settings.runLength = (std::max)(_settings.runLength, 1);
+		}
+
+		BatchDetector::~BatchDetector()
+		{
+		}
+
+		void BatchDetector::Process(
+			const std::vector<cv::Mat>& frames,
+			BatchResultSink& sink,
+			int64_t firstFrameIndex)
+		{
+			for (size_t first = 0; first < frames.size(); first += _settings.blockSize)
+			{
+				const size_t last = (std::min)(first + _settings.blockSize, frames.size());
+				const std::vector<cv::Mat> block(frames.begin() + first, frames.begin() + last);
+
+				ProcessBlock(block, firstFrameIndex + (int64_t)first, sink);
+			}
+		}
+
+		int64_t BatchDetector::ProcessCapture(
+			const std::string& path,
+			BatchResultSink& sink)
+		{
+			cv::VideoCapture capture(path);
+			if (!capture.isOpened())
+			{
+				return -1;
+			}
+
+			// Decoding is sequential, the frames of a block are then
+			// processed in parallel. Block images are reused.
+			std::vector<cv::Mat> block(_settings.blockSize);
+			int64_t frameIndex = 0;
+
+			for (;;)
+			{
+				size_t count = 0;
+				while (count < block.size() && capture.read(block[count]))
+				{
+					count++;
+				}
+
+				if (count == 0)
+				{
+					break;
+				}
+
+				ProcessBlock(
+					std::vector<cv::Mat>(block.begin(), block.begin() + count),
+					frameIndex,
+					sink);
+				frameIndex += count;
+
+				if (count < block.size())
+				{
+					break;
+				}
+			}
+
+			return frameIndex;
+		}
+
+		void BatchDetector::ProcessBlock(
+			const std::vector<cv::Mat>& frames,
+			int64_t firstFrameIndex,
+			BatchResultSink& sink)
+		{
+			std::vector<FrameScratch> scratch(frames.size());
+
+			// Runs of consecutive frames so the tuner and the pose
+			// ambiguity resolution see the frames in order. Run boundaries
+			// only depend on the run length and every run starts from a
+			// reset state.
+			const int runLength = _settings.runLength;
+			const int numRuns = ((int)frames.size() + runLength - 1) / runLength;
+
+			cv::parallel_for_(cv::Range(0, numRuns), [&](const cv::Range& runs)
+			{
+				std::unique_ptr<DetectorState> state = AcquireState();
+
+				for (int run = runs.start; run < runs.end; run++)
+				{
+					state->tuner.Reset();
+					state->poseEstimator.Reset();
+
+					const int last = (std::min)((run + 1) * runLength, (int)frames.size());
+					for (int i = run * runLength; i < last; i++)
+					{
+						ProcessFrame(*state, frames[i], scratch[i]);
+					}
+				}
+
+				ReleaseState(std::move(state));
+			});
+
+			// Flatten in frame order
+			std::vector<BatchFrameResult> frameResults(frames.size());
+			std::vector<BatchMarkerResult> markerResults;
+
+			for (size_t i = 0; i < frames.size(); i++)
+			{
+				const FrameScratch& s = scratch[i];
+				BatchFrameResult& frame = frameResults[i];
+
+				frame.frameIndex = firstFrameIndex + (int64_t)i;
+				frame.boardDetected = s.boardDetected ? 1 : 0;
+				frame.markerCount = (int32_t)s.markerIds.size();
+				frame.firstMarker = _nextMarker + (int64_t)markerResults.size();
+				for (int k = 0; k < 3; k++)
+				{
+					frame.rVec[k] = s.boardRVec[k];
+					frame.tVec[k] = s.boardTVec[k];
+				}
+				frame.reprojectionRms = s.reprojectionRms;
+
+				for (size_t m = 0; m < s.markerIds.size(); m++)
+				{
+					BatchMarkerResult marker;
+					std::memset(&marker, 0, sizeof(marker));
+
+					marker.frameIndex = frame.frameIndex;
+					marker.id = s.markerIds[m];
+					for (int c = 0; c < 4; c++)
+					{
+						marker.corners[2 * c] = s.markers[m][c].x;
+						marker.corners[2 * c + 1] = s.markers[m][c].y;
+					}
+
+					marker.hasPose = m < s.isPoseSolved.size() && s.isPoseSolved[m] ? 1 : 0;
+					if (marker.hasPose)
+					{
+						for (int k = 0; k < 3; k++)
+						{
+							marker.rVec[k] = s.rVecs[m][k];
+							marker.tVec[k] = s.tVecs[m][k];
+						}
+					}
+
+					markerResults.push_back(marker);
+				}
+			}
+
+			_nextMarker += (int64_t)markerResults.size();
+			sink.Write(frameResults, markerResults);
+		}
+
+		void BatchDetector::ProcessFrame(
+			DetectorState& state,
+			const cv::Mat& frame,
+			FrameScratch& scratch)
+		{
+			scratch.boardRVec = cv::Vec3d();
+			scratch.boardTVec = cv::Vec3d();
+
+			if (frame.empty())
+			{
+				return;
+			}
+
+			ToGray(frame, state.grayImage);
+
+			state.tuner.Detect(
+				state.grayImage,
+				_dictionary,
+				scratch.markers,
+				scratch.markerIds,
+				scratch.rejectedCandidates);
+
+			if (scratch.markerIds.empty())
+			{
+				state.poseEstimator.Reset();
+				return;
+			}
+
+			if (_settings.markerLength > 0.0f)
+			{
+				state.poseEstimator.Estimate(
+					scratch.markers,
+					scratch.markerIds,
+					_settings.cameraMatrix,
+					_settings.distortionCoefficients,
+					scratch.rVecs,
+					scratch.tVecs,
+					scratch.isPoseSolved);
+			}
+
+			// Same minimum number of markers as the tracker
+			if (scratch.markerIds.size() > 1)
+			{
+				const int valid = cv::aruco::estimatePoseBoard(
+					scratch.markers, scratch.markerIds,
+					_settings.board,
+					_settings.cameraMatrix,
+					_settings.distortionCoefficients,
+					scratch.boardRVec, scratch.boardTVec);
+
+				if (valid > 0)
+				{
+					scratch.boardDetected = true;
+					scratch.reprojectionRms = ComputeBoardPoseQuality(
+						_settings.board,
+						scratch.markers,
+						scratch.markerIds,
+						_settings.cameraMatrix,
+						_settings.distortionCoefficients,
+						scratch.boardRVec,
+						scratch.boardTVec).reprojectionRms;
+				}
+			}
+		}
+
+		std::unique_ptr<BatchDetector::DetectorState> BatchDetector::AcquireState()
+		{
+			{
+				std::lock_guard<std::mutex> lock(_stateLock);
+				if (!_states.empty())
+				{
+					std::unique_ptr<DetectorState> state = std::move(_states.back());
+					_states.pop_back();
+					return state;
+				}
+			}
+
+			std::unique_ptr<DetectorState> state(new DetectorState());
+			state->tuner.Configure(_settings.tuneDetector, 60);
+			state->poseEstimator.SetMarkerLength(_settings.markerLength);
+			return state;
+		}
+
+		void BatchDetector::ReleaseState(std::unique_ptr<DetectorState> state)
+		{
+			std::lock_guard<std::mutex> lock(_stateLock);
+			_states.push_back(std::move(state));
+		}
+	}
+}
@@ -0,0 +1,162 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <opencv2/core.hpp>
+#include <opencv2/aruco.hpp>
+#include "DetectorParameterTuner.h"
+#include "MarkerPoseEstimator.h"
+
+namespace OpenCVRuntimeComponent
+{
+	namespace ArUcoTracking
+	{
+		// Board result of one frame, its markers are markerCount entries
+		// of the marker results starting at firstMarker
+		struct BatchFrameResult
+		{
+			int64_t frameIndex;
+			int32_t boardDetected;
+			int32_t markerCount;
+			int64_t firstMarker;
+			double rVec[3];
+			double tVec[3];
+			double reprojectionRms; // pixels, board pose
+		};
+
+		// Detected marker, corners in detection order (pixels) and the
+		// single marker pose when estimated and solved
+		struct BatchMarkerResult
+		{
+			int64_t frameIndex;
+			int32_t id;
+			int32_t hasPose;
+			float corners[8];
+			double rVec[3];
+			double tVec[3];
+		};
+
+		struct BatchDetectionSettings
+		{
+			// Board layout, its dictionary is used for detection
+			cv::Ptr<cv::aruco::Board> board;
+			cv::Mat cameraMatrix;
+			cv::Mat distortionCoefficients;
+
+			// Side length of the markers for single marker poses, no
+			// marker poses if not positive
+			float markerLength = 0.0f;
+
+			// Narrow the detector parameters within each run of frames
+			bool tuneDetector = false;
+
+			// Frames decoded and processed together, results of a block
+			// are written once all its frames are done
+			int blockSize = 256;
+
+			// Consecutive frames of a block processed in order by one
+			// thread, the tuner and the pose solver restart with each run
+			int runLength = 32;
+		};
+
+		// Receives the results of consecutive frames in frame order
+		class BatchResultSink
+		{
+		public:
+			virtual ~BatchResultSink() {}
+
+			virtual void Write(
+				const std::vector<BatchFrameResult>& frames,
+				const std::vector<BatchMarkerResult>& markers) = 0;
+		};
+
+		// Collects all results in two contiguous arrays, the marker offsets
+		// of the frames index the marker array
+		class BatchResultVector : public BatchResultSink
+		{
+		public:
+			void Write(
+				const std::vector<BatchFrameResult>& frames,
+				const std::vector<BatchMarkerResult>& markers) override;
+
+			std::vector<BatchFrameResult> frames;
+			std::vector<BatchMarkerResult> markers;
+		};
+
+		// Streams the results to a binary file: a header (magic "ABR1",
+		// record sizes) followed by each frame record and its marker
+		// records
+		class BatchResultFile : public BatchResultSink
+		{
+		public:
+			explicit BatchResultFile(const std::string& path);
+
+			bool IsOpen() const { return _stream.is_open(); }
+
+			void Write(
+				const std::vector<BatchFrameResult>& frames,
+				const std::vector<BatchMarkerResult>& markers) override;
+
+		private:
+			std::ofstream _stream;
+		};
+
+		// Board and marker detection over recorded frames. Blocks of frames
+		// are split into runs of runLength consecutive frames that are
+		// processed in parallel. Each run borrows a detector state
+		// (parameter tuner, pose solver) from a pool and resets it, so the
+		// results do not depend on the thread count or on which state a
+		// run gets.
+		class BatchDetector
+		{
+		public:
+			explicit BatchDetector(const BatchDetectionSettings& settings);
+			~BatchDetector();
+
+			// Frames in memory (gray, BGR or BGRA), the results of frame i
+			// carry frame index firstFrameIndex + i
+			void Process(
+				const std::vector<cv::Mat>& frames,
+				BatchResultSink& sink,
+				int64_t firstFrameIndex = 0);
+
+			// Frames decoded from a video file or image sequence pattern
+			// (anything cv::VideoCapture opens), returns the number of
+			// frames processed or -1 if the capture cannot be opened
+			int64_t ProcessCapture(
+				const std::string& path,
+				BatchResultSink& sink);
+
+		private:
+			struct DetectorState;
+			struct FrameScratch;
+
+			BatchDetectionSettings _settings;
+			cv::Ptr<cv::aruco::Dictionary> _dictionary;
+
+			// Idle detector states
+			std::mutex _stateLock;
+			std::vector<std::unique_ptr<DetectorState>> _states;
+
+			std::unique_ptr<DetectorState> AcquireState();
+			void ReleaseState(std::unique_ptr<DetectorState> state);
+
+			void ProcessFrame(
+				DetectorState& state,
+				const cv::Mat& frame,
+				FrameScratch& scratch);
+
+			// Marker offset of the next frame written to the sink
+			int64_t _nextMarker;
+
+			void ProcessBlock(
+				const std::vector<cv::Mat>& frames,
+				int64_t firstFrameIndex,
+				BatchResultSink& sink);
+		};
+	}
+}
@@ -0,0 +1,260 @@
+#include "BoardDetectionPipeline.h"
+
+#include <chrono>
+#include <opencv2/imgproc.hpp>
+
+namespace OpenCVRuntimeComponent
+{
+	namespace ArUcoTracking
+	{
+		namespace
+		{
+			double ElapsedMilliseconds(
+				std::chrono::steady_clock::time_point from,
+				std::chrono::steady_clock::time_point to)
+			{
+				return std::chrono::duration<double, std::milli>(to - from).count();
+			}
+
+			// Marker ids firstMarkerId, firstMarkerId + 1, ... in order
+			bool HasConsecutiveIds(const cv::aruco::Board& board)
+			{
+				for (size_t i = 1; i < board.ids.size(); i++)
+				{
+					if (board.ids[i] != board.ids[0] + (int)i)
+					{
+						return false;
+					}
+				}
+				return !board.ids.empty();
+			}
+		}
+
+		BoardDetectionPipeline::BoardDetectionPipeline()
+			: _isFixedBoard(false),
+			_levelParams(cv::aruco::DetectorParameters::create()),
+			_hasResult(false),
+			_isLastDetected(false)
+		{
+		}
+
+		void BoardDetectionPipeline::SetBoard(const cv::Ptr<cv::aruco::Board>& board)
+		{
+			_board = board;
+			_isFixedBoard = HasConsecutiveIds(*board) &&
+				_fixedBoard.Assign(board->objPoints, board->ids[0]);
+			_cornerTracker.SetDictionary(board->dictionary);
+			Reset();
+		}
+
+		void BoardDetectionPipeline::Reset()
+		{
+			_motionGate.Invalidate();
+			_cornerTracker.Reset();
+			_hasResult = false;
+			_isLastDetected = false;
+			_lastBoardRegion = cv::Rect();
+		}
+
+		int BoardDetectionPipeline::EstimatePose(
+			const std::vector<std::vector<cv::Point2f>>& markers,
+			const std::vector<int32_t>& markerIds,
+			const cv::Mat& cameraMatrix,
+			const cv::Mat& distortionCoefficients,
+			cv::Vec3d& rVec,
+			cv::Vec3d& tVec) const
+		{
+			return _isFixedBoard
+				? _fixedBoard.EstimatePose(
+					markers, markerIds,
+					cameraMatrix,
+					distortionCoefficients,
+					rVec, tVec)
+				: cv::aruco::estimatePoseBoard(
+					markers, markerIds,
+					_board,
+					cameraMatrix,
+					distortionCoefficients,
+					rVec, tVec);
+		}
+
+		void BoardDetectionPipeline::Process(
+			const cv::Mat& frame,
+			const cv::Mat& cameraMatrix,
+			const cv::Mat& distortionCoefficients,
+			BoardFrameResult& result)
+		{
+			const auto frameStart = std::chrono::steady_clock::now();
+
+			result.isSkipped = false;
+			result.isTracked = false;
+			result.isDetected = false;
+			result.markers.clear();
+			result.markerIds.clear();
+			result.timings = StageTimings();
+
+			// While the board region is static, skip detection and
+			// reuse the last detected board pose
+			if (_hasResult && !_motionGate.IsDetectionRequired(frame))
+			{
+				result.isSkipped = true;
+				result.isDetected = _isLastDetected;
+				result.rVec = _lastRVec;
+				result.tVec = _lastTVec;
+				return;
+			}
+
+			cv::Mat grayFrame;
+			switch (frame.channels())
+			{
+			case 4:
+				cv::cvtColor(frame, grayFrame, cv::COLOR_BGRA2GRAY);
+				break;
+			case 3:
+				cv::cvtColor(frame, grayFrame, cv::COLOR_BGR2GRAY);
+				break;
+			default:
+				grayFrame = frame;
+				break;
+			}
+
+			const auto detectStart = std::chrono::steady_clock::now();
+			result.timings.convertMs = ElapsedMilliseconds(frameStart, detectStart);
+
+			// Between full detections, follow the corners of the last
+			// detected markers with optical flow
+			result.isTracked = _cornerTracker.Track(grayFrame, result.markers, result.markerIds);
+			if (!result.isTracked)
+			{
+				DetectMarkers(grayFrame, result.markers, result.markerIds);
+			}
+
+			const auto poseStart = std::chrono::steady_clock::now();
+			result.timings.detectMs = ElapsedMilliseconds(detectStart, poseStart);
+
+			if (result.markerIds.size() > 1)
+			{
+				result.isDetected = EstimatePose(
+					result.markers, result.markerIds,
+					cameraMatrix,
+					distortionCoefficients,
+					result.rVec, result.tVec) > 0;
+			}
+
+			if (result.isDetected)
+			{
+				// Board region becomes the reference for motion gating
+				std::vector<cv::Point2f> corners;
+				for (const auto& marker : result.markers)
+				{
+					corners.insert(corners.end(), marker.begin(), marker.end());
+				}
+				_lastBoardRegion = cv::boundingRect(corners);
+				_motionGate.SetReference(frame, _lastBoardRegion);
+
+				// Markers of a full detection are the start of corner tracking
+				if (!result.isTracked)
+				{
+					_cornerTracker.Start(grayFrame, result.markers, result.markerIds);
+				}
+			}
+			else
+			{
+				_motionGate.Invalidate();
+				_cornerTracker.Reset();
+				_lastBoardRegion = cv::Rect();
+			}
+
+			_hasResult = true;
+			_isLastDetected = result.isDetected;
+			_lastRVec = result.rVec;
+			_lastTVec = result.tVec;
+
+			// Adapt the detection settings of the next frames to the
+			// measured stage timings, tracked frames are cheap and would
+			// hide the cost of full detections
+			result.timings.poseMs = ElapsedMilliseconds(poseStart, std::chrono::steady_clock::now());
+			if (!result.isTracked)
+			{
+				_qualityController.Report(result.timings);
+			}
+		}
+
+		void BoardDetectionPipeline::DetectMarkers(
+			const cv::Mat& grayFrame,
+			std::vector<std::vector<cv::Point2f>>& markers,
+			std::vector<int32_t>& markerIds)
+		{
+			// Detector tuned from the candidate statistics of recent frames
+			// on the full frame unless quality control is enabled
+			if (!_qualityController.IsEnabled())
+			{
+				_detectorTuner.Detect(
+					grayFrame,
+					_board->dictionary,
+					markers,
+					markerIds,
+					_rejectedCandidates);
+				return;
+			}
+
+			const QualitySettings& quality = _qualityController.Settings();
+			_levelParams->adaptiveThreshWinSizeMin = quality.adaptiveThreshWinSizeMin;
+			_levelParams->adaptiveThreshWinSizeMax = quality.adaptiveThreshWinSizeMax;
+			_levelParams->adaptiveThreshWinSizeStep = quality.adaptiveThreshWinSizeStep;
+			_levelParams->cornerRefinementMethod = quality.cornerRefinementMethod;
+
+			// Search region, the full frame unless the level restricts
+			// detection to the surroundings of the last board
+			cv::Rect region(0, 0, grayFrame.cols, grayFrame.rows);
+			if (quality.roiPadding >= 0.0 && _lastBoardRegion.area() > 0)
+			{
+				const int padX = (int)(_lastBoardRegion.width * quality.roiPadding);
+				const int padY = (int)(_lastBoardRegion.height * quality.roiPadding);
+				region &= cv::Rect(
+					_lastBoardRegion.x - padX,
+					_lastBoardRegion.y - padY,
+					_lastBoardRegion.width + 2 * padX,
+					_lastBoardRegion.height + 2 * padY);
+			}
+
+			cv::Mat detectFrame = grayFrame(region);
+			if (quality.processingScale < 1.0)
+			{
+				cv::resize(
+					detectFrame,
+					_scaledGrayFrame,
+					cv::Size(),
+					quality.processingScale,
+					quality.processingScale,
+					cv::INTER_AREA);
+				detectFrame = _scaledGrayFrame;
+			}
+
+			cv::aruco::detectMarkers(
+				detectFrame,
+				_board->dictionary,
+				markers,
+				markerIds,
+				_levelParams,
+				_rejectedCandidates);
+
+			// Map the corners back to full frame pixels. Pixel centres are
+			// at integer coordinates, resize aligns the pixel edges so the
+			// half pixel is added before and removed after the scaling.
+			if (region.area() != grayFrame.size().area() || quality.processingScale < 1.0)
+			{
+				const float scale = (float)(1.0 / quality.processingScale);
+				const cv::Point2f offset((float)region.x, (float)region.y);
+				const cv::Point2f halfPixel(0.5f, 0.5f);
+				for (auto& marker : markers)
+				{
+					for (auto& corner : marker)
+					{
+						corner = (corner + halfPixel) * scale - halfPixel + offset;
+					}
+				}
+			}
+		}
+	}
+}
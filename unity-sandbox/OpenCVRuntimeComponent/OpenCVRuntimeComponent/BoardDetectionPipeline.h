@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <opencv2/core.hpp>
+#include <opencv2/aruco.hpp>
+#include "BoardLayout.h"
+#include "CornerFlowTracker.h"
+#include "DetectorParameterTuner.h"
+#include "MotionGate.h"
+#include "QualityController.h"
+
+namespace OpenCVRuntimeComponent
+{
+	namespace ArUcoTracking
+	{
+		// Outcome of one frame of board detection
+		struct BoardFrameResult
+		{
+			// Static frame, detection was skipped and the pose is that of
+			// the last detection
+			bool isSkipped = false;
+
+			// Markers followed with optical flow instead of detected
+			bool isTracked = false;
+
+			bool isDetected = false;
+			cv::Vec3d rVec;
+			cv::Vec3d tVec;
+
+			// Markers of the frame in full frame pixels, empty if skipped
+			std::vector<std::vector<cv::Point2f>> markers;
+			std::vector<int32_t> markerIds;
+
+			StageTimings timings;
+		};
+
+		// Per-frame board detection of the tracker, shared with the
+		// detection regression so both run the same code. The motion gate
+		// skips static frames, corner tracking follows the markers between
+		// full detections and markers are otherwise detected with the
+		// tuned parameters or the settings of the quality level. The pose
+		// is solved from the markers and the gate, the corner tracker and
+		// the quality controller are updated with the result. Frames are
+		// BGRA or gray, the gray conversion is part of the timings.
+		class BoardDetectionPipeline
+		{
+		public:
+			BoardDetectionPipeline();
+
+			// Board to detect, drops the state of the previous board. The
+			// pose of a board of four consecutive marker ids is solved
+			// with FixedBoard.
+			void SetBoard(const cv::Ptr<cv::aruco::Board>& board);
+			const cv::Ptr<cv::aruco::Board>& Board() const { return _board; }
+
+			// Detect the board in the next frame of the sequence
+			void Process(
+				const cv::Mat& frame,
+				const cv::Mat& cameraMatrix,
+				const cv::Mat& distortionCoefficients,
+				BoardFrameResult& result);
+
+			// Pose of the board from its detected markers, returns the
+			// number of markers the pose was solved with
+			int EstimatePose(
+				const std::vector<std::vector<cv::Point2f>>& markers,
+				const std::vector<int32_t>& markerIds,
+				const cv::Mat& cameraMatrix,
+				const cv::Mat& distortionCoefficients,
+				cv::Vec3d& rVec,
+				cv::Vec3d& tVec) const;
+
+			// Drop the state carried between frames
+			void Reset();
+
+			// Stages, configured by the owner
+			MotionGate& MotionGating() { return _motionGate; }
+			CornerFlowTracker& CornerTracking() { return _cornerTracker; }
+			DetectorParameterTuner& DetectorTuning() { return _detectorTuner; }
+			QualityController& QualityControl() { return _qualityController; }
+
+		private:
+			cv::Ptr<cv::aruco::Board> _board;
+			FixedBoard<4> _fixedBoard;
+			bool _isFixedBoard;
+
+			MotionGate _motionGate;
+			CornerFlowTracker _cornerTracker;
+			DetectorParameterTuner _detectorTuner;
+			QualityController _qualityController;
+			cv::Ptr<cv::aruco::DetectorParameters> _levelParams;
+
+			// Pose of the last detection, returned for skipped frames,
+			// and the region of the last detected board
+			bool _hasResult;
+			bool _isLastDetected;
+			cv::Vec3d _lastRVec;
+			cv::Vec3d _lastTVec;
+			cv::Rect _lastBoardRegion;
+
+			// Scratch buffers reused across frames
+			cv::Mat _scaledGrayFrame;
+			std::vector<std::vector<cv::Point2f>> _rejectedCandidates;
+
+			// Detect the board markers with the settings of the current
+			// quality level, corners are returned in full frame pixels
+			void DetectMarkers(
+				const cv::Mat& grayFrame,
+				std::vector<std::vector<cv::Point2f>>& markers,
+				std::vector<int32_t>& markerIds);
+		};
+	}
+}
@@ -0,0 +1,274 @@
+#include "BoardLayout.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+namespace OpenCVRuntimeComponent
+{
+	namespace ArUcoTracking
+	{
+		namespace
+		{
+			const char FileMagic[4] = { 'A', 'B', 'L', '1' };
+
+			std::vector<std::string> SplitColumns(const std::string& line)
+			{
+				std::vector<std::string> columns;
+				std::stringstream stream(line);
+				std::string column;
+				while (std::getline(stream, column, ','))
+				{
+					columns.push_back(column);
+				}
+				return columns;
+			}
+
+			std::string Trim(const std::string& s)
+			{
+				const size_t first = s.find_first_not_of(" \t\r");
+				if (first == std::string::npos)
+				{
+					return std::string();
+				}
+				return s.substr(first, s.find_last_not_of(" \t\r") - first + 1);
+			}
+
+			// Shortest float literal that reads back to the same value
+			std::string FloatLiteral(float value)
+			{
+				char buffer[32];
+				for (int precision = 6; precision <= 9; precision++)
+				{
+					std::snprintf(buffer, sizeof(buffer), "%.*g", precision, value);
+					if (std::strtof(buffer, nullptr) == value)
+					{
+						break;
+					}
+				}
+
+				std::string literal = buffer;
+				if (literal.find_first_of(".e") == std::string::npos)
+				{
+					literal += ".0";
+				}
+				return literal + "f";
+			}
+		}
+
+		bool ReadFiducialFile(
+			const std::string& path,
+			const FiducialConversion& conversion,
+			BoardLayout& layout,
+			std::string& error)
+		{
+			std::ifstream stream(path);
+			if (!stream.is_open())
+			{
+				error = "cannot open " + path;
+				return false;
+			}
+
+			// Columns of markups file version 4.x, overridden by the
+			// columns header when present
+			size_t xColumn = 1, yColumn = 2, zColumn = 3, labelColumn = 11;
+
+			layout = BoardLayout();
+			std::string line;
+			int lineNumber = 0;
+			while (std::getline(stream, line))
+			{
+				lineNumber++;
+				line = Trim(line);
+				if (line.empty())
+				{
+					continue;
+				}
+
+				if (line[0] == '#')
+				{
+					const size_t equals = line.find('=');
+					if (equals != std::string::npos &&
+						Trim(line.substr(1, equals - 1)) == "columns")
+					{
+						const std::vector<std::string> names = SplitColumns(line.substr(equals + 1));
+						for (size_t i = 0; i < names.size(); i++)
+						{
+							const std::string name = Trim(names[i]);
+							if (name == "x") xColumn = i;
+							else if (name == "y") yColumn = i;
+							else if (name == "z") zColumn = i;
+							else if (name == "label") labelColumn = i;
+						}
+					}
+					continue;
+				}
+
+				const std::vector<std::string> columns = SplitColumns(line);
+				if (columns.size() <= (std::max)(xColumn, (std::max)(yColumn, zColumn)))
+				{
+					error = path + ":" + std::to_string(lineNumber) + ": missing coordinates";
+					return false;
+				}
+
+				BoardPoint location;
+				try
+				{
+					location.x = (float)(std::stod(columns[xColumn]) * conversion.metersPerUnit);
+					location.y = (float)(std::stod(columns[yColumn]) * conversion.metersPerUnit);
+					location.z = (float)(std::stod(columns[zColumn]) * conversion.metersPerUnit);
+				}
+				catch (const std::exception&)
+				{
+					error = path + ":" + std::to_string(lineNumber) + ": invalid coordinates";
+					return false;
+				}
+				if (conversion.mirrorX)
+				{
+					location.x = -location.x;
+				}
+				layout.markerLocations.push_back(location);
+
+				if (layout.name.empty() && labelColumn < columns.size())
+				{
+					const std::string label = Trim(columns[labelColumn]);
+					layout.name = label.substr(0, label.find('-'));
+				}
+			}
+
+			if (layout.markerLocations.empty())
+			{
+				error = path + ": no markups";
+				return false;
+			}
+
+			return true;
+		}
+
+		bool WriteBoardLayoutFile(
+			const std::string& path,
+			const BoardLayout& layout)
+		{
+			std::ofstream stream(path, std::ios::binary | std::ios::trunc);
+			if (!stream.is_open())
+			{
+				return false;
+			}
+
+			const uint32_t markerCount = (uint32_t)layout.markerLocations.size();
+			const int32_t firstMarkerId = layout.firstMarkerId;
+			stream.write(FileMagic, sizeof(FileMagic));
+			stream.write(reinterpret_cast<const char*>(&markerCount), sizeof(markerCount));
+			stream.write(reinterpret_cast<const char*>(&layout.markerLength), sizeof(layout.markerLength));
+			stream.write(reinterpret_cast<const char*>(&firstMarkerId), sizeof(firstMarkerId));
+			stream.write(
+				reinterpret_cast<const char*>(layout.markerLocations.data()),
+				markerCount * sizeof(BoardPoint));
+
+			return stream.good();
+		}
+
+		bool ReadBoardLayoutFile(
+			const std::string& path,
+			BoardLayout& layout)
+		{
+			std::ifstream stream(path, std::ios::binary);
+			char magic[sizeof(FileMagic)];
+			uint32_t markerCount = 0;
+			int32_t firstMarkerId = 0;
+			float markerLength = 0.0f;
+
+			stream.read(magic, sizeof(magic));
+			stream.read(reinterpret_cast<char*>(&markerCount), sizeof(markerCount));
+			stream.read(reinterpret_cast<char*>(&markerLength), sizeof(markerLength));
+			stream.read(reinterpret_cast<char*>(&firstMarkerId), sizeof(firstMarkerId));
+			if (!stream.good() ||
+				!std::equal(magic, magic + sizeof(magic), FileMagic) ||
+				markerCount > 1024)
+			{
+				return false;
+			}
+
+			std::vector<BoardPoint> locations(markerCount);
+			stream.read(reinterpret_cast<char*>(locations.data()), markerCount * sizeof(BoardPoint));
+			if (!stream.good())
+			{
+				return false;
+			}
+
+			layout = BoardLayout();
+			layout.markerLength = markerLength;
+			layout.firstMarkerId = firstMarkerId;
+			layout.markerLocations.swap(locations);
+			return true;
+		}
+
+		bool WriteBoardLayoutHeader(
+			const std::string& path,
+			const BoardLayout& layout,
+			const std::string& symbol,
+			const std::string& source)
+		{
+			std::ofstream stream(path, std::ios::trunc);
+			if (!stream.is_open())
+			{
+				return false;
+			}
+
+			stream
+				<< "#pragma once\n"
+				<< "\n"
+				<< "// Generated by CustomArUcoBoards --compile-board from " << source << ",\n"
+				<< "// regenerate instead of editing\n"
+				<< "\n"
+				<< "#include \"BoardLayout.h\"\n"
+				<< "\n"
+				<< "namespace OpenCVRuntimeComponent\n"
+				<< "{\n"
+				<< "\tnamespace ArUcoTracking\n"
+				<< "\t{\n"
+				<< "\t\tnamespace Boards\n"
+				<< "\t\t{\n"
+				<< "\t\t\tconstexpr FixedBoardLayout<" << layout.markerLocations.size() << "> " << symbol << " = {\n"
+				<< "\t\t\t\t" << FloatLiteral(layout.markerLength) << ", // marker length, meters\n"
+				<< "\t\t\t\t" << layout.firstMarkerId << ", // first marker id\n"
+				<< "\t\t\t\t{ {\n";
+
+			for (size_t i = 0; i < layout.markerLocations.size(); i++)
+			{
+				const BoardPoint& p = layout.markerLocations[i];
+				stream
+					<< "\t\t\t\t\t{ " << FloatLiteral(p.x)
+					<< ", " << FloatLiteral(p.y)
+					<< ", " << FloatLiteral(p.z) << " }"
+					<< (i + 1 < layout.markerLocations.size() ? ",\n" : "\n");
+			}
+
+			stream
+				<< "\t\t\t\t} } };\n"
+				<< "\t\t}\n"
+				<< "\t}\n"
+				<< "}\n";
+
+			return stream.good();
+		}
+
+		void BoardObjectPoints(
+			const BoardLayout& layout,
+			std::vector<std::vector<cv::Point3f>>& objPoints,
+			std::vector<int>& markerIds)
+		{
+			objPoints.clear();
+			markerIds.clear();
+			for (size_t i = 0; i < layout.markerLocations.size(); i++)
+			{
+				const std::array<cv::Point3f, 4> corners =
+					MarkerCorners(layout.markerLength, layout.markerLocations[i]);
+				objPoints.emplace_back(corners.begin(), corners.end());
+				markerIds.push_back(layout.firstMarkerId + (int)i);
+			}
+		}
+	}
+}
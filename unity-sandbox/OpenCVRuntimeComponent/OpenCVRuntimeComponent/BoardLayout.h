@@ -0,0 +1,227 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <opencv2/core.hpp>
+#include <opencv2/aruco.hpp>
+#include <opencv2/calib3d.hpp>
+
+namespace OpenCVRuntimeComponent
+{
+	namespace ArUcoTracking
+	{
+		// Top left corner of a marker in the board frame, meters
+		//	y
+		//	^
+		//	|
+		//	 _______> x
+		struct BoardPoint
+		{
+			float x;
+			float y;
+			float z;
+		};
+
+		// Board layout with a number of markers known at compile time,
+		// markers use consecutive ids starting at firstMarkerId
+		template <int NumMarkers>
+		struct FixedBoardLayout
+		{
+			static constexpr int MarkerCount = NumMarkers;
+
+			float markerLength;
+			int firstMarkerId;
+			std::array<BoardPoint, NumMarkers> markerLocations;
+		};
+
+		// Board layout read from a fiducial or board file
+		struct BoardLayout
+		{
+			std::string name;
+			float markerLength = 0.0f;
+			int firstMarkerId = 0;
+			std::vector<BoardPoint> markerLocations;
+		};
+
+		// Mapping of Slicer markup coordinates to board coordinates. The
+		// boards in data/MarkerConfig are centered in Slicer at a tenth
+		// of their size (units of 10 mm) and the RAS x axis points to the
+		// left of the printed board.
+		struct FiducialConversion
+		{
+			double metersPerUnit = 0.01;
+			bool mirrorX = true;
+		};
+
+		// Read the markups of a Slicer .fcsv file in file order, one
+		// marker per markup. The board name is the label prefix of the
+		// first markup ("F" for "F-0"). Returns false with a message if
+		// the file cannot be read or has no markups.
+		bool ReadFiducialFile(
+			const std::string& path,
+			const FiducialConversion& conversion,
+			BoardLayout& layout,
+			std::string& error);
+
+		// Compact binary board description: magic "ABL1", marker count,
+		// marker length, first marker id, then x y z of each marker
+		bool WriteBoardLayoutFile(
+			const std::string& path,
+			const BoardLayout& layout);
+		bool ReadBoardLayoutFile(
+			const std::string& path,
+			BoardLayout& layout);
+
+		// Header with a constexpr FixedBoardLayout named symbol
+		bool WriteBoardLayoutHeader(
+			const std::string& path,
+			const BoardLayout& layout,
+			const std::string& symbol,
+			const std::string& source);
+
+		// Corners of a marker in clockwise order from the top left
+		//	0______1
+		//	|      |
+		//	|  in  |
+		//	|______|
+		//	3      2
+		inline std::array<cv::Point3f, 4> MarkerCorners(
+			float markerLength,
+			const BoardPoint& location)
+		{
+			const float s = markerLength;
+			return { {
+				cv::Point3f(location.x, location.y, location.z),
+				cv::Point3f(location.x + s, location.y, location.z),
+				cv::Point3f(location.x + s, location.y - s, location.z),
+				cv::Point3f(location.x, location.y - s, location.z) } };
+		}
+
+		// Object points and ids of an aruco board with the layout
+		void BoardObjectPoints(
+			const BoardLayout& layout,
+			std::vector<std::vector<cv::Point3f>>& objPoints,
+			std::vector<int>& markerIds);
+
+		template <int NumMarkers>
+		BoardLayout ToBoardLayout(const FixedBoardLayout<NumMarkers>& fixed)
+		{
+			BoardLayout layout;
+			layout.markerLength = fixed.markerLength;
+			layout.firstMarkerId = fixed.firstMarkerId;
+			layout.markerLocations.assign(fixed.markerLocations.begin(), fixed.markerLocations.end());
+			return layout;
+		}
+
+		// Board pose solver for a board of NumMarkers markers. Corners are
+		// kept in fixed size arrays and the correspondences of a frame
+		// are gathered without allocation, the loops over the markers and
+		// corners have compile time bounds.
+		template <int NumMarkers>
+		class FixedBoard
+		{
+		public:
+			static constexpr int CornerCount = 4 * NumMarkers;
+
+			FixedBoard()
+				: _firstMarkerId(0)
+			{
+			}
+
+			explicit FixedBoard(const FixedBoardLayout<NumMarkers>& layout)
+				: _firstMarkerId(layout.firstMarkerId)
+			{
+				for (int m = 0; m < NumMarkers; m++)
+				{
+					_corners[m] = MarkerCorners(layout.markerLength, layout.markerLocations[m]);
+				}
+			}
+
+			// Corners of a board built at runtime, false if the number of
+			// markers does not match
+			bool Assign(
+				const std::vector<std::vector<cv::Point3f>>& objPoints,
+				int firstMarkerId)
+			{
+				if (objPoints.size() != (size_t)NumMarkers)
+				{
+					return false;
+				}
+
+				for (int m = 0; m < NumMarkers; m++)
+				{
+					if (objPoints[m].size() != 4)
+					{
+						return false;
+					}
+					for (int c = 0; c < 4; c++)
+					{
+						_corners[m][c] = objPoints[m][c];
+					}
+				}
+				_firstMarkerId = firstMarkerId;
+				return true;
+			}
+
+			// Pose of the board with solvePnP as cv::aruco::estimatePoseBoard
+			// solves it, but only the first detection of each marker id is
+			// used. OpenCV solves with every detection, the results differ
+			// if a marker id is detected more than once. Returns the number
+			// of board markers the pose was solved with.
+			int EstimatePose(
+				const std::vector<std::vector<cv::Point2f>>& markers,
+				const std::vector<int32_t>& markerIds,
+				const cv::Mat& cameraMatrix,
+				const cv::Mat& distortionCoefficients,
+				cv::Vec3d& rVec,
+				cv::Vec3d& tVec) const
+			{
+				std::array<cv::Point3f, CornerCount> objectPoints;
+				std::array<cv::Point2f, CornerCount> imagePoints;
+				bool isUsed[NumMarkers] = {};
+				int numUsed = 0;
+
+				for (size_t i = 0; i < markerIds.size() && numUsed < NumMarkers; i++)
+				{
+					const int m = markerIds[i] - _firstMarkerId;
+					if (m < 0 || m >= NumMarkers || isUsed[m])
+					{
+						continue;
+					}
+					isUsed[m] = true;
+
+					for (int c = 0; c < 4; c++)
+					{
+						objectPoints[4 * numUsed + c] = _corners[m][c];
+						imagePoints[4 * numUsed + c] = markers[i][c];
+					}
+					numUsed++;
+				}
+
+				if (numUsed == 0)
+				{
+					return 0;
+				}
+
+				cv::solvePnP(
+					cv::Mat(4 * numUsed, 1, CV_32FC3, objectPoints.data()),
+					cv::Mat(4 * numUsed, 1, CV_32FC2, imagePoints.data()),
+					cameraMatrix,
+					distortionCoefficients,
+					rVec,
+					tVec);
+
+				return numUsed;
+			}
+
+			int FirstMarkerId() const { return _firstMarkerId; }
+			const std::array<std::array<cv::Point3f, 4>, NumMarkers>& Corners() const { return _corners; }
+
+		private:
+			int _firstMarkerId;
+			std::array<std::array<cv::Point3f, 4>, NumMarkers> _corners;
+		};
+	}
+}
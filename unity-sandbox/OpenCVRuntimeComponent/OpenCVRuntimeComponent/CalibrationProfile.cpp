@@ -0,0 +1,92 @@
+#include "pch.h"
+#include "CalibrationProfile.h"
+
+using namespace OpenCVRuntimeComponent;
+
+HMDCalibration::CalibrationProfile::CalibrationProfile(
+	Platform::String^ userId,
+	OpenCVRuntimeComponent::CameraCalibrationParams^ cameraCalibrationParams,
+	float4x4 rightEyeTransform,
+	IVector<float3>^ rightEyeCameraPoints,
+	IVector<float3>^ rightEyeMarkerPoints,
+	float4x4 leftEyeTransform,
+	IVector<float3>^ leftEyeCameraPoints,
+	IVector<float3>^ leftEyeMarkerPoints)
+{
+	UserId = userId;
+	CameraCalibrationParams = cameraCalibrationParams;
+
+	RightEyeTransform = rightEyeTransform;
+	RightEyeCameraPoints = rightEyeCameraPoints;
+	RightEyeMarkerPoints = rightEyeMarkerPoints;
+	RightEyeRmsError = ComputeRmsError(rightEyeTransform, rightEyeCameraPoints, rightEyeMarkerPoints);
+
+	LeftEyeTransform = leftEyeTransform;
+	LeftEyeCameraPoints = leftEyeCameraPoints;
+	LeftEyeMarkerPoints = leftEyeMarkerPoints;
+	LeftEyeRmsError = ComputeRmsError(leftEyeTransform, leftEyeCameraPoints, leftEyeMarkerPoints);
+}
+
+HMDCalibration::CalibrationProfile::CalibrationProfile(
+	Platform::String^ userId,
+	OpenCVRuntimeComponent::CameraCalibrationParams^ cameraCalibrationParams,
+	float4x4 rightEyeTransform,
+	IVector<float3>^ rightEyeCameraPoints,
+	IVector<float3>^ rightEyeMarkerPoints,
+	float rightEyeRmsError,
+	float4x4 leftEyeTransform,
+	IVector<float3>^ leftEyeCameraPoints,
+	IVector<float3>^ leftEyeMarkerPoints,
+	float leftEyeRmsError)
+{
+	UserId = userId;
+	CameraCalibrationParams = cameraCalibrationParams;
+
+	RightEyeTransform = rightEyeTransform;
+	RightEyeCameraPoints = rightEyeCameraPoints;
+	RightEyeMarkerPoints = rightEyeMarkerPoints;
+	RightEyeRmsError = rightEyeRmsError;
+
+	LeftEyeTransform = leftEyeTransform;
+	LeftEyeCameraPoints = leftEyeCameraPoints;
+	LeftEyeMarkerPoints = leftEyeMarkerPoints;
+	LeftEyeRmsError = leftEyeRmsError;
+}
+
+/// <summary>
+/// Root mean square distance between the transformed head-relative camera
+/// points and the head-relative marker points. The transform is in the
+/// layout returned by ComputeRigidTransform3D3D (translation in m14, m24, m34).
+/// </summary>
+float HMDCalibration::CalibrationProfile::ComputeRmsError(
+	float4x4 t,
+	IVector<float3>^ cameraPoints,
+	IVector<float3>^ markerPoints)
+{
+	if (cameraPoints == nullptr || markerPoints == nullptr)
+	{
+		return 0.0f;
+	}
+
+	const unsigned int n = (std::min)(cameraPoints->Size, markerPoints->Size);
+	if (n == 0)
+	{
+		return 0.0f;
+	}
+
+	double sumSq = 0.0;
+	for (unsigned int i = 0; i < n; i++)
+	{
+		const float3 a = cameraPoints->GetAt(i);
+		const float3 b = markerPoints->GetAt(i);
+
+		const float3 ta(
+			t.m11 * a.x + t.m12 * a.y + t.m13 * a.z + t.m14,
+			t.m21 * a.x + t.m22 * a.y + t.m23 * a.z + t.m24,
+			t.m31 * a.x + t.m32 * a.y + t.m33 * a.z + t.m34);
+
+		sumSq += length_squared(ta - b);
+	}
+
+	return (float)std::sqrt(sumSq / n);
+}
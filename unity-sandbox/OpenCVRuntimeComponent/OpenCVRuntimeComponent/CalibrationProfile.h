@@ -0,0 +1,63 @@
+#pragma once
+#include "CameraCalibrationParams.h"
+
+using namespace Windows::Foundation::Collections;
+using namespace Windows::Foundation::Numerics;
+
+namespace OpenCVRuntimeComponent
+{
+	namespace HMDCalibration
+	{
+		// Per-user display calibration result. Holds the rigid transform
+		// for each eye together with the point correspondences it was
+		// computed from, the camera intrinsics in use at the time and the
+		// rms residual of each fit.
+		public ref class CalibrationProfile sealed
+		{
+		public:
+			CalibrationProfile(
+				_In_ Platform::String^ userId,
+				_In_ OpenCVRuntimeComponent::CameraCalibrationParams^ cameraCalibrationParams,
+				_In_ float4x4 rightEyeTransform,
+				_In_ IVector<float3>^ rightEyeCameraPoints,
+				_In_ IVector<float3>^ rightEyeMarkerPoints,
+				_In_ float4x4 leftEyeTransform,
+				_In_ IVector<float3>^ leftEyeCameraPoints,
+				_In_ IVector<float3>^ leftEyeMarkerPoints);
+
+			property Platform::String^ UserId;
+			property OpenCVRuntimeComponent::CameraCalibrationParams^ CameraCalibrationParams;
+
+			property float4x4 RightEyeTransform;
+			property IVector<float3>^ RightEyeCameraPoints;
+			property IVector<float3>^ RightEyeMarkerPoints;
+			property float RightEyeRmsError;
+
+			property float4x4 LeftEyeTransform;
+			property IVector<float3>^ LeftEyeCameraPoints;
+			property IVector<float3>^ LeftEyeMarkerPoints;
+			property float LeftEyeRmsError;
+
+		internal:
+			// Used by the profile store when restoring a cached profile,
+			// the stored rms errors are kept as is.
+			CalibrationProfile(
+				Platform::String^ userId,
+				OpenCVRuntimeComponent::CameraCalibrationParams^ cameraCalibrationParams,
+				float4x4 rightEyeTransform,
+				IVector<float3>^ rightEyeCameraPoints,
+				IVector<float3>^ rightEyeMarkerPoints,
+				float rightEyeRmsError,
+				float4x4 leftEyeTransform,
+				IVector<float3>^ leftEyeCameraPoints,
+				IVector<float3>^ leftEyeMarkerPoints,
+				float leftEyeRmsError);
+
+		private:
+			static float ComputeRmsError(
+				float4x4 transform,
+				IVector<float3>^ cameraPoints,
+				IVector<float3>^ markerPoints);
+		};
+	}
+}
@@ -0,0 +1,445 @@
+#include "pch.h"
+#include "CalibrationProfileStore.h"
+#include "Trace.h"
+
+#include <array>
+
+using namespace OpenCVRuntimeComponent;
+
+namespace
+{
+	// File layout (little-endian, packed):
+	//	ProfileFileHeader
+	//	ProfileIntrinsics
+	//	ProfileEye (right)
+	//	ProfileEye (left)
+	//	ProfileCorrespondence[right.numCorrespondences]
+	//	ProfileCorrespondence[left.numCorrespondences]
+	// The crc32 in the header covers everything after the header.
+	const uint32_t ProfileMagic = 0x50434C48; // "HLCP"
+	const uint16_t ProfileVersion = 1;
+
+#pragma pack(push, 1)
+	struct ProfileFileHeader
+	{
+		uint32_t magic;
+		uint16_t version;
+		uint16_t headerSize;
+		uint32_t payloadSize;
+		uint32_t payloadCrc32;
+		uint64_t createdTime; // FILETIME, 100 ns ticks
+	};
+
+	struct ProfileIntrinsics
+	{
+		float focalLength[2];
+		float principalPoint[2];
+		float radialDistortion[3];
+		float tangentialDistortion[2];
+		int32_t imageWidth;
+		int32_t imageHeight;
+	};
+
+	struct ProfileEye
+	{
+		float transform[16]; // row major, m11 ... m44
+		float rmsError;
+		uint32_t numCorrespondences;
+	};
+
+	struct ProfileCorrespondence
+	{
+		float cameraPoint[3];
+		float markerPoint[3];
+	};
+#pragma pack(pop)
+
+	uint32_t Crc32(const uint8_t* data, size_t length)
+	{
+		// Initialization of a function-local static is thread-safe, profiles
+		// may be saved and loaded from several threads
+		static const std::array<uint32_t, 256> table = []()
+		{
+			std::array<uint32_t, 256> filled;
+			for (uint32_t i = 0; i < 256; i++)
+			{
+				uint32_t c = i;
+				for (int k = 0; k < 8; k++)
+				{
+					c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+				}
+				filled[i] = c;
+			}
+			return filled;
+		}();
+
+		uint32_t crc = 0xFFFFFFFFu;
+		for (size_t i = 0; i < length; i++)
+		{
+			crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+		}
+		return crc ^ 0xFFFFFFFFu;
+	}
+
+	// Read-only view of a whole file, unmapped on destruction.
+	class MappedFile
+	{
+	public:
+		explicit MappedFile(const std::wstring& path)
+		{
+			_file = CreateFile2(
+				path.c_str(),
+				GENERIC_READ,
+				FILE_SHARE_READ,
+				OPEN_EXISTING,
+				nullptr);
+			if (_file == INVALID_HANDLE_VALUE)
+			{
+				return;
+			}
+
+			LARGE_INTEGER size = {};
+			if (!GetFileSizeEx(_file, &size) || size.QuadPart == 0)
+			{
+				return;
+			}
+			_size = (size_t)size.QuadPart;
+
+			_mapping = CreateFileMappingFromApp(_file, nullptr, PAGE_READONLY, 0, nullptr);
+			if (_mapping == nullptr)
+			{
+				return;
+			}
+
+			_view = MapViewOfFileFromApp(_mapping, FILE_MAP_READ, 0, 0);
+		}
+
+		~MappedFile()
+		{
+			if (_view != nullptr) UnmapViewOfFile(_view);
+			if (_mapping != nullptr) CloseHandle(_mapping);
+			if (_file != INVALID_HANDLE_VALUE) CloseHandle(_file);
+		}
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		const uint8_t* Data() const { return reinterpret_cast<const uint8_t*>(_view); }
+		size_t Size() const { return _view != nullptr ? _size : 0; }
+
+	private:
+		HANDLE _file = INVALID_HANDLE_VALUE;
+		HANDLE _mapping = nullptr;
+		void* _view = nullptr;
+		size_t _size = 0;
+	};
+
+	void FillEye(
+		ProfileEye& eye,
+		float4x4 t,
+		float rmsError,
+		uint32_t numCorrespondences)
+	{
+		const float m[16] = {
+			t.m11, t.m12, t.m13, t.m14,
+			t.m21, t.m22, t.m23, t.m24,
+			t.m31, t.m32, t.m33, t.m34,
+			t.m41, t.m42, t.m43, t.m44 };
+		memcpy(eye.transform, m, sizeof(m));
+		eye.rmsError = rmsError;
+		eye.numCorrespondences = numCorrespondences;
+	}
+
+	float4x4 TransformFromEye(const ProfileEye& eye)
+	{
+		const float* m = eye.transform;
+		return float4x4(
+			m[0], m[1], m[2], m[3],
+			m[4], m[5], m[6], m[7],
+			m[8], m[9], m[10], m[11],
+			m[12], m[13], m[14], m[15]);
+	}
+
+	uint32_t CountCorrespondences(IVector<float3>^ cameraPoints, IVector<float3>^ markerPoints)
+	{
+		if (cameraPoints == nullptr || markerPoints == nullptr)
+		{
+			return 0;
+		}
+		return (std::min)(cameraPoints->Size, markerPoints->Size);
+	}
+
+	void AppendCorrespondences(
+		std::vector<uint8_t>& buffer,
+		IVector<float3>^ cameraPoints,
+		IVector<float3>^ markerPoints,
+		uint32_t n)
+	{
+		for (uint32_t i = 0; i < n; i++)
+		{
+			const float3 a = cameraPoints->GetAt(i);
+			const float3 b = markerPoints->GetAt(i);
+			const ProfileCorrespondence c = { { a.x, a.y, a.z }, { b.x, b.y, b.z } };
+
+			const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&c);
+			buffer.insert(buffer.end(), bytes, bytes + sizeof(c));
+		}
+	}
+
+	void ReadCorrespondences(
+		const ProfileCorrespondence* c,
+		uint32_t n,
+		IVector<float3>^ cameraPoints,
+		IVector<float3>^ markerPoints)
+	{
+		for (uint32_t i = 0; i < n; i++)
+		{
+			cameraPoints->Append(float3(c[i].cameraPoint[0], c[i].cameraPoint[1], c[i].cameraPoint[2]));
+			markerPoints->Append(float3(c[i].markerPoint[0], c[i].markerPoint[1], c[i].markerPoint[2]));
+		}
+	}
+}
+
+HMDCalibration::CalibrationProfileStore::CalibrationProfileStore()
+{
+	_folderPath = Windows::Storage::ApplicationData::Current->LocalFolder->Path->Data();
+	IntrinsicsTolerance = 0.5f;
+	DistortionTolerance = 1e-3f;
+}
+
+HMDCalibration::CalibrationProfileStore::CalibrationProfileStore(
+	Platform::String^ folderPath)
+{
+	_folderPath = folderPath->Data();
+	IntrinsicsTolerance = 0.5f;
+	DistortionTolerance = 1e-3f;
+}
+
+bool HMDCalibration::CalibrationProfileStore::Save(
+	CalibrationProfile^ profile)
+{
+	if (profile == nullptr || profile->CameraCalibrationParams == nullptr)
+	{
+		return false;
+	}
+
+	const uint32_t nRight = CountCorrespondences(profile->RightEyeCameraPoints, profile->RightEyeMarkerPoints);
+	const uint32_t nLeft = CountCorrespondences(profile->LeftEyeCameraPoints, profile->LeftEyeMarkerPoints);
+
+	// Intrinsics and both eyes
+	auto p = profile->CameraCalibrationParams;
+	ProfileIntrinsics intrinsics = {
+		{ p->FocalLength.x, p->FocalLength.y },
+		{ p->PrincipalPoint.x, p->PrincipalPoint.y },
+		{ p->RadialDistortion.x, p->RadialDistortion.y, p->RadialDistortion.z },
+		{ p->TangentialDistortion.x, p->TangentialDistortion.y },
+		p->ImageWidth,
+		p->ImageHeight };
+
+	ProfileEye eyes[2] = {};
+	FillEye(eyes[0], profile->RightEyeTransform, profile->RightEyeRmsError, nRight);
+	FillEye(eyes[1], profile->LeftEyeTransform, profile->LeftEyeRmsError, nLeft);
+
+	// Assemble the whole file in memory, header is filled last
+	std::vector<uint8_t> buffer(sizeof(ProfileFileHeader));
+	buffer.reserve(
+		sizeof(ProfileFileHeader) + sizeof(ProfileIntrinsics) + sizeof(eyes) +
+		(nRight + nLeft) * sizeof(ProfileCorrespondence));
+
+	const uint8_t* intrinsicsBytes = reinterpret_cast<const uint8_t*>(&intrinsics);
+	buffer.insert(buffer.end(), intrinsicsBytes, intrinsicsBytes + sizeof(intrinsics));
+	const uint8_t* eyeBytes = reinterpret_cast<const uint8_t*>(eyes);
+	buffer.insert(buffer.end(), eyeBytes, eyeBytes + sizeof(eyes));
+	AppendCorrespondences(buffer, profile->RightEyeCameraPoints, profile->RightEyeMarkerPoints, nRight);
+	AppendCorrespondences(buffer, profile->LeftEyeCameraPoints, profile->LeftEyeMarkerPoints, nLeft);
+
+	FILETIME now = {};
+	GetSystemTimeAsFileTime(&now);
+
+	ProfileFileHeader header = {};
+	header.magic = ProfileMagic;
+	header.version = ProfileVersion;
+	header.headerSize = sizeof(ProfileFileHeader);
+	header.payloadSize = (uint32_t)(buffer.size() - sizeof(ProfileFileHeader));
+	header.payloadCrc32 = Crc32(buffer.data() + sizeof(ProfileFileHeader), header.payloadSize);
+	header.createdTime = ((uint64_t)now.dwHighDateTime << 32) | now.dwLowDateTime;
+	memcpy(buffer.data(), &header, sizeof(header));
+
+	// Write to a temporary file and swap it in, so a crash during the
+	// write never leaves a truncated profile behind
+	const std::wstring path = GetProfilePath(profile->UserId);
+	const std::wstring tempPath = path + L".tmp";
+
+	HANDLE file = CreateFile2(
+		tempPath.c_str(),
+		GENERIC_WRITE,
+		0,
+		CREATE_ALWAYS,
+		nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		dbg::trace(L"CalibrationProfileStore::Save: failed to create %s", tempPath.c_str());
+		return false;
+	}
+
+	DWORD written = 0;
+	const BOOL isWritten = WriteFile(file, buffer.data(), (DWORD)buffer.size(), &written, nullptr);
+	CloseHandle(file);
+
+	if (!isWritten || written != buffer.size() ||
+		!MoveFileExW(tempPath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING))
+	{
+		dbg::trace(L"CalibrationProfileStore::Save: failed to write %s", path.c_str());
+		DeleteFileW(tempPath.c_str());
+		return false;
+	}
+
+	dbg::trace(
+		L"CalibrationProfileStore::Save: saved profile with %i right and %i left eye correspondences.",
+		nRight, nLeft);
+
+	return true;
+}
+
+HMDCalibration::CalibrationProfile^ HMDCalibration::CalibrationProfileStore::TryLoad(
+	Platform::String^ userId,
+	OpenCVRuntimeComponent::CameraCalibrationParams^ currentCameraCalibrationParams)
+{
+	MappedFile mappedFile(GetProfilePath(userId));
+
+	const uint8_t* data = mappedFile.Data();
+	const size_t size = mappedFile.Size();
+	const size_t fixedSize = sizeof(ProfileFileHeader) + sizeof(ProfileIntrinsics) + 2 * sizeof(ProfileEye);
+
+	if (data == nullptr || size < fixedSize)
+	{
+		dbg::trace(L"CalibrationProfileStore::TryLoad: no cached profile.");
+		return nullptr;
+	}
+
+	// Validate header, sizes and checksum before touching the payload
+	ProfileFileHeader header;
+	memcpy(&header, data, sizeof(header));
+
+	if (header.magic != ProfileMagic ||
+		header.version != ProfileVersion ||
+		header.headerSize != sizeof(ProfileFileHeader) ||
+		header.payloadSize != size - sizeof(ProfileFileHeader))
+	{
+		dbg::trace(L"CalibrationProfileStore::TryLoad: unrecognized profile header.");
+		return nullptr;
+	}
+
+	const uint8_t* payload = data + sizeof(ProfileFileHeader);
+	if (Crc32(payload, header.payloadSize) != header.payloadCrc32)
+	{
+		dbg::trace(L"CalibrationProfileStore::TryLoad: profile checksum mismatch.");
+		return nullptr;
+	}
+
+	ProfileIntrinsics intrinsics;
+	memcpy(&intrinsics, payload, sizeof(intrinsics));
+
+	ProfileEye eyes[2];
+	memcpy(eyes, payload + sizeof(intrinsics), sizeof(eyes));
+
+	const uint64_t nCorrespondences = (uint64_t)eyes[0].numCorrespondences + eyes[1].numCorrespondences;
+	if (fixedSize + nCorrespondences * sizeof(ProfileCorrespondence) != size)
+	{
+		dbg::trace(L"CalibrationProfileStore::TryLoad: profile size mismatch.");
+		return nullptr;
+	}
+
+	// Profile is only valid for the intrinsics it was computed with
+	if (currentCameraCalibrationParams != nullptr)
+	{
+		auto p = currentCameraCalibrationParams;
+		const float tol = IntrinsicsTolerance;
+		const float distTol = DistortionTolerance;
+		if (p->ImageWidth != intrinsics.imageWidth ||
+			p->ImageHeight != intrinsics.imageHeight ||
+			std::abs(p->FocalLength.x - intrinsics.focalLength[0]) > tol ||
+			std::abs(p->FocalLength.y - intrinsics.focalLength[1]) > tol ||
+			std::abs(p->PrincipalPoint.x - intrinsics.principalPoint[0]) > tol ||
+			std::abs(p->PrincipalPoint.y - intrinsics.principalPoint[1]) > tol ||
+			std::abs(p->RadialDistortion.x - intrinsics.radialDistortion[0]) > distTol ||
+			std::abs(p->RadialDistortion.y - intrinsics.radialDistortion[1]) > distTol ||
+			std::abs(p->RadialDistortion.z - intrinsics.radialDistortion[2]) > distTol ||
+			std::abs(p->TangentialDistortion.x - intrinsics.tangentialDistortion[0]) > distTol ||
+			std::abs(p->TangentialDistortion.y - intrinsics.tangentialDistortion[1]) > distTol)
+		{
+			dbg::trace(L"CalibrationProfileStore::TryLoad: camera intrinsics changed, profile discarded.");
+			return nullptr;
+		}
+	}
+
+	// Correspondences are not guaranteed to be aligned in the mapped view
+	std::vector<ProfileCorrespondence> correspondences((size_t)nCorrespondences);
+	if (nCorrespondences > 0)
+	{
+		memcpy(correspondences.data(), payload + sizeof(intrinsics) + sizeof(eyes),
+			correspondences.size() * sizeof(ProfileCorrespondence));
+	}
+
+	auto rightCameraPoints = ref new Platform::Collections::Vector<float3>();
+	auto rightMarkerPoints = ref new Platform::Collections::Vector<float3>();
+	auto leftCameraPoints = ref new Platform::Collections::Vector<float3>();
+	auto leftMarkerPoints = ref new Platform::Collections::Vector<float3>();
+	ReadCorrespondences(correspondences.data(), eyes[0].numCorrespondences, rightCameraPoints, rightMarkerPoints);
+	ReadCorrespondences(correspondences.data() + eyes[0].numCorrespondences, eyes[1].numCorrespondences, leftCameraPoints, leftMarkerPoints);
+
+	auto cameraCalibrationParams = ref new OpenCVRuntimeComponent::CameraCalibrationParams(
+		float2(intrinsics.focalLength[0], intrinsics.focalLength[1]),
+		float2(intrinsics.principalPoint[0], intrinsics.principalPoint[1]),
+		float3(intrinsics.radialDistortion[0], intrinsics.radialDistortion[1], intrinsics.radialDistortion[2]),
+		float2(intrinsics.tangentialDistortion[0], intrinsics.tangentialDistortion[1]),
+		intrinsics.imageWidth,
+		intrinsics.imageHeight);
+
+	dbg::trace(
+		L"CalibrationProfileStore::TryLoad: loaded profile, rms error right: %f, left: %f",
+		eyes[0].rmsError, eyes[1].rmsError);
+
+	return ref new CalibrationProfile(
+		userId,
+		cameraCalibrationParams,
+		TransformFromEye(eyes[0]),
+		rightCameraPoints,
+		rightMarkerPoints,
+		eyes[0].rmsError,
+		TransformFromEye(eyes[1]),
+		leftCameraPoints,
+		leftMarkerPoints,
+		eyes[1].rmsError);
+}
+
+bool HMDCalibration::CalibrationProfileStore::Remove(
+	Platform::String^ userId)
+{
+	return DeleteFileW(GetProfilePath(userId).c_str()) != 0;
+}
+
+std::wstring HMDCalibration::CalibrationProfileStore::GetProfilePath(
+	Platform::String^ userId)
+{
+	// Hex digits of each UTF-16 code unit, distinct user ids never share
+	// a file, also on the case-insensitive file system
+	static const wchar_t hexDigits[] = L"0123456789abcdef";
+	std::wstring name;
+	if (userId != nullptr)
+	{
+		for (const wchar_t* c = userId->Data(); *c != L'\0'; c++)
+		{
+			for (int shift = 12; shift >= 0; shift -= 4)
+			{
+				name += hexDigits[(*c >> shift) & 0xF];
+			}
+		}
+	}
+	if (name.empty())
+	{
+		name = L"default";
+	}
+
+	return _folderPath + L"\\CalibrationProfile_" + name + L".bin";
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include "CalibrationProfile.h"
+#include "CameraCalibrationParams.h"
+
+using namespace Windows::Foundation::Collections;
+using namespace Windows::Foundation::Numerics;
+
+namespace OpenCVRuntimeComponent
+{
+	namespace HMDCalibration
+	{
+		// Persists calibration profiles to a versioned binary file per user
+		// in the app local folder, so returning users can skip recalibration.
+		// Profiles are read back with a single read-only memory map and are
+		// rejected if the header, checksum or camera intrinsics do not match.
+		public ref class CalibrationProfileStore sealed
+		{
+		public:
+			// Profiles are stored in the app local folder
+			CalibrationProfileStore();
+
+			// Profiles are stored in the given folder (must already exist)
+			CalibrationProfileStore(_In_ Platform::String^ folderPath);
+
+			// Write the profile to disk, replacing any previous profile
+			// of the same user id. Returns false on failure.
+			bool Save(_In_ CalibrationProfile^ profile);
+
+			// Load the cached profile of a user. Returns nullptr if there is
+			// no profile, if it fails validation or if it was computed with
+			// intrinsics that differ from the current camera parameters. Pass
+			// nullptr for the camera parameters to skip the intrinsics check.
+			CalibrationProfile^ TryLoad(
+				_In_ Platform::String^ userId,
+				_In_ OpenCVRuntimeComponent::CameraCalibrationParams^ currentCameraCalibrationParams);
+
+			// Delete the cached profile of a user, returns true if removed.
+			bool Remove(_In_ Platform::String^ userId);
+
+			// Tolerance (pixels) used when comparing focal length and
+			// principal point with the current camera parameters.
+			property float IntrinsicsTolerance;
+
+			// Tolerance used when comparing the radial and tangential
+			// distortion coefficients with the current camera parameters.
+			property float DistortionTolerance;
+
+		private:
+			std::wstring _folderPath;
+
+			std::wstring GetProfilePath(Platform::String^ userId);
+		};
+	}
+}
@@ -1,5 +1,9 @@
 #include "pch.h"
 #include "CameraCalibrationParams.h"
+#include "IntrinsicCalibration.h"
+
+#include <fstream>
+#include <iterator>
 
 OpenCVRuntimeComponent::CameraCalibrationParams::CameraCalibrationParams(
     float2 focalLength, 
@@ -16,3 +20,76 @@ OpenCVRuntimeComponent::CameraCalibrationParams::CameraCalibrationParams(
     ImageHeight = imageHeight;
 }
 
+namespace
+{
+    std::string ToUtf8(Platform::String^ s)
+    {
+        if (s == nullptr || s->Length() == 0)
+        {
+            return std::string();
+        }
+
+        const int size = WideCharToMultiByte(CP_UTF8, 0, s->Data(), (int)s->Length(), nullptr, 0, nullptr, nullptr);
+        std::string utf8(size, '\0');
+        WideCharToMultiByte(CP_UTF8, 0, s->Data(), (int)s->Length(), &utf8[0], size, nullptr, nullptr);
+        return utf8;
+    }
+
+    OpenCVRuntimeComponent::CameraCalibrationParams^ FromIntrinsics(
+        const OpenCVRuntimeComponent::ArUcoTracking::CameraIntrinsics& intrinsics)
+    {
+        const cv::Mat& k = intrinsics.cameraMatrix;
+        const cv::Mat& d = intrinsics.distortionCoefficients;
+        const double k3 = d.total() > 4 ? d.at<double>(0, 4) : 0.0;
+
+        return ref new OpenCVRuntimeComponent::CameraCalibrationParams(
+            float2((float)k.at<double>(0, 0), (float)k.at<double>(1, 1)),
+            float2((float)k.at<double>(0, 2), (float)k.at<double>(1, 2)),
+            float3((float)d.at<double>(0, 0), (float)d.at<double>(0, 1), (float)k3),
+            float2((float)d.at<double>(0, 2), (float)d.at<double>(0, 3)),
+            intrinsics.imageSize.width,
+            intrinsics.imageSize.height);
+    }
+}
+
+OpenCVRuntimeComponent::CameraCalibrationParams^ OpenCVRuntimeComponent::CameraCalibrationParams::FromCalibrationFile(
+    Platform::String^ path)
+{
+    if (path == nullptr)
+    {
+        return nullptr;
+    }
+
+    // Read through the wide path, FileStorage only takes narrow paths
+    std::ifstream stream(path->Data(), std::ios::binary);
+    if (!stream.is_open())
+    {
+        dbg::trace(L"CameraCalibrationParams::FromCalibrationFile: cannot open %s", path->Data());
+        return nullptr;
+    }
+
+    const std::string text(
+        (std::istreambuf_iterator<char>(stream)),
+        std::istreambuf_iterator<char>());
+
+    OpenCVRuntimeComponent::ArUcoTracking::CameraIntrinsics intrinsics;
+    if (!OpenCVRuntimeComponent::ArUcoTracking::ParseCameraIntrinsics(text, intrinsics))
+    {
+        dbg::trace(L"CameraCalibrationParams::FromCalibrationFile: %s is not a calibration file", path->Data());
+        return nullptr;
+    }
+
+    return FromIntrinsics(intrinsics);
+}
+
+OpenCVRuntimeComponent::CameraCalibrationParams^ OpenCVRuntimeComponent::CameraCalibrationParams::FromCalibrationText(
+    Platform::String^ text)
+{
+    OpenCVRuntimeComponent::ArUcoTracking::CameraIntrinsics intrinsics;
+    if (!OpenCVRuntimeComponent::ArUcoTracking::ParseCameraIntrinsics(ToUtf8(text), intrinsics))
+    {
+        return nullptr;
+    }
+
+    return FromIntrinsics(intrinsics);
+}
@@ -22,6 +22,12 @@ namespace OpenCVRuntimeComponent
         property float2 TangentialDistortion;
         property int ImageWidth;
         property int ImageHeight;
+
+        // Intrinsics written by CustomArUcoBoards --calibrate (OpenCV
+        // FileStorage YAML or XML), from a file path or the document
+        // text. Returns nullptr if the document cannot be read.
+        static CameraCalibrationParams^ FromCalibrationFile(_In_ Platform::String^ path);
+        static CameraCalibrationParams^ FromCalibrationText(_In_ Platform::String^ text);
     };
 }
 
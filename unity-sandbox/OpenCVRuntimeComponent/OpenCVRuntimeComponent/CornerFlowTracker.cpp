@@ -0,0 +1,177 @@
+#include "CornerFlowTracker.h"
+#include "MarkerBitSampler.h"
+
+#include <opencv2/video/tracking.hpp>
+
+namespace OpenCVRuntimeComponent
+{
+	namespace ArUcoTracking
+	{
+		namespace
+		{
+			// Lucas-Kanade window and pyramid depth, the window covers the
+			// corner neighbourhood of small markers at the camera resolution
+			const cv::Size FlowWindowSize(21, 21);
+			const int FlowMaxLevel = 3;
+			const cv::TermCriteria FlowCriteria(
+				cv::TermCriteria::COUNT | cv::TermCriteria::EPS, 20, 0.03);
+
+			// Minimum number of tracked markers, the board pose
+			// estimation needs more than one
+			const size_t MinTrackedMarkers = 2;
+		}
+
+		CornerFlowTracker::CornerFlowTracker()
+			: _isEnabled(false),
+			_redetectPeriod(5),
+			_maxForwardBackwardError(1.0),
+			_minTrackedFraction(0.75),
+			_isTracking(false),
+			_framesSinceDetection(0),
+			_numDetectedMarkers(0),
+			_lastForwardBackwardError(0.0)
+		{
+			_verifyParams = cv::aruco::DetectorParameters::create();
+		}
+
+		void CornerFlowTracker::SetDictionary(const cv::Ptr<cv::aruco::Dictionary>& dictionary)
+		{
+			_dictionary = dictionary;
+		}
+
+		void CornerFlowTracker::Configure(
+			bool isEnabled,
+			int redetectPeriod,
+			double maxForwardBackwardError,
+			double minTrackedFraction)
+		{
+			_isEnabled = isEnabled;
+			_redetectPeriod = redetectPeriod;
+			_maxForwardBackwardError = maxForwardBackwardError;
+			_minTrackedFraction = minTrackedFraction;
+			Reset();
+		}
+
+		void CornerFlowTracker::Start(
+			const cv::Mat& grayFrame,
+			const std::vector<std::vector<cv::Point2f>>& markers,
+			const std::vector<int32_t>& markerIds)
+		{
+			if (!_isEnabled || markers.size() < MinTrackedMarkers)
+			{
+				Reset();
+				return;
+			}
+
+			_corners.clear();
+			for (const auto& marker : markers)
+			{
+				_corners.insert(_corners.end(), marker.begin(), marker.end());
+			}
+			_markerIds = markerIds;
+
+			cv::buildOpticalFlowPyramid(grayFrame, _previousPyramid, FlowWindowSize, FlowMaxLevel);
+
+			_isTracking = true;
+			_framesSinceDetection = 0;
+			_numDetectedMarkers = markers.size();
+		}
+
+		bool CornerFlowTracker::Track(
+			const cv::Mat& grayFrame,
+			std::vector<std::vector<cv::Point2f>>& markers,
+			std::vector<int32_t>& markerIds)
+		{
+			_lastForwardBackwardError = 0.0;
+
+			if (!_isEnabled || !_isTracking ||
+				++_framesSinceDetection >= _redetectPeriod ||
+				grayFrame.size() != _previousPyramid[0].size())
+			{
+				Reset();
+				return false;
+			}
+
+			cv::buildOpticalFlowPyramid(grayFrame, _currentPyramid, FlowWindowSize, FlowMaxLevel);
+
+			// Forward pass into the new frame and backward pass to the
+			// previous frame, a well tracked corner returns to its start
+			cv::calcOpticalFlowPyrLK(
+				_previousPyramid, _currentPyramid,
+				_corners, _forward,
+				_forwardStatus, _error,
+				FlowWindowSize, FlowMaxLevel, FlowCriteria);
+
+			cv::calcOpticalFlowPyrLK(
+				_currentPyramid, _previousPyramid,
+				_forward, _backward,
+				_backwardStatus, _error,
+				FlowWindowSize, FlowMaxLevel, FlowCriteria);
+
+			// Keep the markers that have all four corners tracked
+			markers.clear();
+			markerIds.clear();
+
+			std::vector<cv::Point2f> corners;
+			std::vector<int32_t> ids;
+			double errorSum = 0.0;
+
+			for (size_t m = 0; m < _markerIds.size(); m++)
+			{
+				bool isTracked = true;
+				double markerError = 0.0;
+				for (size_t c = 4 * m; c < 4 * m + 4 && isTracked; c++)
+				{
+					const double error = cv::norm(_backward[c] - _corners[c]);
+					isTracked = _forwardStatus[c] && _backwardStatus[c] &&
+						error <= _maxForwardBackwardError;
+					markerError += error;
+				}
+
+				if (!isTracked)
+				{
+					continue;
+				}
+
+				// Corners that slid onto other image content no longer
+				// sample the bits of the marker
+				std::vector<cv::Point2f> marker(_forward.begin() + 4 * m, _forward.begin() + 4 * m + 4);
+				if (!_dictionary.empty() &&
+					!VerifyMarker(grayFrame, marker, *_dictionary, _markerIds[m], *_verifyParams))
+				{
+					continue;
+				}
+
+				markers.push_back(marker);
+				markerIds.push_back(_markerIds[m]);
+				corners.insert(corners.end(), _forward.begin() + 4 * m, _forward.begin() + 4 * m + 4);
+				ids.push_back(_markerIds[m]);
+				errorSum += markerError;
+			}
+
+			if (markerIds.size() < MinTrackedMarkers ||
+				markerIds.size() < _minTrackedFraction * _numDetectedMarkers)
+			{
+				markers.clear();
+				markerIds.clear();
+				Reset();
+				return false;
+			}
+
+			_lastForwardBackwardError = errorSum / corners.size();
+
+			// The tracked corners become the start of the next frame
+			_corners.swap(corners);
+			_markerIds.swap(ids);
+			_previousPyramid.swap(_currentPyramid);
+
+			return true;
+		}
+
+		void CornerFlowTracker::Reset()
+		{
+			_isTracking = false;
+			_framesSinceDetection = 0;
+		}
+	}
+}
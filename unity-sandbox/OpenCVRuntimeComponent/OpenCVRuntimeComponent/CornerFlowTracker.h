@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <opencv2/core.hpp>
+#include <opencv2/aruco.hpp>
+
+namespace OpenCVRuntimeComponent
+{
+	namespace ArUcoTracking
+	{
+		// Tracks the corners of detected markers between full detections
+		// with pyramidal Lucas-Kanade optical flow. Each corner is tracked
+		// forward to the new frame and back again; markers with a corner
+		// that is lost or whose forward-backward error is too large are
+		// dropped, as are markers whose bits no longer decode to their id
+		// once a dictionary is set. Full detection is requested every
+		// redetectPeriod frames or once too few markers are left. Tracking
+		// is off until configured, every frame is then fully detected.
+		class CornerFlowTracker
+		{
+		public:
+			CornerFlowTracker();
+
+			// maxForwardBackwardError is in pixels, minTrackedFraction is the
+			// fraction of the markers of the last detection that must be
+			// tracked for the frame to be accepted
+			void Configure(
+				bool isEnabled,
+				int redetectPeriod,
+				double maxForwardBackwardError,
+				double minTrackedFraction);
+
+			// Start tracking the markers of a full detection
+			void Start(
+				const cv::Mat& grayFrame,
+				const std::vector<std::vector<cv::Point2f>>& markers,
+				const std::vector<int32_t>& markerIds);
+
+			// Track the markers into the next frame. Returns false if full
+			// detection is required, otherwise markers and markerIds hold
+			// the tracked markers.
+			bool Track(
+				const cv::Mat& grayFrame,
+				std::vector<std::vector<cv::Point2f>>& markers,
+				std::vector<int32_t>& markerIds);
+
+			void Reset();
+
+			// Verify the id of each tracked marker from its cell bits, one
+			// bit extraction per tracked marker and frame
+			void SetDictionary(const cv::Ptr<cv::aruco::Dictionary>& dictionary);
+
+			bool IsTracking() const { return _isTracking; }
+
+			// Mean forward-backward error (pixels) of the last tracked frame
+			double LastForwardBackwardError() const { return _lastForwardBackwardError; }
+
+		private:
+			bool _isEnabled;
+			int _redetectPeriod;
+			double _maxForwardBackwardError;
+			double _minTrackedFraction;
+
+			bool _isTracking;
+			int _framesSinceDetection;
+			size_t _numDetectedMarkers;
+			double _lastForwardBackwardError;
+
+			cv::Ptr<cv::aruco::Dictionary> _dictionary;
+			cv::Ptr<cv::aruco::DetectorParameters> _verifyParams;
+
+			// Image pyramid of the previous frame and the tracked corners
+			// in it, four per marker
+			std::vector<cv::Mat> _previousPyramid;
+			std::vector<cv::Point2f> _corners;
+			std::vector<int32_t> _markerIds;
+
+			// Scratch buffers reused across frames
+			std::vector<cv::Mat> _currentPyramid;
+			std::vector<cv::Point2f> _forward;
+			std::vector<cv::Point2f> _backward;
+			std::vector<uchar> _forwardStatus;
+			std::vector<uchar> _backwardStatus;
+			std::vector<float> _error;
+		};
+	}
+}
@@ -9,6 +9,70 @@
 using namespace OpenCVRuntimeComponent;
 using namespace Platform;
 
+// Pose history interpolation limits (100 ns ticks). Samples further
+// apart than the gap are not interpolated, the newest sample is held
+// for up to the extrapolation limit.
+static const int64_t PoseHistoryMaxGap = 2000000; // 200 ms
+static const int64_t PoseHistoryMaxExtrapolation = 500000; // 50 ms
+
+// Board to world transform in the Unity convention, matches the managed
+// composition cameraToWorldUnity * transformUnityCamera of the board
+// (see ArUcoUtils.GetTransformInUnityCamera and
+// NetworkBehaviour.GetViewToUnityTransform)
+static float4x4 ComposeBoardToWorldUnity(
+	float3 position,
+	float3 rotation,
+	float4x4 cameraToWorld)
+{
+	cv::Matx33d r;
+	cv::Rodrigues(cv::Vec3d(rotation.x, rotation.y, rotation.z), r);
+
+	// Rodrigues rotation with the y axis mirrored, rotated 180 degrees
+	// about z so the board axes match the Unity game objects
+	const cv::Matx33d flipY(1, 0, 0, 0, -1, 0, 0, 0, 1);
+	const cv::Matx33d rotZ180(-1, 0, 0, 0, -1, 0, 0, 0, 1);
+	const cv::Matx33d rUnity = flipY * r * flipY * rotZ180;
+
+	// Camera relative board transform, right-handed (OpenCV) to
+	// left-handed (Unity) by flipping y of the translation and the z row
+	cv::Matx44d boardToCamera = cv::Matx44d::eye();
+	for (int i = 0; i < 3; i++)
+	{
+		for (int j = 0; j < 3; j++)
+		{
+			boardToCamera(i, j) = rUnity(i, j);
+		}
+	}
+	boardToCamera(0, 3) = position.x;
+	boardToCamera(1, 3) = -position.y;
+	boardToCamera(2, 3) = position.z;
+
+	// WinRT transform -> Unity transform by transpose and flip z values
+	cv::Matx44d cameraToWorldUnity;
+	const float* m = &cameraToWorld.m11;
+	for (int i = 0; i < 4; i++)
+	{
+		for (int j = 0; j < 4; j++)
+		{
+			cameraToWorldUnity(i, j) = m[j * 4 + i];
+		}
+	}
+
+	for (int j = 0; j < 4; j++)
+	{
+		boardToCamera(2, j) *= -1.0;
+		cameraToWorldUnity(2, j) *= -1.0;
+	}
+
+	const cv::Matx44d w = cameraToWorldUnity * boardToCamera;
+
+	return float4x4(
+		(float)w(0, 0), (float)w(0, 1), (float)w(0, 2), (float)w(0, 3),
+		(float)w(1, 0), (float)w(1, 1), (float)w(1, 2), (float)w(1, 3),
+		(float)w(2, 0), (float)w(2, 1), (float)w(2, 2), (float)w(2, 3),
+		(float)w(3, 0), (float)w(3, 1), (float)w(3, 2), (float)w(3, 3));
+}
+
 CvUtils::CvUtils(
 	float markerSize,
 	int numMarkers,
@@ -22,6 +86,16 @@ CvUtils::CvUtils(
 		customObjectPoints);
 
 	_pointCorrespondences = ref new HMDCalibration::PointCorrespondences();
+
+	_boardPoseHistory.reset(new ArUcoTracking::PoseHistory());
+	_headPoseHistory.reset(new ArUcoTracking::PoseHistory());
+	_lastHistoryFrameSequence = -1;
+
+	_parallelDetector.reset(new ArUcoTracking::ParallelBoardDetector(
+		markerSize,
+		numMarkers,
+		dictId,
+		customObjectPoints));
 }
 
 IVector<ArUcoTracking::DetectedArUcoMarker^>^ 
@@ -29,6 +103,9 @@ OpenCVRuntimeComponent::CvUtils::DetectMarkers(
 	SoftwareBitmap^ softwareBitmap,
 	CameraCalibrationParams^ cameraCalibrationParams)
 {
+	// Tracker state is shared by all calls, detections run one at a time
+	std::lock_guard<std::mutex> lock(_trackerLock);
+
 	return _arUcoMarkerTracker->DetectArUcoMarkersInFrame(
 		softwareBitmap, 
 		cameraCalibrationParams);
@@ -39,11 +116,327 @@ OpenCVRuntimeComponent::CvUtils::DetectBoard(
 	SoftwareBitmap^ softwareBitmap,
 	CameraCalibrationParams^ cameraCalibrationParams)
 {
+	std::lock_guard<std::mutex> lock(_trackerLock);
+
 	return _arUcoMarkerTracker->DetectBoardInFrame(
 		softwareBitmap,
 		cameraCalibrationParams);
 }
 
+int OpenCVRuntimeComponent::CvUtils::RegisterBoard(
+	float markerSize,
+	int firstMarkerId,
+	IVector<Windows::Foundation::Numerics::float3>^ customObjectPoints)
+{
+	std::lock_guard<std::mutex> lock(_trackerLock);
+
+	return _arUcoMarkerTracker->RegisterBoard(
+		markerSize,
+		firstMarkerId,
+		customObjectPoints);
+}
+
+IVector<ArUcoTracking::DetectedArUcoBoard^>^
+OpenCVRuntimeComponent::CvUtils::DetectBoards(
+	SoftwareBitmap^ softwareBitmap,
+	CameraCalibrationParams^ cameraCalibrationParams)
+{
+	std::lock_guard<std::mutex> lock(_trackerLock);
+
+	return _arUcoMarkerTracker->DetectBoardsInFrame(
+		softwareBitmap,
+		cameraCalibrationParams);
+}
+
+ArUcoTracking::DetectedArUcoBoard^
+OpenCVRuntimeComponent::CvUtils::DetectBoardAtTime(
+	SoftwareBitmap^ softwareBitmap,
+	CameraCalibrationParams^ cameraCalibrationParams,
+	Windows::Foundation::TimeSpan captureTime)
+{
+	std::lock_guard<std::mutex> lock(_trackerLock);
+
+	// The board pose history has a single producer, the results of the
+	// parallel workers while they run
+	if (_parallelDetector->IsEnabled())
+	{
+		throw ref new Platform::COMException(
+			E_ILLEGAL_METHOD_CALL,
+			L"CvUtils::DetectBoardAtTime: parallel detection is running, submit the frame instead.");
+	}
+
+	auto board = _arUcoMarkerTracker->DetectBoardInFrameAtTime(
+		softwareBitmap,
+		cameraCalibrationParams,
+		captureTime);
+
+	// Repeated frames return the cached result, its pose is already
+	// in the history
+	if (board->IsDetected && board->FrameSequence != _lastHistoryFrameSequence)
+	{
+		_lastHistoryFrameSequence = board->FrameSequence;
+		PushBoardPose(board);
+	}
+
+	return board;
+}
+
+void OpenCVRuntimeComponent::CvUtils::PushBoardPose(
+	ArUcoTracking::DetectedArUcoBoard^ board)
+{
+	// Board rotation is a rodrigues vector (axis * angle)
+	const float angle = length(board->Rotation);
+	const quaternion q = angle > 0.0f
+		? make_quaternion_from_axis_angle(board->Rotation / angle, angle)
+		: quaternion::identity();
+
+	const float position[3] = { board->Position.x, board->Position.y, board->Position.z };
+	const float orientation[4] = { q.x, q.y, q.z, q.w };
+	_boardPoseHistory->Push(board->Timestamp.Duration, position, orientation);
+}
+
+void OpenCVRuntimeComponent::CvUtils::ConfigureParallelDetection(
+	int numWorkers,
+	int maxInFlight)
+{
+	// Serial detections of the board pose history are not interleaved
+	// with the start of the workers
+	std::lock_guard<std::mutex> lock(_trackerLock);
+
+	_parallelDetector->Configure(
+		numWorkers,
+		maxInFlight);
+}
+
+bool OpenCVRuntimeComponent::CvUtils::SubmitBoardFrame(
+	SoftwareBitmap^ softwareBitmap,
+	CameraCalibrationParams^ cameraCalibrationParams,
+	Windows::Foundation::TimeSpan captureTime)
+{
+	if (softwareBitmap == nullptr || !_parallelDetector->IsEnabled())
+	{
+		return false;
+	}
+
+	// The frame is copied on submission, the bitmap can be disposed
+	// once the call returns
+	cv::Mat wrappedMat;
+	const FrameView frame = ConversionUtils::WrapHoloLensSoftwareBitmapWithCvMat(
+		softwareBitmap,
+		wrappedMat);
+
+	return _parallelDetector->Submit(
+		wrappedMat,
+		cameraCalibrationParams,
+		captureTime);
+}
+
+IVector<ArUcoTracking::DetectedArUcoBoard^>^
+OpenCVRuntimeComponent::CvUtils::TakeCompletedBoards()
+{
+	std::vector<ArUcoTracking::DetectedArUcoBoard^> completed;
+	_parallelDetector->TakeCompleted(completed);
+
+	auto boards = ref new Platform::Collections::Vector<ArUcoTracking::DetectedArUcoBoard^>();
+
+	std::lock_guard<std::mutex> lock(_trackerLock);
+	for (auto board : completed)
+	{
+		if (board->IsDetected)
+		{
+			PushBoardPose(board);
+		}
+		boards->Append(board);
+	}
+
+	return boards;
+}
+
+int OpenCVRuntimeComponent::CvUtils::FramesInFlight::get()
+{
+	return _parallelDetector->InFlight();
+}
+
+ArUcoTracking::DetectedArUcoBoard^
+OpenCVRuntimeComponent::CvUtils::DetectBoardInWorld(
+	SoftwareBitmap^ softwareBitmap,
+	CameraCalibrationParams^ cameraCalibrationParams,
+	Windows::Foundation::TimeSpan captureTime,
+	IBox<float4x4>^ cameraToWorld)
+{
+	auto detected = DetectBoardAtTime(
+		softwareBitmap,
+		cameraCalibrationParams,
+		captureTime);
+
+	// A repeated frame returns the result the tracker already handed
+	// out, the world pose of this call goes on a copy
+	auto board = ref new ArUcoTracking::DetectedArUcoBoard(
+		detected->Position,
+		detected->Rotation,
+		detected->IsDetected);
+	board->BoardIndex = detected->BoardIndex;
+	board->Quality = detected->Quality;
+	board->FrameSequence = detected->FrameSequence;
+	board->Timestamp = detected->Timestamp;
+
+	if (!board->IsDetected || cameraToWorld == nullptr)
+	{
+		return board;
+	}
+
+	// Unity matrices are stored as float4x4 element for element (mRC),
+	// the column vector transform is transposed back to the row vector
+	// layout for the rotation quaternion
+	const float4x4 boardToWorld = ComposeBoardToWorldUnity(
+		board->Position,
+		board->Rotation,
+		cameraToWorld->Value);
+
+	board->WorldTransform = boardToWorld;
+	board->WorldPosition = float3(boardToWorld.m14, boardToWorld.m24, boardToWorld.m34);
+	board->WorldRotation = normalize(make_quaternion_from_rotation_matrix(transpose(boardToWorld)));
+	board->HasWorldPose = true;
+
+	return board;
+}
+
+void OpenCVRuntimeComponent::CvUtils::PushHeadPose(
+	Windows::Foundation::TimeSpan time,
+	float3 position,
+	quaternion orientation)
+{
+	const float p[3] = { position.x, position.y, position.z };
+	const float q[4] = { orientation.x, orientation.y, orientation.z, orientation.w };
+	_headPoseHistory->Push(time.Duration, p, q);
+}
+
+ArUcoTracking::TimedPose^
+OpenCVRuntimeComponent::CvUtils::GetBoardPoseAtTime(
+	Windows::Foundation::TimeSpan time)
+{
+	return QueryPoseHistory(*_boardPoseHistory, time);
+}
+
+ArUcoTracking::TimedPose^
+OpenCVRuntimeComponent::CvUtils::GetHeadPoseAtTime(
+	Windows::Foundation::TimeSpan time)
+{
+	return QueryPoseHistory(*_headPoseHistory, time);
+}
+
+ArUcoTracking::TimedPose^
+OpenCVRuntimeComponent::CvUtils::QueryPoseHistory(
+	const ArUcoTracking::PoseHistory& history,
+	Windows::Foundation::TimeSpan time)
+{
+	const ArUcoTracking::TimedPoseSample sample = history.Query(
+		time.Duration,
+		PoseHistoryMaxGap,
+		PoseHistoryMaxExtrapolation);
+
+	return ref new ArUcoTracking::TimedPose(
+		time,
+		float3(sample.position[0], sample.position[1], sample.position[2]),
+		quaternion(sample.orientation[0], sample.orientation[1], sample.orientation[2], sample.orientation[3]),
+		sample.isValid);
+}
+
+void OpenCVRuntimeComponent::CvUtils::ConfigureMotionGating(
+	bool isEnabled,
+	float threshold,
+	int refreshPeriod)
+{
+	std::lock_guard<std::mutex> lock(_trackerLock);
+
+	_arUcoMarkerTracker->ConfigureMotionGating(
+		isEnabled,
+		threshold,
+		refreshPeriod);
+}
+
+void OpenCVRuntimeComponent::CvUtils::ConfigureCornerTracking(
+	bool isEnabled,
+	int redetectPeriod,
+	float maxForwardBackwardError,
+	float minTrackedFraction)
+{
+	std::lock_guard<std::mutex> lock(_trackerLock);
+
+	_arUcoMarkerTracker->ConfigureCornerTracking(
+		isEnabled,
+		redetectPeriod,
+		maxForwardBackwardError,
+		minTrackedFraction);
+}
+
+void OpenCVRuntimeComponent::CvUtils::ConfigureDetectorTuning(
+	bool isEnabled,
+	int rewidenPeriod)
+{
+	std::lock_guard<std::mutex> lock(_trackerLock);
+
+	_arUcoMarkerTracker->ConfigureDetectorTuning(
+		isEnabled,
+		rewidenPeriod);
+}
+
+void OpenCVRuntimeComponent::CvUtils::ConfigureQualityControl(
+	bool isEnabled,
+	float budgetMilliseconds)
+{
+	std::lock_guard<std::mutex> lock(_trackerLock);
+
+	_arUcoMarkerTracker->ConfigureQualityControl(
+		isEnabled,
+		budgetMilliseconds);
+	_parallelDetector->ConfigureQualityControl(
+		isEnabled,
+		budgetMilliseconds);
+}
+
+void OpenCVRuntimeComponent::CvUtils::SetInjectedSlowdown(float factor)
+{
+	std::lock_guard<std::mutex> lock(_trackerLock);
+
+	_arUcoMarkerTracker->SetInjectedSlowdown(factor);
+	_parallelDetector->SetInjectedSlowdown(factor);
+}
+
+int OpenCVRuntimeComponent::CvUtils::QualityLevel::get()
+{
+	return _arUcoMarkerTracker->QualityLevel;
+}
+
+void OpenCVRuntimeComponent::CvUtils::ConfigureOverlay(
+	bool isEnabled,
+	float maxFramesPerSecond)
+{
+	_arUcoMarkerTracker->ConfigureOverlay(
+		isEnabled,
+		maxFramesPerSecond);
+}
+
+SoftwareBitmap^ OpenCVRuntimeComponent::CvUtils::LatestOverlay()
+{
+	return _arUcoMarkerTracker->LatestOverlay();
+}
+
+ArUcoTracking::FusedArUcoPose^
+OpenCVRuntimeComponent::CvUtils::FuseBoardPoses(
+	int numFrames)
+{
+	return _arUcoMarkerTracker->FuseBoardPoses(numFrames);
+}
+
+ArUcoTracking::FusedArUcoPose^
+OpenCVRuntimeComponent::CvUtils::FuseMarkerPoses(
+	int markerId,
+	int numFrames)
+{
+	return _arUcoMarkerTracker->FuseMarkerPoses(markerId, numFrames);
+}
+
 float4x4 OpenCVRuntimeComponent::CvUtils::RigidTransform3D3D(
 	IVector<float3>^ headRelativeCameraPoint3D, 
 	IVector<float3>^ headRelativeMarkerPoint3D)
@@ -56,74 +449,63 @@ float4x4 OpenCVRuntimeComponent::CvUtils::RigidTransform3D3D(
 #pragma region FrameConversionUtils
 // Taken directly from the OpenCVHelpers in HoloLensForCV repo.
 // https://github.com/microsoft/HoloLensForCV
-void ConversionUtils::WrapHoloLensSoftwareBitmapWithCvMat(
+FrameView ConversionUtils::WrapHoloLensSoftwareBitmapWithCvMat(
 	SoftwareBitmap^ softwareBitmap,
 	cv::Mat& wrappedImage)
 {
-	// Confirm that the sensor frame is not null
-	if (softwareBitmap != nullptr)
-	{
-		BitmapBuffer^ bitmapBuffer =
-			softwareBitmap->LockBuffer(BitmapBufferAccessMode::Read);
-
-		uint32_t pixelBufferDataLength = 0;
+	// The returned view keeps the bitmap buffer locked, the wrapped
+	// image is only valid while it is held
+	FrameView frame(FrameLease::Lock(
+		softwareBitmap,
+		BitmapBufferAccessMode::Read));
 
-		uint8_t* pixelBufferData =
-			Io::GetTypedPointerToMemoryBuffer<uint8_t>(
-				bitmapBuffer->CreateReference(),
-				pixelBufferDataLength);
+	wrappedImage = frame.Mat();
 
-		int32_t wrappedImageType;
+	// Otherwise return an empty sensor frame
+	if (softwareBitmap == nullptr)
+	{
+		dbg::trace(
+			L"WrapHoloLensSensorFrameWithCvMat: frame was null, returning empty matrix.");
+	}
 
-		switch (softwareBitmap->BitmapPixelFormat)
-		{
-		case BitmapPixelFormat::Bgra8:
-			wrappedImageType = CV_8UC4;
-			dbg::trace(
-				L"WrapHoloLensSensorFrameWithCvMat: CV_8UC4 pixel format");
-			break;
-
-		case BitmapPixelFormat::Gray16:
-			wrappedImageType = CV_16UC1;
-			dbg::trace(
-				L"WrapHoloLensSensorFrameWithCvMat: CV_16UC1 pixel format");
-			break;
-
-		case BitmapPixelFormat::Gray8:
-			wrappedImageType = CV_8UC1;
-			dbg::trace(
-				L"WrapHoloLensSensorFrameWithCvMat: CV_8UC1 pixel format");
-			break;
-
-		default:
-			dbg::trace(
-				L"WrapHoloLensSensorFrameWithCvMat: unrecognized softwareBitmap pixel format, falling back to CV_8UC1");
-
-			wrappedImageType = CV_8UC1;
-			break;
-		}
+	return frame;
+}
 
-		wrappedImage = cv::Mat(
-			softwareBitmap->PixelHeight,
-			softwareBitmap->PixelWidth,
-			wrappedImageType,
-			pixelBufferData);
+// Pixel format of the bitmap a Mat is copied into
+static BitmapPixelFormat BitmapPixelFormatOf(
+	const cv::Mat& from)
+{
+	return from.channels() > 1
+		? BitmapPixelFormat::Bgra8
+		: BitmapPixelFormat::Gray8;
+}
 
+// Copy a Mat into the locked pixels of a Gray8 or Bgra8 bitmap. The
+// conversions write in place, the destination has the size and type of
+// the source after conversion.
+static void CopyCvMatToBitmapPixels(
+	const cv::Mat& from,
+	cv::Mat& dstPixels)
+{
+	cv::Mat source = from;
+	if (from.depth() != CV_8U)
+	{
+		from.convertTo(source, CV_8U, from.depth() == CV_16U ? 1.0 / 256.0 : 1.0);
 	}
 
-	// Otherwise return an empty sensor frame
+	if (source.type() == dstPixels.type())
+	{
+		source.copyTo(dstPixels);
+	}
+	else if (source.channels() == 3)
+	{
+		cv::cvtColor(source, dstPixels, cv::COLOR_BGR2BGRA);
+	}
 	else
 	{
-		uint8_t* pixelBufferData = new uint8_t();
-
-		wrappedImage = cv::Mat(
-			0,
-			0,
-			CV_8UC4,
-			pixelBufferData);
-
 		dbg::trace(
-			L"WrapHoloLensSensorFrameWithCvMat: frame was null, returning empty matrix of CV_8UC4 pixel format.");
+			L"CopyCvMatToBitmapPixels: %i channel images are not supported, bitmap left blank.",
+			source.channels());
 	}
 }
 
@@ -131,44 +513,43 @@ void ConversionUtils::WrapHoloLensSoftwareBitmapWithCvMat(
 SoftwareBitmap^ ConversionUtils::WrapCvMatWithHoloLensSoftwareBitmap(
 	cv::Mat& from)
 {
-	int32_t pixelHeight = from.rows;
-	int32_t pixelWidth = from.cols;
-
-	BitmapPixelFormat bitmapPixelFormat;
-
-	switch (from.type())
-	{
-	case CV_8UC4:
-		bitmapPixelFormat = BitmapPixelFormat::Bgra8;
-		dbg::trace(
-		L"WrapCvMatWithHoloLensSoftwareBitmap: Bgra8 pixel format");
-		break;
-	case CV_8UC1:
-		bitmapPixelFormat = BitmapPixelFormat::Gray8;
-		dbg::trace(
-			L"WrapCvMatWithHoloLensSoftwareBitmap: Gray8 pixel format");
-		break;
-	default:
-		bitmapPixelFormat = BitmapPixelFormat::Gray8;
-		dbg::trace(
-			L"WrapCvMatWithHoloLensSoftwareBitmap: Gray8 pixel format");
-		break;
-	}
+	const BitmapPixelFormat bitmapPixelFormat = BitmapPixelFormatOf(from);
+	dbg::trace(
+		L"WrapCvMatWithHoloLensSoftwareBitmap: %s pixel format",
+		bitmapPixelFormat == BitmapPixelFormat::Bgra8 ? L"Bgra8" : L"Gray8");
 
 	SoftwareBitmap^ bitmap = ref new SoftwareBitmap(
 		bitmapPixelFormat,
-		pixelWidth, pixelHeight,
+		from.cols, from.rows,
 		BitmapAlphaMode::Ignore);
 
-	BitmapBuffer^ bitmapBuffer = bitmap->LockBuffer(BitmapBufferAccessMode::ReadWrite);
+	// Copy row by row through the lease, the bitmap rows may be padded
+	std::shared_ptr<FrameLease> lease = FrameLease::Lock(
+		bitmap,
+		BitmapBufferAccessMode::ReadWrite);
+	cv::Mat dstPixels = lease->Mat();
+	CopyCvMatToBitmapPixels(from, dstPixels);
 
-	auto reference = bitmapBuffer->CreateReference();
-	unsigned char* dstPixels = GetPointerToPixelData(reference);
-	memcpy(dstPixels, from.data, from.step.buf[1] * from.cols * from.rows);
-	
 	return bitmap;
 }
 
+// Copy OpenCV Mat into a recycled bitmap of the pool, the returned lease
+// keeps the bitmap out of the pool until released.
+std::shared_ptr<FrameLease> ConversionUtils::WrapCvMatWithHoloLensSoftwareBitmap(
+	const cv::Mat& from,
+	FramePool& pool)
+{
+	std::shared_ptr<FrameLease> lease = pool.Acquire(
+		BitmapPixelFormatOf(from),
+		from.cols,
+		from.rows);
+
+	cv::Mat dstPixels = lease->Mat();
+	CopyCvMatToBitmapPixels(from, dstPixels);
+
+	return lease;
+}
+
 // https://github.com/microsoft/Windows-universal-samples/blob/master/Samples/CameraOpenCV/shared/OpenCVBridge/OpenCVHelper.cpp
 // https://stackoverflow.com/questions/34198259/winrt-c-win10-opencv-hsv-color-space-image-display-artifacts/34198580#34198580
 // Get pointer to memory buffer reference. 
@@ -1,6 +1,9 @@
 ﻿#pragma once
 #include"CameraCalibrationParams.h"
 #include "PointCorrespondences.h"
+#include "PoseHistory.h"
+#include "FrameLease.h"
+#include "ParallelBoardDetector.h"
 
 using namespace Windows::Foundation::Collections;
 using namespace Windows::Foundation::Numerics;
@@ -25,6 +28,122 @@ namespace OpenCVRuntimeComponent
             SoftwareBitmap^ softwareBitmap,
             CameraCalibrationParams^ cameraCalibrationParams);
 
+        // Register an additional board (layout of marker top left corners,
+        // markers firstMarkerId onward), returns its board index or -1
+        int RegisterBoard(
+            float markerSize,
+            int firstMarkerId,
+            IVector<Windows::Foundation::Numerics::float3>^ customObjectPoints);
+
+        // Poses of all boards from a single marker detection pass
+        IVector<ArUcoTracking::DetectedArUcoBoard^>^ DetectBoards(
+            SoftwareBitmap^ softwareBitmap,
+            CameraCalibrationParams^ cameraCalibrationParams);
+
+        // Detect the board and record its camera-relative pose in the
+        // board pose history under the capture time of the frame. Throws
+        // while parallel detection is running, the history then records
+        // the results of the workers.
+        ArUcoTracking::DetectedArUcoBoard^ DetectBoardAtTime(
+            SoftwareBitmap^ softwareBitmap,
+            CameraCalibrationParams^ cameraCalibrationParams,
+            Windows::Foundation::TimeSpan captureTime);
+
+        // As DetectBoardAtTime, and compose the board pose with the camera
+        // to world transform of the frame (WinRT convention, as returned by
+        // SpatialCoordinateSystem::TryGetTransformTo). The world pose is
+        // returned in the Unity convention, null skips the composition.
+        ArUcoTracking::DetectedArUcoBoard^ DetectBoardInWorld(
+            SoftwareBitmap^ softwareBitmap,
+            CameraCalibrationParams^ cameraCalibrationParams,
+            Windows::Foundation::TimeSpan captureTime,
+            Platform::IBox<float4x4>^ cameraToWorld);
+
+        // Detect the board in several frames at once on numWorkers worker
+        // threads, 0 stops the workers. At most maxInFlight frames are
+        // queued, processed or waiting to be taken. The workers use the
+        // quality control settings below; motion gating, corner tracking
+        // and detector tuning only apply to the serial detections.
+        void ConfigureParallelDetection(
+            int numWorkers,
+            int maxInFlight);
+
+        // Queue a frame for parallel detection, false if the frame was
+        // not accepted (too many frames in flight or not newer than the
+        // last accepted frame). Completed results are taken in capture
+        // time order, detected poses enter the board pose history then.
+        bool SubmitBoardFrame(
+            SoftwareBitmap^ softwareBitmap,
+            CameraCalibrationParams^ cameraCalibrationParams,
+            Windows::Foundation::TimeSpan captureTime);
+        IVector<ArUcoTracking::DetectedArUcoBoard^>^ TakeCompletedBoards();
+        property int FramesInFlight { int get(); }
+
+        // Record the head pose at the given time in the head pose history
+        void PushHeadPose(
+            Windows::Foundation::TimeSpan time,
+            float3 position,
+            quaternion orientation);
+
+        // Interpolated board and head poses at an arbitrary time, used to
+        // pair poses captured at the same instant
+        ArUcoTracking::TimedPose^ GetBoardPoseAtTime(Windows::Foundation::TimeSpan time);
+        ArUcoTracking::TimedPose^ GetHeadPoseAtTime(Windows::Foundation::TimeSpan time);
+
+        // Skip board detection while the board region is static, the pose
+        // of the last detection is reused. Detection is forced at least
+        // every refreshPeriod frames. Off by default.
+        void ConfigureMotionGating(
+            bool isEnabled,
+            float threshold,
+            int refreshPeriod);
+
+        // Track the board marker corners with optical flow between full
+        // marker detections. Full detection runs every redetectPeriod
+        // frames or when too few markers pass the forward-backward check.
+        // Off by default.
+        void ConfigureCornerTracking(
+            bool isEnabled,
+            int redetectPeriod,
+            float maxForwardBackwardError,
+            float minTrackedFraction);
+
+        // Narrow the adaptive threshold windows and marker perimeter
+        // range of the detector to the values that found markers in a
+        // probe frame, the full range is probed again every
+        // rewidenPeriod frames or when markers are lost. Off by default,
+        // never used by the parallel detection workers.
+        void ConfigureDetectorTuning(
+            bool isEnabled,
+            int rewidenPeriod);
+
+        // Adapt the detection settings (processing resolution, adaptive
+        // threshold windows, corner refinement, search region) to keep
+        // the board detection time per frame within budgetMilliseconds.
+        // The injected slowdown scales the measured timings to reproduce
+        // the behaviour of a throttled device. Applies to the serial
+        // detections and to each parallel detection worker.
+        void ConfigureQualityControl(
+            bool isEnabled,
+            float budgetMilliseconds);
+        void SetInjectedSlowdown(float factor);
+
+        // Current quality level of the serial detections, 0 is full
+        // quality
+        property int QualityLevel { int get(); }
+
+        // Debug preview of the detected markers, ids and pose axes, drawn
+        // off the detection thread at no more than maxFramesPerSecond.
+        // LatestOverlay returns the newest Bgra8 frame or null.
+        void ConfigureOverlay(
+            bool isEnabled,
+            float maxFramesPerSecond);
+        SoftwareBitmap^ LatestOverlay();
+
+        // Fused pose from the last numFrames board or marker detections
+        ArUcoTracking::FusedArUcoPose^ FuseBoardPoses(int numFrames);
+        ArUcoTracking::FusedArUcoPose^ FuseMarkerPoses(int markerId, int numFrames);
+
         float4x4 RigidTransform3D3D(
             IVector<float3>^ headRelativeCameraPoint3D,
             IVector<float3>^ headRelativeMarkerPoint3D);
@@ -32,13 +151,33 @@ namespace OpenCVRuntimeComponent
     private:
         ArUcoTracking::ArUcoMarkerTracker^ _arUcoMarkerTracker;
         HMDCalibration::PointCorrespondences^ _pointCorrespondences;
+
+        // Timestamp-indexed pose histories, each with a single producer
+        std::unique_ptr<ArUcoTracking::PoseHistory> _boardPoseHistory;
+        std::unique_ptr<ArUcoTracking::PoseHistory> _headPoseHistory;
+
+        // Frame sequence of the last board pose added to the history
+        int64_t _lastHistoryFrameSequence;
+        void PushBoardPose(ArUcoTracking::DetectedArUcoBoard^ board);
+
+        // Serializes the calls into the tracker, CvUtils may be called
+        // from several threads
+        std::mutex _trackerLock;
+
+        // Workers of parallel board detection with their own trackers
+        std::unique_ptr<ArUcoTracking::ParallelBoardDetector> _parallelDetector;
+
+        ArUcoTracking::TimedPose^ QueryPoseHistory(
+            const ArUcoTracking::PoseHistory& history,
+            Windows::Foundation::TimeSpan time);
     };
 
     private class ConversionUtils
     {
     public:
-        static void WrapHoloLensSoftwareBitmapWithCvMat(SoftwareBitmap^ softwareBitmap, cv::Mat& openCVImage);
+        static FrameView WrapHoloLensSoftwareBitmapWithCvMat(SoftwareBitmap^ softwareBitmap, cv::Mat& openCVImage);
         static SoftwareBitmap^ WrapCvMatWithHoloLensSoftwareBitmap(cv::Mat& from);
+        static std::shared_ptr<FrameLease> WrapCvMatWithHoloLensSoftwareBitmap(const cv::Mat& from, FramePool& pool);
         static unsigned char* GetPointerToPixelData(Windows::Foundation::IMemoryBufferReference^ reference);
     };
 }
@@ -13,4 +13,15 @@ ArUcoTracking::DetectedArUcoBoard::DetectedArUcoBoard(
 	Position = position;
 	Rotation = rotation;
 	IsDetected = isDetected;
+	BoardIndex = 0;
+	Quality = ref new PoseQualityMetrics(
+		0.0f, 0, 0, 0.0f,
+		ref new Platform::Collections::Vector<float>(36, 0.0f),
+		false);
+	FrameSequence = 0;
+	Timestamp = Windows::Foundation::TimeSpan{ 0 };
+	WorldTransform = float4x4::identity();
+	WorldPosition = float3::zero();
+	WorldRotation = quaternion::identity();
+	HasWorldPose = false;
 }
@@ -18,6 +18,26 @@ namespace OpenCVRuntimeComponent
 			property float3 Position;
 			property float3 Rotation;
 			property bool IsDetected;
+
+			// Index of the board in multi-board detection, 0 is the board
+			// the tracker was created with
+			property int BoardIndex;
+
+			// Quality of the pose, IsValid is false without a pose
+			property PoseQualityMetrics^ Quality;
+
+			// Sequence number of the processed frame the result belongs to,
+			// and its capture time when known (zero otherwise)
+			property int64_t FrameSequence;
+			property Windows::Foundation::TimeSpan Timestamp;
+
+			// Board to world transform in the Unity convention (left-handed,
+			// column vectors), only set when a camera to world transform was
+			// supplied with the frame
+			property float4x4 WorldTransform;
+			property float3 WorldPosition;
+			property quaternion WorldRotation;
+			property bool HasWorldPose;
 		};
 	}
 
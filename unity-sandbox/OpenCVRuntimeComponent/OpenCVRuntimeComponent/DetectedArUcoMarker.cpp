@@ -15,6 +15,12 @@ namespace OpenCVRuntimeComponent
 			Id = id;
 			Position = position;
 			Rotation = rotation;
+			Quality = ref new PoseQualityMetrics(
+				0.0f, 0, 0, 0.0f,
+				ref new Platform::Collections::Vector<float>(36, 0.0f),
+				false);
+			FrameSequence = 0;
+			Timestamp = Windows::Foundation::TimeSpan{ 0 };
 		}
 	}
 }
@@ -18,6 +18,14 @@ namespace OpenCVRuntimeComponent
 			property int Id;
 			property float3 Position;
 			property float3 Rotation;
+
+			// Quality of the pose, IsValid is false without a pose
+			property PoseQualityMetrics^ Quality;
+
+			// Sequence number of the processed frame the result belongs to,
+			// and its capture time when known (zero otherwise)
+			property int64_t FrameSequence;
+			property Windows::Foundation::TimeSpan Timestamp;
 		};
 	}
 }
@@ -0,0 +1,501 @@
+#include "DetectionRegression.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+#include <opencv2/calib3d.hpp>
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
+#include "BoardDetectionPipeline.h"
+
+namespace OpenCVRuntimeComponent
+{
+	namespace ArUcoTracking
+	{
+		namespace
+		{
+			// cv::aruco::CornerRefineMethod
+			const int CornerRefineNone = 0;
+			const int CornerRefineSubpix = 1;
+			const int CornerRefineContour = 2;
+
+			const char* ResultsHeader =
+				"sequence,configuration,frames,detected,"
+				"translation_p50_mm,translation_p99_mm,rotation_p50_deg,rotation_p99_deg,"
+				"latency_p50_ms,latency_p99_ms";
+
+			double ElapsedMilliseconds(
+				std::chrono::steady_clock::time_point from,
+				std::chrono::steady_clock::time_point to)
+			{
+				return std::chrono::duration<double, std::milli>(to - from).count();
+			}
+
+			// Nearest rank percentile, 0 for no values
+			double Percentile(std::vector<double> values, double percent)
+			{
+				if (values.empty())
+				{
+					return 0.0;
+				}
+
+				std::sort(values.begin(), values.end());
+				const size_t rank = (size_t)std::ceil(percent / 100.0 * values.size());
+				return values[(std::min)((std::max)(rank, (size_t)1), values.size()) - 1];
+			}
+
+			std::vector<std::string> SplitColumns(const std::string& line)
+			{
+				std::vector<std::string> columns;
+				std::stringstream stream(line);
+				std::string column;
+				while (std::getline(stream, column, ','))
+				{
+					columns.push_back(column);
+				}
+				return columns;
+			}
+
+			// Angle of the rotation between the estimated and the true
+			// board orientation
+			double RotationError(const cv::Vec3d& rVec, const cv::Vec3d& trueRVec)
+			{
+				cv::Matx33d rotation, trueRotation;
+				cv::Rodrigues(rVec, rotation);
+				cv::Rodrigues(trueRVec, trueRotation);
+
+				const cv::Matx33d difference = rotation * trueRotation.t();
+				const double cosine = 0.5 * (cv::trace(difference) - 1.0);
+				return std::acos((std::min)(1.0, (std::max)(-1.0, cosine))) * 180.0 / CV_PI;
+			}
+
+			// Settings of the opt-in stages when a configuration enables them
+			const double MotionGateThreshold = 2.0;
+			const int MotionGateRefreshPeriod = 10;
+			const int DetectorTuningRewidenPeriod = 60;
+			const int CornerTrackingRedetectPeriod = 5;
+			const double CornerTrackingMaxForwardBackwardError = 1.0;
+			const double CornerTrackingMinTrackedFraction = 0.75;
+
+			// Stages of the tracker pipeline enabled by the configuration,
+			// the others stay off as in a tracker that was not configured
+			void ConfigurePipeline(
+				const DetectionConfiguration& configuration,
+				const cv::Ptr<cv::aruco::Board>& board,
+				BoardDetectionPipeline& pipeline)
+			{
+				pipeline.SetBoard(board);
+
+				pipeline.DetectorTuning().Configure(
+					configuration.isDetectorTuning,
+					DetectorTuningRewidenPeriod);
+				pipeline.CornerTracking().Configure(
+					configuration.isCornerTracking,
+					CornerTrackingRedetectPeriod,
+					CornerTrackingMaxForwardBackwardError,
+					CornerTrackingMinTrackedFraction);
+				pipeline.MotionGating().Configure(
+					configuration.isMotionGating,
+					MotionGateThreshold,
+					MotionGateRefreshPeriod);
+				if (configuration.hasQualitySettings)
+				{
+					pipeline.QualityControl().Hold(configuration.quality);
+				}
+			}
+		}
+
+		std::vector<DetectionConfiguration> TrackerDetectionConfigurations()
+		{
+			std::vector<DetectionConfiguration> configurations;
+
+			// Tracker without configuration, every frame detected with
+			// the default parameters as the parallel board detector runs
+			DetectionConfiguration tracker;
+			tracker.name = "default";
+			configurations.push_back(tracker);
+
+			DetectionConfiguration detectorTuning = tracker;
+			detectorTuning.name = "detector-tuning";
+			detectorTuning.isDetectorTuning = true;
+			configurations.push_back(detectorTuning);
+
+			DetectionConfiguration cornerTracking = tracker;
+			cornerTracking.name = "corner-tracking";
+			cornerTracking.isCornerTracking = true;
+			configurations.push_back(cornerTracking);
+
+			DetectionConfiguration motionGating = tracker;
+			motionGating.name = "motion-gating";
+			motionGating.isMotionGating = true;
+			configurations.push_back(motionGating);
+
+			DetectionConfiguration allStages = tracker;
+			allStages.name = "all-stages";
+			allStages.isDetectorTuning = true;
+			allStages.isCornerTracking = true;
+			allStages.isMotionGating = true;
+			configurations.push_back(allStages);
+
+			// Full resolution and threshold windows of level 0 with each
+			// corner refinement method, then reduced resolutions
+			const std::pair<const char*, int> refinements[] =
+			{
+				{ "refine-none", CornerRefineNone },
+				{ "refine-subpix", CornerRefineSubpix },
+				{ "refine-contour", CornerRefineContour },
+			};
+			for (const auto& refinement : refinements)
+			{
+				DetectionConfiguration refined;
+				refined.name = refinement.first;
+				refined.hasQualitySettings = true;
+				refined.quality = QualityLevelSettings(0);
+				refined.quality.cornerRefinementMethod = refinement.second;
+				configurations.push_back(refined);
+			}
+
+			const std::pair<const char*, double> scales[] =
+			{
+				{ "scale-0.75", 0.75 },
+				{ "scale-0.5", 0.5 },
+			};
+			for (const auto& scale : scales)
+			{
+				DetectionConfiguration scaled;
+				scaled.name = scale.first;
+				scaled.hasQualitySettings = true;
+				scaled.quality = QualityLevelSettings(0);
+				scaled.quality.processingScale = scale.second;
+				configurations.push_back(scaled);
+			}
+
+			for (int level = 0; level < QualityController::NumLevels; level++)
+			{
+				DetectionConfiguration fixedLevel;
+				fixedLevel.name = "quality-level-" + std::to_string(level);
+				fixedLevel.hasQualitySettings = true;
+				fixedLevel.quality = QualityLevelSettings(level);
+				configurations.push_back(fixedLevel);
+			}
+
+			return configurations;
+		}
+
+		RegressionSequence CreateSyntheticSequence(
+			const std::string& name,
+			const SyntheticFrameGenerator& generator,
+			const std::vector<SyntheticPose>& poses)
+		{
+			RegressionSequence sequence;
+			sequence.name = name;
+			sequence.camera = generator.Camera();
+			sequence.groundTruth = poses;
+			sequence.images.reserve(poses.size());
+
+			generator.Generate(poses, [&](const std::vector<SyntheticFrame>& frames)
+			{
+				for (const auto& frame : frames)
+				{
+					sequence.images.push_back(frame.image);
+				}
+			});
+
+			return sequence;
+		}
+
+		bool ReadRecordedSequence(
+			const std::string& directory,
+			const CameraIntrinsics& camera,
+			RegressionSequence& sequence,
+			std::string& error)
+		{
+			const std::string groundTruthPath = directory + "/groundtruth.csv";
+			std::ifstream stream(groundTruthPath);
+			if (!stream.is_open())
+			{
+				error = "cannot open " + groundTruthPath;
+				return false;
+			}
+
+			RegressionSequence read;
+			read.name = directory.substr(directory.find_last_of("/\\") + 1);
+			read.camera = camera;
+
+			std::vector<std::string> imagePaths;
+			std::string line;
+			int lineNumber = 0;
+			while (std::getline(stream, line))
+			{
+				lineNumber++;
+				if (lineNumber == 1 || line.empty())
+				{
+					continue;
+				}
+
+				const std::vector<std::string> columns = SplitColumns(line);
+				SyntheticPose pose;
+				long long frameIndex = 0;
+				try
+				{
+					if (columns.size() < 7)
+					{
+						throw std::invalid_argument(line);
+					}
+					frameIndex = std::stoll(columns[0]);
+					for (int i = 0; i < 3; i++)
+					{
+						pose.rVec[i] = std::stod(columns[1 + i]);
+						pose.tVec[i] = std::stod(columns[4 + i]);
+					}
+				}
+				catch (const std::exception&)
+				{
+					error = groundTruthPath + ":" + std::to_string(lineNumber) + ": invalid pose";
+					return false;
+				}
+
+				char name[32];
+				std::snprintf(name, sizeof(name), "/frame_%06lld.png", frameIndex);
+				imagePaths.push_back(directory + name);
+				read.groundTruth.push_back(pose);
+			}
+
+			read.images.resize(imagePaths.size());
+			cv::parallel_for_(cv::Range(0, (int)imagePaths.size()), [&](const cv::Range& range)
+			{
+				for (int i = range.start; i < range.end; i++)
+				{
+					read.images[i] = cv::imread(imagePaths[i], cv::IMREAD_GRAYSCALE);
+				}
+			});
+
+			for (size_t i = 0; i < imagePaths.size(); i++)
+			{
+				if (read.images[i].empty())
+				{
+					error = "cannot read " + imagePaths[i];
+					return false;
+				}
+			}
+
+			if (read.images.empty())
+			{
+				error = groundTruthPath + ": no frames";
+				return false;
+			}
+
+			sequence = std::move(read);
+			return true;
+		}
+
+		RegressionResult RunDetectionConfiguration(
+			const DetectionConfiguration& configuration,
+			const RegressionSequence& sequence,
+			const cv::Ptr<cv::aruco::Board>& board,
+			int repetitions)
+		{
+			const size_t numFrames = sequence.images.size();
+			std::vector<double> latencies(numFrames, 0.0);
+			std::vector<double> translationErrors, rotationErrors;
+
+			RegressionResult result;
+			result.sequence = sequence.name;
+			result.configuration = configuration.name;
+			result.numFrames = (int)numFrames;
+
+			for (int repetition = 0; repetition < (std::max)(repetitions, 1); repetition++)
+			{
+				// Fresh tracking state for each pass over the sequence
+				BoardDetectionPipeline pipeline;
+				ConfigurePipeline(configuration, board, pipeline);
+
+				BoardFrameResult frameResult;
+				cv::Mat frame;
+				for (size_t i = 0; i < numFrames; i++)
+				{
+					// Frames are handed in as BGRA like the camera frames of
+					// the device, the gray conversion is part of the latency
+					cv::cvtColor(sequence.images[i], frame, cv::COLOR_GRAY2BGRA);
+
+					const auto start = std::chrono::steady_clock::now();
+					pipeline.Process(
+						frame,
+						sequence.camera.cameraMatrix,
+						sequence.camera.distortionCoefficients,
+						frameResult);
+					const double latency = ElapsedMilliseconds(start, std::chrono::steady_clock::now());
+
+					latencies[i] = repetition == 0 ? latency : (std::min)(latencies[i], latency);
+
+					if (repetition > 0 || !frameResult.isDetected)
+					{
+						continue;
+					}
+
+					const SyntheticPose& truth = sequence.groundTruth[i];
+					result.numDetected++;
+					translationErrors.push_back(1000.0 * cv::norm(frameResult.tVec - truth.tVec));
+					rotationErrors.push_back(RotationError(frameResult.rVec, truth.rVec));
+				}
+			}
+
+			result.translationP50 = Percentile(translationErrors, 50.0);
+			result.translationP99 = Percentile(translationErrors, 99.0);
+			result.rotationP50 = Percentile(rotationErrors, 50.0);
+			result.rotationP99 = Percentile(rotationErrors, 99.0);
+			result.latencyP50 = Percentile(latencies, 50.0);
+			result.latencyP99 = Percentile(latencies, 99.0);
+			return result;
+		}
+
+		bool WriteRegressionResults(
+			const std::string& path,
+			const std::vector<RegressionResult>& results)
+		{
+			std::ofstream stream(path);
+			if (!stream.is_open())
+			{
+				return false;
+			}
+
+			stream << ResultsHeader << std::endl;
+			for (const auto& result : results)
+			{
+				stream << result.sequence << "," << result.configuration << ","
+					<< result.numFrames << "," << result.numDetected << ","
+					<< result.translationP50 << "," << result.translationP99 << ","
+					<< result.rotationP50 << "," << result.rotationP99 << ","
+					<< result.latencyP50 << "," << result.latencyP99 << std::endl;
+			}
+			return true;
+		}
+
+		bool ReadRegressionResults(
+			const std::string& path,
+			std::vector<RegressionResult>& results)
+		{
+			std::ifstream stream(path);
+			if (!stream.is_open())
+			{
+				return false;
+			}
+
+			std::vector<RegressionResult> read;
+			std::string line;
+			if (!std::getline(stream, line))
+			{
+				return false;
+			}
+
+			while (std::getline(stream, line))
+			{
+				const std::vector<std::string> columns = SplitColumns(line);
+				if (columns.size() < 10)
+				{
+					continue;
+				}
+
+				RegressionResult result;
+				try
+				{
+					result.sequence = columns[0];
+					result.configuration = columns[1];
+					result.numFrames = std::stoi(columns[2]);
+					result.numDetected = std::stoi(columns[3]);
+					result.translationP50 = std::stod(columns[4]);
+					result.translationP99 = std::stod(columns[5]);
+					result.rotationP50 = std::stod(columns[6]);
+					result.rotationP99 = std::stod(columns[7]);
+					result.latencyP50 = std::stod(columns[8]);
+					result.latencyP99 = std::stod(columns[9]);
+				}
+				catch (const std::exception&)
+				{
+					return false;
+				}
+				read.push_back(result);
+			}
+
+			results = std::move(read);
+			return true;
+		}
+
+		std::vector<std::string> CompareRegressionResults(
+			const std::vector<RegressionResult>& baseline,
+			const std::vector<RegressionResult>& results,
+			const RegressionThresholds& thresholds)
+		{
+			std::vector<std::string> regressions;
+
+			auto findRow = [](const std::vector<RegressionResult>& rows, const RegressionResult& row)
+			{
+				return std::find_if(rows.begin(), rows.end(),
+					[&](const RegressionResult& other)
+				{
+					return other.sequence == row.sequence && other.configuration == row.configuration;
+				});
+			};
+
+			// A row missing on either side fails, a configuration or
+			// sequence dropped from the run must not pass unnoticed
+			for (const auto& reference : baseline)
+			{
+				if (findRow(results, reference) == results.end())
+				{
+					regressions.push_back(reference.sequence + "/" + reference.configuration + ": missing from the results");
+				}
+			}
+
+			for (const auto& result : results)
+			{
+				const auto reference = findRow(baseline, result);
+				if (reference == baseline.end())
+				{
+					regressions.push_back(result.sequence + "/" + result.configuration + ": missing from the baseline");
+					continue;
+				}
+
+				const std::string prefix = result.sequence + "/" + result.configuration + ": ";
+				auto check = [&](const char* metric, double value, double base, double tolerance, double slack)
+				{
+					if (value > base * (1.0 + tolerance) && value > base + slack)
+					{
+						std::ostringstream message;
+						message << prefix << metric << " " << value << " (baseline " << base << ")";
+						regressions.push_back(message.str());
+					}
+				};
+
+				const double rate = result.numFrames > 0 ? (double)result.numDetected / result.numFrames : 0.0;
+				const double baseRate = reference->numFrames > 0 ? (double)reference->numDetected / reference->numFrames : 0.0;
+				if (rate < baseRate - thresholds.maxDetectionRateDrop)
+				{
+					std::ostringstream message;
+					message << prefix << "detection rate " << rate << " (baseline " << baseRate << ")";
+					regressions.push_back(message.str());
+				}
+
+				check("translation p50 mm", result.translationP50, reference->translationP50,
+					thresholds.accuracyTolerance, thresholds.translationSlack);
+				check("translation p99 mm", result.translationP99, reference->translationP99,
+					thresholds.accuracyTolerance, thresholds.translationSlack);
+				check("rotation p50 deg", result.rotationP50, reference->rotationP50,
+					thresholds.accuracyTolerance, thresholds.rotationSlack);
+				check("rotation p99 deg", result.rotationP99, reference->rotationP99,
+					thresholds.accuracyTolerance, thresholds.rotationSlack);
+				check("latency p50 ms", result.latencyP50, reference->latencyP50,
+					thresholds.latencyTolerance, thresholds.latencySlack);
+				check("latency p99 ms", result.latencyP99, reference->latencyP99,
+					thresholds.latencyTolerance, thresholds.latencySlack);
+			}
+
+			return regressions;
+		}
+	}
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <opencv2/core.hpp>
+#include <opencv2/aruco.hpp>
+#include "IntrinsicCalibration.h"
+#include "QualityController.h"
+#include "SyntheticFrames.h"
+
+namespace OpenCVRuntimeComponent
+{
+	namespace ArUcoTracking
+	{
+		// A way the tracker can be configured to detect the board. Without
+		// quality settings markers are detected with the default detector
+		// parameters (narrowed by the tuner if enabled), as the tracker
+		// does while quality control is disabled; with quality settings
+		// the quality controller is held at them.
+		struct DetectionConfiguration
+		{
+			std::string name;
+
+			bool hasQualitySettings = false;
+			QualitySettings quality = {};
+
+			bool isDetectorTuning = false;
+			bool isCornerTracking = false;
+			bool isMotionGating = false;
+		};
+
+		// The tracker defaults (every frame detected, all opt-in stages
+		// off), each of tuning, corner tracking and motion gating alone
+		// and together, each corner refinement method, reduced processing
+		// resolutions and the quality levels
+		std::vector<DetectionConfiguration> TrackerDetectionConfigurations();
+
+		// Gray frames in capture order with the board pose of each frame
+		struct RegressionSequence
+		{
+			std::string name;
+			CameraIntrinsics camera;
+			std::vector<cv::Mat> images;
+			std::vector<SyntheticPose> groundTruth;
+		};
+
+		// Frames rendered by the generator at the poses
+		RegressionSequence CreateSyntheticSequence(
+			const std::string& name,
+			const SyntheticFrameGenerator& generator,
+			const std::vector<SyntheticPose>& poses);
+
+		// Recorded frames in the layout written by --synthesize: a
+		// groundtruth.csv (frame,rx,ry,rz,tx,ty,tz,...) and the image
+		// frame_<frame>.png of each row, decoded in parallel. Returns
+		// false with a message if a frame is missing.
+		bool ReadRecordedSequence(
+			const std::string& directory,
+			const CameraIntrinsics& camera,
+			RegressionSequence& sequence,
+			std::string& error);
+
+		// Accuracy and latency of a configuration on a sequence. Errors
+		// are taken over the frames with a board pose, latency over all
+		// frames.
+		struct RegressionResult
+		{
+			std::string sequence;
+			std::string configuration;
+			int numFrames = 0;
+			int numDetected = 0;
+			double translationP50 = 0.0; // millimeters
+			double translationP99 = 0.0;
+			double rotationP50 = 0.0;    // degrees
+			double rotationP99 = 0.0;
+			double latencyP50 = 0.0;     // milliseconds
+			double latencyP99 = 0.0;
+		};
+
+		// Run the frames in order through the board detection pipeline of
+		// the tracker, configured as given. Frames are handed in as BGRA
+		// and the latency of a frame includes the gray conversion. It is
+		// the fastest of the repetitions, which keeps scheduling noise out
+		// of the percentiles; poses are the same in every repetition.
+		RegressionResult RunDetectionConfiguration(
+			const DetectionConfiguration& configuration,
+			const RegressionSequence& sequence,
+			const cv::Ptr<cv::aruco::Board>& board,
+			int repetitions);
+
+		// Results table, one row per sequence and configuration
+		bool WriteRegressionResults(
+			const std::string& path,
+			const std::vector<RegressionResult>& results);
+		bool ReadRegressionResults(
+			const std::string& path,
+			std::vector<RegressionResult>& results);
+
+		// Allowed change against the baseline. A value regresses if it
+		// exceeds the baseline by both the relative tolerance and the
+		// absolute slack, the slack keeps near zero baselines from
+		// failing on noise.
+		struct RegressionThresholds
+		{
+			double accuracyTolerance = 0.1;
+			double translationSlack = 0.5; // millimeters
+			double rotationSlack = 0.1;    // degrees
+
+			double latencyTolerance = 0.25;
+			double latencySlack = 0.5;     // milliseconds
+
+			// Fraction of the frames
+			double maxDetectionRateDrop = 0.01;
+		};
+
+		// One message per regressed value and per sequence and
+		// configuration found in only one of the tables, empty if none
+		// regressed.
+		std::vector<std::string> CompareRegressionResults(
+			const std::vector<RegressionResult>& baseline,
+			const std::vector<RegressionResult>& results,
+			const RegressionThresholds& thresholds);
+	}
+}
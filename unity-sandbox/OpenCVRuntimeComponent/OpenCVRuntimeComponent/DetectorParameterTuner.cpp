@@ -0,0 +1,205 @@
+#include "DetectorParameterTuner.h"
+
+#include <algorithm>
+#include <limits>
+#include <opencv2/imgproc.hpp>
+
+namespace OpenCVRuntimeComponent
+{
+	namespace ArUcoTracking
+	{
+		namespace
+		{
+			// Margin applied to the perimeter range of the accepted markers
+			// so markers moving closer or further stay inside the range
+			const double MinPerimeterMargin = 0.5;
+			const double MaxPerimeterMargin = 2.0;
+
+			// Fraction of the markers of the probe frame the narrowed
+			// detector must find before the parameters are widened again
+			const double MinRetainedFraction = 0.5;
+		}
+
+		DetectorParameterTuner::DetectorParameterTuner()
+			: _isEnabled(false),
+			_rewidenPeriod(60),
+			_isNarrowed(false),
+			_isProbePending(true),
+			_framesSinceProbe(0),
+			_numProbedMarkers(0)
+		{
+			_defaults = cv::aruco::DetectorParameters::create();
+			_params = cv::aruco::DetectorParameters::create();
+			_probeParams = cv::aruco::DetectorParameters::create();
+		}
+
+		void DetectorParameterTuner::Configure(
+			bool isEnabled,
+			int rewidenPeriod)
+		{
+			_isEnabled = isEnabled;
+			_rewidenPeriod = rewidenPeriod;
+			Reset();
+		}
+
+		void DetectorParameterTuner::Reset()
+		{
+			Widen();
+			_statistics = CandidateStatistics();
+		}
+
+		void DetectorParameterTuner::Widen()
+		{
+			*_params = *_defaults;
+			_isNarrowed = false;
+			_isProbePending = true;
+			_framesSinceProbe = 0;
+			_numProbedMarkers = 0;
+		}
+
+		void DetectorParameterTuner::Detect(
+			const cv::Mat& grayImage,
+			const cv::Ptr<cv::aruco::Dictionary>& dictionary,
+			std::vector<std::vector<cv::Point2f>>& markers,
+			std::vector<int32_t>& markerIds,
+			std::vector<std::vector<cv::Point2f>>& rejectedCandidates)
+		{
+			// A probe runs several detections, frames without markers after
+			// a failed probe use the single default detection instead
+			if (_isEnabled && (_isProbePending || ++_framesSinceProbe >= _rewidenPeriod))
+			{
+				Probe(grayImage, dictionary, markers, markerIds, rejectedCandidates);
+				UpdateStatistics(markers, rejectedCandidates);
+				return;
+			}
+
+			cv::aruco::detectMarkers(
+				grayImage,
+				dictionary,
+				markers,
+				markerIds,
+				_params,
+				rejectedCandidates);
+			UpdateStatistics(markers, rejectedCandidates);
+
+			if (!_isNarrowed)
+			{
+				// Markers came into view of the default search, narrow
+				// to them on the next frame
+				_isProbePending = !markers.empty();
+			}
+			else if (markers.size() < MinRetainedFraction * _numProbedMarkers)
+			{
+				// Widen again if the scene changed and the narrowed search
+				// misses markers, the next frame is a probe frame
+				Widen();
+			}
+		}
+
+		void DetectorParameterTuner::Probe(
+			const cv::Mat& grayImage,
+			const cv::Ptr<cv::aruco::Dictionary>& dictionary,
+			std::vector<std::vector<cv::Point2f>>& markers,
+			std::vector<int32_t>& markerIds,
+			std::vector<std::vector<cv::Point2f>>& rejectedCandidates)
+		{
+			markers.clear();
+			markerIds.clear();
+			rejectedCandidates.clear();
+
+			*_probeParams = *_defaults;
+
+			// Run each threshold window of the default range on its own and
+			// keep the first detection of every marker id
+			int minWindow = -1;
+			int maxWindow = -1;
+			std::vector<std::vector<cv::Point2f>> windowMarkers, windowRejected;
+			std::vector<int32_t> windowIds;
+
+			for (int window = _defaults->adaptiveThreshWinSizeMin;
+				window <= _defaults->adaptiveThreshWinSizeMax;
+				window += _defaults->adaptiveThreshWinSizeStep)
+			{
+				_probeParams->adaptiveThreshWinSizeMin = window;
+				_probeParams->adaptiveThreshWinSizeMax = window;
+
+				cv::aruco::detectMarkers(
+					grayImage,
+					dictionary,
+					windowMarkers,
+					windowIds,
+					_probeParams,
+					windowRejected);
+
+				if (!windowIds.empty())
+				{
+					minWindow = minWindow < 0 ? window : minWindow;
+					maxWindow = window;
+				}
+
+				for (size_t i = 0; i < windowIds.size(); i++)
+				{
+					if (std::find(markerIds.begin(), markerIds.end(), windowIds[i]) == markerIds.end())
+					{
+						markerIds.push_back(windowIds[i]);
+						markers.push_back(windowMarkers[i]);
+					}
+				}
+
+				// Rejected candidates of the largest window are reported
+				rejectedCandidates.swap(windowRejected);
+			}
+
+			_isProbePending = false;
+			_framesSinceProbe = 0;
+			_numProbedMarkers = markers.size();
+
+			if (markers.empty())
+			{
+				*_params = *_defaults;
+				_isNarrowed = false;
+				return;
+			}
+
+			// Narrow the window range to the windows that found markers and
+			// the perimeter range to the size of the accepted markers
+			double minPerimeter = std::numeric_limits<double>::max();
+			double maxPerimeter = 0.0;
+			for (const auto& marker : markers)
+			{
+				const double perimeter = cv::arcLength(marker, true);
+				minPerimeter = (std::min)(minPerimeter, perimeter);
+				maxPerimeter = (std::max)(maxPerimeter, perimeter);
+			}
+			const double maxDimension = (std::max)(grayImage.cols, grayImage.rows);
+
+			*_params = *_defaults;
+			_params->adaptiveThreshWinSizeMin = minWindow;
+			_params->adaptiveThreshWinSizeMax = maxWindow;
+			_params->minMarkerPerimeterRate = (std::max)(
+				_defaults->minMarkerPerimeterRate,
+				MinPerimeterMargin * minPerimeter / maxDimension);
+			_params->maxMarkerPerimeterRate = (std::min)(
+				_defaults->maxMarkerPerimeterRate,
+				MaxPerimeterMargin * maxPerimeter / maxDimension);
+			_isNarrowed = true;
+		}
+
+		void DetectorParameterTuner::UpdateStatistics(
+			const std::vector<std::vector<cv::Point2f>>& markers,
+			const std::vector<std::vector<cv::Point2f>>& rejectedCandidates)
+		{
+			_statistics.numAccepted = (int)markers.size();
+			_statistics.numRejected = (int)rejectedCandidates.size();
+			_statistics.minPerimeter = 0.0;
+			_statistics.maxPerimeter = 0.0;
+
+			for (size_t i = 0; i < markers.size(); i++)
+			{
+				const double perimeter = cv::arcLength(markers[i], true);
+				_statistics.minPerimeter = i == 0 ? perimeter : (std::min)(_statistics.minPerimeter, perimeter);
+				_statistics.maxPerimeter = (std::max)(_statistics.maxPerimeter, perimeter);
+			}
+		}
+	}
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <opencv2/aruco.hpp>
+
+namespace OpenCVRuntimeComponent
+{
+	namespace ArUcoTracking
+	{
+		// Candidate statistics of the last detected frame
+		struct CandidateStatistics
+		{
+			int numAccepted = 0;
+			int numRejected = 0;
+			double minPerimeter = 0.0; // pixels, of the accepted markers
+			double maxPerimeter = 0.0;
+		};
+
+		// Runs detectMarkers with parameters narrowed to what works for the
+		// current scene. Every rewidenPeriod frames, or when the narrowed
+		// detector loses markers, a probe frame runs each adaptive threshold
+		// window of the default range separately. The windows that found
+		// markers and the perimeter range of the accepted markers then
+		// bound the search of the following frames. After a probe without
+		// markers, frames run the single default detection and probe again
+		// when it finds markers or after rewidenPeriod frames. Tuning is
+		// off until configured, frames then run the default detection.
+		class DetectorParameterTuner
+		{
+		public:
+			DetectorParameterTuner();
+
+			void Configure(bool isEnabled, int rewidenPeriod);
+			void Reset();
+
+			// Same outputs as cv::aruco::detectMarkers
+			void Detect(
+				const cv::Mat& grayImage,
+				const cv::Ptr<cv::aruco::Dictionary>& dictionary,
+				std::vector<std::vector<cv::Point2f>>& markers,
+				std::vector<int32_t>& markerIds,
+				std::vector<std::vector<cv::Point2f>>& rejectedCandidates);
+
+			// Parameters used outside probe frames
+			const cv::Ptr<cv::aruco::DetectorParameters>& Parameters() const { return _params; }
+
+			bool IsNarrowed() const { return _isNarrowed; }
+			const CandidateStatistics& LastStatistics() const { return _statistics; }
+
+		private:
+			bool _isEnabled;
+			int _rewidenPeriod;
+
+			// Default parameters bound the search, the tuned parameters
+			// are a narrowed copy and the probe runs one window at a time
+			cv::Ptr<cv::aruco::DetectorParameters> _defaults;
+			cv::Ptr<cv::aruco::DetectorParameters> _params;
+			cv::Ptr<cv::aruco::DetectorParameters> _probeParams;
+
+			bool _isNarrowed;
+			bool _isProbePending;
+			int _framesSinceProbe;
+			size_t _numProbedMarkers;
+			CandidateStatistics _statistics;
+
+			void Probe(
+				const cv::Mat& grayImage,
+				const cv::Ptr<cv::aruco::Dictionary>& dictionary,
+				std::vector<std::vector<cv::Point2f>>& markers,
+				std::vector<int32_t>& markerIds,
+				std::vector<std::vector<cv::Point2f>>& rejectedCandidates);
+
+			void Widen();
+			void UpdateStatistics(
+				const std::vector<std::vector<cv::Point2f>>& markers,
+				const std::vector<std::vector<cv::Point2f>>& rejectedCandidates);
+		};
+	}
+}
@@ -0,0 +1,261 @@
+#include "DltProjectionSolver.h"
+
+#include <cmath>
+
+namespace OpenCVRuntimeComponent
+{
+	namespace HMDCalibration
+	{
+		namespace
+		{
+			const int MaxRefineIterations = 20;
+		}
+
+		DltProjectionSolver::DltProjectionSolver()
+		{
+			Reset();
+		}
+
+		void DltProjectionSolver::Reset()
+		{
+			_count = 0;
+			_projection.setZero();
+			_isSolved = false;
+			_rmsError = 0.0;
+			_lastResidual = 0.0;
+		}
+
+		bool DltProjectionSolver::Add(
+			const Eigen::Vector3d& point3D,
+			const Eigen::Vector2d& point2D)
+		{
+			if (_count >= MaxCorrespondences)
+			{
+				return false;
+			}
+
+			_points3D.col(_count) = point3D;
+			_points2D.col(_count) = point2D;
+			_count++;
+
+			if (_count < MinCorrespondences)
+			{
+				return true;
+			}
+
+			// Start from the closed form solution, and from the previous
+			// solution if there is one, keep the better refined result
+			Projection p;
+			bool isSolved = SolveDlt(p);
+			if (isSolved)
+			{
+				Refine(p);
+			}
+
+			if (_isSolved)
+			{
+				Projection previous = _projection;
+				Refine(previous);
+				if (!isSolved || SquaredError(previous) < SquaredError(p))
+				{
+					p = previous;
+					isSolved = true;
+				}
+			}
+
+			if (isSolved)
+			{
+				_projection = p;
+				_isSolved = true;
+				_rmsError = std::sqrt(SquaredError(p) / _count);
+				_lastResidual = std::sqrt(SquaredError(p, _count - 1));
+			}
+
+			return true;
+		}
+
+		Eigen::Vector2d DltProjectionSolver::Project(
+			const Eigen::Vector3d& point3D) const
+		{
+			const Eigen::Vector3d x = _projection * point3D.homogeneous();
+			return x.hnormalized();
+		}
+
+		// Hartley normalization of both point sets (zero centroid, mean
+		// distance sqrt(3) and sqrt(2)), then the right null vector of the
+		// 2n x 12 design matrix from the 12 x 12 normal equations.
+		bool DltProjectionSolver::SolveDlt(Projection& p) const
+		{
+			const auto X = _points3D.leftCols(_count);
+			const auto x = _points2D.leftCols(_count);
+
+			const Eigen::Vector3d c3 = X.rowwise().mean();
+			const Eigen::Vector2d c2 = x.rowwise().mean();
+
+			double d3 = 0.0;
+			double d2 = 0.0;
+			for (int i = 0; i < _count; i++)
+			{
+				d3 += (X.col(i) - c3).norm();
+				d2 += (x.col(i) - c2).norm();
+			}
+			d3 /= _count;
+			d2 /= _count;
+
+			if (d3 < 1e-12 || d2 < 1e-12)
+			{
+				return false;
+			}
+
+			const double s3 = std::sqrt(3.0) / d3;
+			const double s2 = std::sqrt(2.0) / d2;
+
+			Matrix12d ata = Matrix12d::Zero();
+			Vector12d r1;
+			Vector12d r2;
+			for (int i = 0; i < _count; i++)
+			{
+				const Eigen::Vector4d Xn = (s3 * (X.col(i) - c3)).homogeneous();
+				const Eigen::Vector2d xn = s2 * (x.col(i) - c2);
+
+				r1 << Xn, Eigen::Vector4d::Zero(), -xn.x() * Xn;
+				r2 << Eigen::Vector4d::Zero(), Xn, -xn.y() * Xn;
+
+				ata.selfadjointView<Eigen::Lower>().rankUpdate(r1);
+				ata.selfadjointView<Eigen::Lower>().rankUpdate(r2);
+			}
+
+			Eigen::SelfAdjointEigenSolver<Matrix12d> eig;
+			eig.compute(ata.selfadjointView<Eigen::Lower>());
+			if (eig.info() != Eigen::Success)
+			{
+				return false;
+			}
+
+			// Eigen values are sorted in increasing order, the two smallest
+			// coincide for degenerate (e.g. coplanar) configurations
+			const Eigen::Vector2d smallest = eig.eigenvalues().head<2>();
+			if (smallest(1) <= 1e-12 * eig.eigenvalues()(11))
+			{
+				return false;
+			}
+
+			const Vector12d v = eig.eigenvectors().col(0);
+			Projection pn;
+			pn.row(0) = v.segment<4>(0).transpose();
+			pn.row(1) = v.segment<4>(4).transpose();
+			pn.row(2) = v.segment<4>(8).transpose();
+
+			// Denormalize, P = T2^-1 * Pn * T3
+			Eigen::Matrix3d t2Inv = Eigen::Matrix3d::Identity();
+			t2Inv.topLeftCorner<2, 2>() /= s2;
+			t2Inv.topRightCorner<2, 1>() = c2;
+
+			Eigen::Matrix4d t3 = Eigen::Matrix4d::Identity();
+			t3.topLeftCorner<3, 3>() *= s3;
+			t3.topRightCorner<3, 1>() = -s3 * c3;
+
+			p = t2Inv * pn * t3;
+			p /= p.norm();
+
+			// Points must lie in front of the display
+			if ((p.row(2) * X.col(0).homogeneous()).value() < 0.0)
+			{
+				p = -p;
+			}
+
+			return true;
+		}
+
+		void DltProjectionSolver::Refine(Projection& p) const
+		{
+			double cost = SquaredError(p);
+			double lambda = 1e-3;
+
+			for (int iteration = 0; iteration < MaxRefineIterations; iteration++)
+			{
+				// Accumulate the normal equations point by point
+				Matrix12d jtj = Matrix12d::Zero();
+				Vector12d jtr = Vector12d::Zero();
+				for (int i = 0; i < _count; i++)
+				{
+					const Eigen::Vector4d X = _points3D.col(i).homogeneous();
+					const Eigen::Vector3d x = p * X;
+					if (std::abs(x.z()) < 1e-12)
+					{
+						continue;
+					}
+
+					const double w = 1.0 / x.z();
+					const double u = x.x() * w;
+					const double v = x.y() * w;
+
+					Vector12d ju;
+					Vector12d jv;
+					ju << w * X, Eigen::Vector4d::Zero(), -u * w * X;
+					jv << Eigen::Vector4d::Zero(), w * X, -v * w * X;
+
+					jtj.selfadjointView<Eigen::Lower>().rankUpdate(ju);
+					jtj.selfadjointView<Eigen::Lower>().rankUpdate(jv);
+					jtr += ju * (u - _points2D(0, i)) + jv * (v - _points2D(1, i));
+				}
+				jtj = jtj.selfadjointView<Eigen::Lower>();
+
+				// Damped step, the scale ambiguity of P is removed by the
+				// damping and by renormalizing after each accepted step
+				bool isImproved = false;
+				while (!isImproved && lambda < 1e8)
+				{
+					Matrix12d a = jtj;
+					a.diagonal() += lambda * (jtj.diagonal().array() + 1e-12).matrix();
+
+					const Vector12d delta = a.ldlt().solve(-jtr);
+
+					Projection candidate = p;
+					candidate.row(0) += delta.segment<4>(0).transpose();
+					candidate.row(1) += delta.segment<4>(4).transpose();
+					candidate.row(2) += delta.segment<4>(8).transpose();
+					candidate /= candidate.norm();
+
+					const double candidateCost = SquaredError(candidate);
+					if (candidateCost < cost)
+					{
+						isImproved = (cost - candidateCost) > 1e-12 * cost;
+						p = candidate;
+						cost = candidateCost;
+						lambda = (std::max)(lambda * 0.1, 1e-9);
+						if (!isImproved)
+						{
+							return;
+						}
+					}
+					else
+					{
+						lambda *= 10.0;
+					}
+				}
+
+				if (!isImproved)
+				{
+					return;
+				}
+			}
+		}
+
+		double DltProjectionSolver::SquaredError(const Projection& p) const
+		{
+			double sum = 0.0;
+			for (int i = 0; i < _count; i++)
+			{
+				sum += SquaredError(p, i);
+			}
+			return sum;
+		}
+
+		double DltProjectionSolver::SquaredError(const Projection& p, int i) const
+		{
+			const Eigen::Vector3d x = p * _points3D.col(i).homogeneous();
+			return (x.hnormalized() - _points2D.col(i)).squaredNorm();
+		}
+	}
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <Eigen/Dense>
+
+namespace OpenCVRuntimeComponent
+{
+	namespace HMDCalibration
+	{
+		// Incremental 3D-2D display calibration (SPAAM). Each added
+		// correspondence re-solves the full 3x4 projection with a
+		// normalized DLT followed by Levenberg-Marquardt refinement of
+		// the reprojection error. All storage is fixed size, no memory
+		// is allocated after construction.
+		class DltProjectionSolver
+		{
+		public:
+			EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+			static const int MaxCorrespondences = 64;
+			static const int MinCorrespondences = 6;
+
+			typedef Eigen::Matrix<double, 3, 4> Projection;
+
+			DltProjectionSolver();
+
+			// Add a correspondence and update the solution. Returns false if
+			// the buffer is full, the point is then ignored.
+			bool Add(const Eigen::Vector3d& point3D, const Eigen::Vector2d& point2D);
+			void Reset();
+
+			int Count() const { return _count; }
+			bool IsSolved() const { return _isSolved; }
+
+			// Projection with unit frobenius norm, maps homogeneous 3D
+			// points to homogeneous pixel coordinates.
+			const Projection& P() const { return _projection; }
+
+			// Residuals in pixels under the current solution
+			double RmsError() const { return _rmsError; }
+			double LastResidual() const { return _lastResidual; }
+
+			Eigen::Vector2d Project(const Eigen::Vector3d& point3D) const;
+
+		private:
+			typedef Eigen::Matrix<double, 12, 12> Matrix12d;
+			typedef Eigen::Matrix<double, 12, 1> Vector12d;
+
+			Eigen::Matrix<double, 3, MaxCorrespondences> _points3D;
+			Eigen::Matrix<double, 2, MaxCorrespondences> _points2D;
+			int _count;
+
+			Projection _projection;
+			bool _isSolved;
+			double _rmsError;
+			double _lastResidual;
+
+			// Normalized DLT, returns false for degenerate configurations
+			bool SolveDlt(Projection& p) const;
+
+			// Levenberg-Marquardt refinement of the pixel reprojection error
+			void Refine(Projection& p) const;
+
+			double SquaredError(const Projection& p) const;
+			double SquaredError(const Projection& p, int i) const;
+		};
+	}
+}
@@ -0,0 +1,85 @@
+#include "FrameIdentity.h"
+
+namespace OpenCVRuntimeComponent
+{
+	namespace ArUcoTracking
+	{
+		namespace
+		{
+			// Sampled grid, rows are offset against each other so the
+			// samples do not line up with image structure
+			const int GridSize = 32;
+
+			const uint64_t FnvOffset = 14695981039346656037ull;
+			const uint64_t FnvPrime = 1099511628211ull;
+
+			inline uint64_t Mix(uint64_t hash, uint64_t value)
+			{
+				for (int i = 0; i < 8; i++)
+				{
+					hash ^= (value >> (8 * i)) & 0xff;
+					hash *= FnvPrime;
+				}
+				return hash;
+			}
+		}
+
+		uint64_t SparseFrameHash(const cv::Mat& frame)
+		{
+			uint64_t hash = FnvOffset;
+			hash = Mix(hash, (uint64_t)frame.cols);
+			hash = Mix(hash, (uint64_t)frame.rows);
+			hash = Mix(hash, (uint64_t)frame.type());
+
+			if (frame.empty())
+			{
+				return hash;
+			}
+
+			const size_t pixelSize = frame.elemSize();
+			for (int gy = 0; gy < GridSize; gy++)
+			{
+				const int y = (int)(((int64_t)(2 * gy + 1) * frame.rows) / (2 * GridSize));
+				const uint8_t* row = frame.ptr<uint8_t>(y);
+				for (int gx = 0; gx < GridSize; gx++)
+				{
+					const int x = (int)((((int64_t)(2 * gx + 1) * frame.cols) / (2 * GridSize) + 7 * gy) % frame.cols);
+					const uint8_t* pixel = row + x * pixelSize;
+
+					uint64_t value = 0;
+					for (size_t b = 0; b < pixelSize && b < 8; b++)
+					{
+						value |= (uint64_t)pixel[b] << (8 * b);
+					}
+					hash = Mix(hash, value);
+				}
+			}
+
+			return hash;
+		}
+
+		FrameIdentity FrameIdentity::Of(
+			const cv::Mat& frame,
+			int64_t timestamp)
+		{
+			FrameIdentity identity;
+			identity.timestamp = timestamp;
+			identity.hash = timestamp != 0 ? 0 : SparseFrameHash(frame);
+			identity.isValid = true;
+			return identity;
+		}
+
+		bool FrameIdentity::IsSameFrame(const FrameIdentity& other) const
+		{
+			if (!isValid || !other.isValid)
+			{
+				return false;
+			}
+			if (timestamp != 0 || other.timestamp != 0)
+			{
+				return timestamp == other.timestamp;
+			}
+			return hash == other.hash;
+		}
+	}
+}
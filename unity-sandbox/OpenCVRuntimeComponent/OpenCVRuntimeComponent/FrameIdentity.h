@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdint>
+#include <opencv2/core.hpp>
+
+namespace OpenCVRuntimeComponent
+{
+	namespace ArUcoTracking
+	{
+		// Hash of a sparse grid of pixels and the frame layout. Sensor noise
+		// makes distinct camera frames differ in some sampled pixel, while a
+		// frame handed in twice hashes the same.
+		uint64_t SparseFrameHash(const cv::Mat& frame);
+
+		// Identity of a camera frame: its capture timestamp (100 ns ticks)
+		// when known, otherwise the sparse hash of its pixels
+		struct FrameIdentity
+		{
+			int64_t timestamp = 0;
+			uint64_t hash = 0;
+			bool isValid = false;
+
+			static FrameIdentity Of(const cv::Mat& frame, int64_t timestamp);
+
+			bool IsSameFrame(const FrameIdentity& other) const;
+		};
+	}
+}
@@ -0,0 +1,167 @@
+#include "pch.h"
+#include "FrameLease.h"
+
+using namespace Windows::Graphics::Imaging;
+
+namespace OpenCVRuntimeComponent
+{
+	int CvTypeOfPixelFormat(BitmapPixelFormat format)
+	{
+		switch (format)
+		{
+		case BitmapPixelFormat::Bgra8:
+			return CV_8UC4;
+
+		case BitmapPixelFormat::Gray16:
+			return CV_16UC1;
+
+		case BitmapPixelFormat::Gray8:
+			return CV_8UC1;
+
+		default:
+			dbg::trace(
+				L"CvTypeOfPixelFormat: unrecognized softwareBitmap pixel format, falling back to CV_8UC1");
+			return CV_8UC1;
+		}
+	}
+
+	FrameLease::FrameLease(
+		SoftwareBitmap^ bitmap,
+		BitmapBufferAccessMode mode,
+		std::weak_ptr<FramePool> pool)
+		: _bitmap(bitmap),
+		_buffer(nullptr),
+		_reference(nullptr),
+		_pool(std::move(pool))
+	{
+		if (bitmap == nullptr)
+		{
+			return;
+		}
+
+		_buffer = bitmap->LockBuffer(mode);
+		_reference = _buffer->CreateReference();
+
+		uint32_t length = 0;
+		uint8_t* data = Io::GetTypedPointerToMemoryBuffer<uint8_t>(
+			_reference,
+			length);
+
+		if (data == nullptr || _buffer->GetPlaneCount() < 1)
+		{
+			dbg::trace(L"FrameLease::FrameLease: could not access the bitmap buffer.");
+			return;
+		}
+
+		const BitmapPlaneDescription plane = _buffer->GetPlaneDescription(0);
+
+		_mat = cv::Mat(
+			plane.Height,
+			plane.Width,
+			CvTypeOfPixelFormat(bitmap->BitmapPixelFormat),
+			data + plane.StartIndex,
+			(size_t)plane.Stride);
+	}
+
+	FrameLease::~FrameLease()
+	{
+		Unlock();
+
+		if (auto pool = _pool.lock())
+		{
+			pool->Return(_bitmap);
+		}
+	}
+
+	void FrameLease::Unlock()
+	{
+		_mat.release();
+
+		// Closing the reference and the buffer releases the lock on the
+		// bitmap, the pixel pointer is invalid from here on
+		if (_reference != nullptr)
+		{
+			delete _reference;
+			_reference = nullptr;
+		}
+		if (_buffer != nullptr)
+		{
+			delete _buffer;
+			_buffer = nullptr;
+		}
+	}
+
+	std::shared_ptr<FrameLease> FrameLease::Lock(
+		SoftwareBitmap^ bitmap,
+		BitmapBufferAccessMode mode)
+	{
+		return std::shared_ptr<FrameLease>(
+			new FrameLease(bitmap, mode, std::weak_ptr<FramePool>()));
+	}
+
+	FramePool::FramePool(size_t capacity)
+		: _capacity(capacity)
+	{
+	}
+
+	std::shared_ptr<FrameLease> FramePool::Acquire(
+		BitmapPixelFormat format,
+		int width,
+		int height)
+	{
+		SoftwareBitmap^ bitmap = nullptr;
+		{
+			std::lock_guard<std::mutex> lock(_lock);
+			for (auto it = _available.begin(); it != _available.end(); ++it)
+			{
+				SoftwareBitmap^ candidate = it->Get();
+				if (candidate->BitmapPixelFormat == format &&
+					candidate->PixelWidth == width &&
+					candidate->PixelHeight == height)
+				{
+					bitmap = candidate;
+					_available.erase(it);
+					break;
+				}
+			}
+		}
+
+		if (bitmap == nullptr)
+		{
+			bitmap = ref new SoftwareBitmap(
+				format,
+				width, height,
+				BitmapAlphaMode::Ignore);
+		}
+
+		return std::shared_ptr<FrameLease>(
+			new FrameLease(bitmap, BitmapBufferAccessMode::ReadWrite, shared_from_this()));
+	}
+
+	void FramePool::Return(SoftwareBitmap^ bitmap)
+	{
+		std::lock_guard<std::mutex> lock(_lock);
+
+		// Keep the most recently returned bitmaps
+		if (_available.size() >= _capacity && !_available.empty())
+		{
+			_available.erase(_available.begin());
+		}
+		if (_capacity > 0)
+		{
+			_available.push_back(Platform::Agile<SoftwareBitmap>(bitmap));
+		}
+	}
+
+	size_t FramePool::Available() const
+	{
+		std::lock_guard<std::mutex> lock(_lock);
+		return _available.size();
+	}
+
+	void FramePool::Clear()
+	{
+		std::lock_guard<std::mutex> lock(_lock);
+		_available.clear();
+	}
+}
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace OpenCVRuntimeComponent
+{
+	class FramePool;
+
+	// Lock on the pixel buffer of a SoftwareBitmap. The bitmap buffer and
+	// its memory reference stay open for the lifetime of the lease, the
+	// wrapped cv::Mat is valid for exactly as long. Leases are shared
+	// through FrameView, the last view released closes the buffer and, for
+	// pooled bitmaps, returns the bitmap to its pool. SoftwareBitmap and
+	// BitmapBuffer are agile, views can be released on any thread.
+	class FrameLease
+	{
+	public:
+		~FrameLease();
+
+		// Lock the buffer of the bitmap, a null bitmap gives an empty lease
+		static std::shared_ptr<FrameLease> Lock(
+			Windows::Graphics::Imaging::SoftwareBitmap^ bitmap,
+			Windows::Graphics::Imaging::BitmapBufferAccessMode mode);
+
+		// Pixels of the first plane, honouring the plane stride
+		const cv::Mat& Mat() const { return _mat; }
+
+		Windows::Graphics::Imaging::SoftwareBitmap^ Bitmap() const { return _bitmap; }
+
+		bool IsEmpty() const { return _mat.empty(); }
+
+		// Close the buffer early while keeping the bitmap, so it can be
+		// read by others before the lease returns it to its pool. Views
+		// of the lease must not be used afterwards.
+		void Unlock();
+
+	private:
+		FrameLease(
+			Windows::Graphics::Imaging::SoftwareBitmap^ bitmap,
+			Windows::Graphics::Imaging::BitmapBufferAccessMode mode,
+			std::weak_ptr<FramePool> pool);
+
+		FrameLease(const FrameLease&) = delete;
+		FrameLease& operator=(const FrameLease&) = delete;
+
+		friend class FramePool;
+
+		Windows::Graphics::Imaging::SoftwareBitmap^ _bitmap;
+		Windows::Graphics::Imaging::BitmapBuffer^ _buffer;
+		Windows::Foundation::IMemoryBufferReference^ _reference;
+		cv::Mat _mat;
+
+		// Pool the bitmap is returned to, empty for caller owned bitmaps
+		std::weak_ptr<FramePool> _pool;
+	};
+
+	// Image (or region of it) of a leased frame. Views are cheap to copy
+	// and can be handed to worker threads, each copy keeps the lease and
+	// with it the pixel buffer alive.
+	class FrameView
+	{
+	public:
+		FrameView() {}
+
+		explicit FrameView(std::shared_ptr<FrameLease> lease)
+			: _lease(std::move(lease))
+		{
+			if (_lease != nullptr)
+			{
+				_mat = _lease->Mat();
+			}
+		}
+
+		// View of a region of this view, clipped to the image
+		FrameView Region(const cv::Rect& region) const
+		{
+			FrameView view(*this);
+			view._mat = _mat(region & cv::Rect(0, 0, _mat.cols, _mat.rows));
+			return view;
+		}
+
+		const cv::Mat& Mat() const { return _mat; }
+
+		bool IsEmpty() const { return _mat.empty(); }
+
+		// Drop the view, releases the lease if it was the last one
+		void Reset()
+		{
+			_mat.release();
+			_lease.reset();
+		}
+
+	private:
+		std::shared_ptr<FrameLease> _lease;
+		cv::Mat _mat;
+	};
+
+	// Reusable SoftwareBitmaps of the component, bitmaps of released leases
+	// are kept for the next request of the same format and size. Capture
+	// bitmaps belong to the media frame reader and are only leased.
+	// Pools are created with std::make_shared, leases keep a weak
+	// reference and drop their bitmap if the pool is gone.
+	class FramePool : public std::enable_shared_from_this<FramePool>
+	{
+	public:
+		explicit FramePool(size_t capacity);
+
+		// Lease a bitmap of the given format and size for writing, reuses
+		// a returned bitmap when one matches
+		std::shared_ptr<FrameLease> Acquire(
+			Windows::Graphics::Imaging::BitmapPixelFormat format,
+			int width,
+			int height);
+
+		size_t Available() const;
+
+		void Clear();
+
+	private:
+		friend class FrameLease;
+
+		void Return(Windows::Graphics::Imaging::SoftwareBitmap^ bitmap);
+
+		const size_t _capacity;
+
+		mutable std::mutex _lock;
+		std::vector<Platform::Agile<Windows::Graphics::Imaging::SoftwareBitmap>> _available;
+	};
+
+	// cv::Mat type of the pixels of a bitmap format (CV_8UC1 if unknown)
+	int CvTypeOfPixelFormat(Windows::Graphics::Imaging::BitmapPixelFormat format);
+}
@@ -0,0 +1,24 @@
+#include "pch.h"
+#include "FusedArUcoPose.h"
+
+using namespace OpenCVRuntimeComponent;
+
+ArUcoTracking::FusedArUcoPose::FusedArUcoPose(
+	float3 position,
+	float3 rotation,
+	float positionSpread,
+	float rotationSpread,
+	int numSamples,
+	int numInliers,
+	bool isValid)
+{
+	// Set the fused position and rotation (rodrigues) of the board or
+	// marker, along with the rms spread (m, rad) of the fused samples
+	Position = position;
+	Rotation = rotation;
+	PositionSpread = positionSpread;
+	RotationSpread = rotationSpread;
+	NumSamples = numSamples;
+	NumInliers = numInliers;
+	IsValid = isValid;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+using namespace Windows::Foundation::Collections;
+using namespace Windows::Foundation::Numerics;
+
+namespace OpenCVRuntimeComponent
+{
+	namespace ArUcoTracking
+	{
+		public ref class FusedArUcoPose sealed
+		{
+		public:
+			FusedArUcoPose(
+				_In_ float3 position,
+				_In_ float3 rotation,
+				_In_ float positionSpread,
+				_In_ float rotationSpread,
+				_In_ int numSamples,
+				_In_ int numInliers,
+				_In_ bool isValid);
+
+			property float3 Position;
+			property float3 Rotation;
+			property float PositionSpread;
+			property float RotationSpread;
+			property int NumSamples;
+			property int NumInliers;
+			property bool IsValid;
+		};
+	}
+}
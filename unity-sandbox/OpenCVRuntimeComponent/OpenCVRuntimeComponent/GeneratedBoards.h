@@ -0,0 +1,25 @@
+#pragma once
+
+// Generated by CustomArUcoBoards --compile-board from data/MarkerConfig/F.fcsv,
+// regenerate instead of editing
+
+#include "BoardLayout.h"
+
+namespace OpenCVRuntimeComponent
+{
+	namespace ArUcoTracking
+	{
+		namespace Boards
+		{
+			constexpr FixedBoardLayout<4> F = {
+				0.04f, // marker length, meters
+				0, // first marker id
+				{ {
+					{ -0.0956385f, 0.0893296f, 0.0f },
+					{ 0.0574237f, 0.0893345f, 0.0f },
+					{ 0.0568413f, -0.0627982f, 0.0f },
+					{ -0.0952103f, -0.0631107f, 0.0f }
+				} } };
+		}
+	}
+}
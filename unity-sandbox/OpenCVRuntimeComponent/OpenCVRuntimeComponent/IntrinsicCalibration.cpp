@@ -0,0 +1,418 @@
+#include "IntrinsicCalibration.h"
+
+#include <algorithm>
+#include <bitset>
+#include <cmath>
+#include <opencv2/calib3d.hpp>
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
+
+namespace OpenCVRuntimeComponent
+{
+	namespace ArUcoTracking
+	{
+		namespace
+		{
+			const int GridSize = 8;
+
+			// Tilt between two views that counts as a new orientation
+			const double DistinctTilt = CV_PI / 6.0;
+
+			bool ReadCameraIntrinsics(
+				cv::FileStorage& storage,
+				CameraIntrinsics& intrinsics)
+			{
+				if (!storage.isOpened())
+				{
+					return false;
+				}
+
+				CameraIntrinsics read;
+				int width = 0, height = 0;
+				storage["image_width"] >> width;
+				storage["image_height"] >> height;
+				storage["camera_matrix"] >> read.cameraMatrix;
+				storage["distortion_coefficients"] >> read.distortionCoefficients;
+				storage["avg_reprojection_error"] >> read.reprojectionRms;
+
+				if (read.cameraMatrix.rows != 3 || read.cameraMatrix.cols != 3 ||
+					read.distortionCoefficients.total() < 4)
+				{
+					return false;
+				}
+
+				read.cameraMatrix.convertTo(read.cameraMatrix, CV_64F);
+				read.distortionCoefficients = read.distortionCoefficients.reshape(1, 1);
+				read.distortionCoefficients.convertTo(read.distortionCoefficients, CV_64F);
+				read.imageSize = cv::Size(width, height);
+				intrinsics = read;
+				return true;
+			}
+
+			void ToGray(const cv::Mat& image, cv::Mat& gray)
+			{
+				switch (image.channels())
+				{
+				case 4:
+					cv::cvtColor(image, gray, cv::COLOR_BGRA2GRAY);
+					break;
+				case 3:
+					cv::cvtColor(image, gray, cv::COLOR_BGR2GRAY);
+					break;
+				default:
+					gray = image;
+					break;
+				}
+			}
+		}
+
+		bool WriteCameraIntrinsics(
+			const std::string& path,
+			const CameraIntrinsics& intrinsics)
+		{
+			cv::FileStorage storage(path, cv::FileStorage::WRITE);
+			if (!storage.isOpened())
+			{
+				return false;
+			}
+
+			storage << "image_width" << intrinsics.imageSize.width;
+			storage << "image_height" << intrinsics.imageSize.height;
+			storage << "camera_matrix" << intrinsics.cameraMatrix;
+			storage << "distortion_coefficients" << intrinsics.distortionCoefficients;
+			storage << "avg_reprojection_error" << intrinsics.reprojectionRms;
+			return true;
+		}
+
+		bool ReadCameraIntrinsicsFile(
+			const std::string& path,
+			CameraIntrinsics& intrinsics)
+		{
+			try
+			{
+				cv::FileStorage storage(path, cv::FileStorage::READ);
+				return ReadCameraIntrinsics(storage, intrinsics);
+			}
+			catch (const cv::Exception&)
+			{
+				return false;
+			}
+		}
+
+		bool ParseCameraIntrinsics(
+			const std::string& text,
+			CameraIntrinsics& intrinsics)
+		{
+			try
+			{
+				cv::FileStorage storage(text, cv::FileStorage::READ | cv::FileStorage::MEMORY);
+				return ReadCameraIntrinsics(storage, intrinsics);
+			}
+			catch (const cv::Exception&)
+			{
+				return false;
+			}
+		}
+
+		IntrinsicCalibrator::IntrinsicCalibrator(const IntrinsicCalibrationSettings& settings)
+			: _settings(settings)
+		{
+			_charucoBoard = _settings.board.dynamicCast<cv::aruco::CharucoBoard>();
+
+			// Sub-pixel marker corners for marker boards, ChArUco corners
+			// are refined by the interpolation
+			_detectorParams = cv::aruco::DetectorParameters::create();
+			if (_charucoBoard.empty())
+			{
+				_detectorParams->cornerRefinementMethod = cv::aruco::CORNER_REFINE_SUBPIX;
+			}
+		}
+
+		void IntrinsicCalibrator::DetectViews(const std::vector<std::string>& imagePaths)
+		{
+			std::vector<CalibrationView> views(imagePaths.size());
+			std::vector<cv::Size> imageSizes(imagePaths.size());
+
+			cv::parallel_for_(cv::Range(0, (int)imagePaths.size()), [&](const cv::Range& range)
+			{
+				for (int i = range.start; i < range.end; i++)
+				{
+					const cv::Mat gray = cv::imread(imagePaths[i], cv::IMREAD_GRAYSCALE);
+					if (gray.empty())
+					{
+						continue;
+					}
+
+					imageSizes[i] = gray.size();
+					views[i].imageIndex = i;
+					if (!DetectView(gray, views[i]))
+					{
+						views[i].imageIndex = -1;
+					}
+				}
+			});
+
+			CollectViews(views, imageSizes);
+		}
+
+		void IntrinsicCalibrator::DetectViews(const std::vector<cv::Mat>& images)
+		{
+			std::vector<CalibrationView> views(images.size());
+			std::vector<cv::Size> imageSizes(images.size());
+
+			cv::parallel_for_(cv::Range(0, (int)images.size()), [&](const cv::Range& range)
+			{
+				cv::Mat gray;
+				for (int i = range.start; i < range.end; i++)
+				{
+					if (images[i].empty())
+					{
+						continue;
+					}
+
+					ToGray(images[i], gray);
+					imageSizes[i] = gray.size();
+					views[i].imageIndex = i;
+					if (!DetectView(gray, views[i]))
+					{
+						views[i].imageIndex = -1;
+					}
+				}
+			});
+
+			CollectViews(views, imageSizes);
+		}
+
+		bool IntrinsicCalibrator::DetectView(
+			const cv::Mat& grayImage,
+			CalibrationView& view) const
+		{
+			std::vector<std::vector<cv::Point2f>> markers, rejectedCandidates;
+			std::vector<int> markerIds;
+			cv::aruco::detectMarkers(
+				grayImage,
+				_settings.board->dictionary,
+				markers,
+				markerIds,
+				_detectorParams,
+				rejectedCandidates);
+
+			if (markerIds.empty())
+			{
+				return false;
+			}
+
+			if (!_charucoBoard.empty())
+			{
+				std::vector<cv::Point2f> charucoCorners;
+				std::vector<int> charucoIds;
+				cv::aruco::interpolateCornersCharuco(
+					markers,
+					markerIds,
+					grayImage,
+					_charucoBoard,
+					charucoCorners,
+					charucoIds);
+
+				for (size_t i = 0; i < charucoIds.size(); i++)
+				{
+					view.objectPoints.push_back(_charucoBoard->chessboardCorners[charucoIds[i]]);
+					view.imagePoints.push_back(charucoCorners[i]);
+				}
+			}
+			else
+			{
+				cv::aruco::getBoardObjectAndImagePoints(
+					_settings.board,
+					markers,
+					markerIds,
+					view.objectPoints,
+					view.imagePoints);
+			}
+
+			if ((int)view.imagePoints.size() < (std::max)(_settings.minCorners, 4))
+			{
+				return false;
+			}
+
+			for (const cv::Point2f& p : view.imagePoints)
+			{
+				const int cx = (std::min)(GridSize - 1, (std::max)(0, (int)(p.x * GridSize / grayImage.cols)));
+				const int cy = (std::min)(GridSize - 1, (std::max)(0, (int)(p.y * GridSize / grayImage.rows)));
+				view.coverage |= uint64_t(1) << (cy * GridSize + cx);
+			}
+
+			return true;
+		}
+
+		void IntrinsicCalibrator::CollectViews(
+			std::vector<CalibrationView>& views,
+			const std::vector<cv::Size>& imageSizes)
+		{
+			_views.clear();
+			_imageSize = cv::Size();
+
+			for (size_t i = 0; i < views.size(); i++)
+			{
+				if (views[i].imageIndex < 0)
+				{
+					continue;
+				}
+
+				if (_imageSize.area() == 0)
+				{
+					_imageSize = imageSizes[i];
+				}
+				if (imageSizes[i] == _imageSize)
+				{
+					_views.push_back(std::move(views[i]));
+				}
+			}
+
+			// Board orientations from a guess of the intrinsics, only the
+			// relative tilt between views is used
+			const double f = (std::max)(_imageSize.width, _imageSize.height);
+			const cv::Matx33d cameraMatrix(
+				f, 0.0, 0.5 * _imageSize.width,
+				0.0, f, 0.5 * _imageSize.height,
+				0.0, 0.0, 1.0);
+
+			cv::parallel_for_(cv::Range(0, (int)_views.size()), [&](const cv::Range& range)
+			{
+				for (int i = range.start; i < range.end; i++)
+				{
+					CalibrationView& view = _views[i];
+					cv::Vec3d rVec, tVec;
+					cv::Matx33d rotation;
+
+					// Degenerate corner sets (a single row of a ChArUco
+					// board) count as a fronto-parallel view
+					view.normal = cv::Vec3d(0.0, 0.0, 1.0);
+					try
+					{
+						if (cv::solvePnP(view.objectPoints, view.imagePoints, cameraMatrix, cv::noArray(), rVec, tVec))
+						{
+							cv::Rodrigues(rVec, rotation);
+							view.normal = rotation * cv::Vec3d(0.0, 0.0, 1.0);
+						}
+					}
+					catch (const cv::Exception&)
+					{
+					}
+				}
+			});
+		}
+
+		std::vector<int> IntrinsicCalibrator::SelectViews() const
+		{
+			std::vector<int> selected;
+			if (_views.empty())
+			{
+				return selected;
+			}
+
+			const size_t maxViews = (size_t)(std::max)(_settings.maxViews, 3);
+			if (_views.size() <= maxViews)
+			{
+				for (size_t i = 0; i < _views.size(); i++)
+				{
+					selected.push_back((int)i);
+				}
+				return selected;
+			}
+
+			// Smallest tilt of each candidate to the selected views
+			std::vector<double> minTilt(_views.size(), CV_PI);
+			std::vector<bool> isSelected(_views.size(), false);
+			uint64_t covered = 0;
+
+			int next = 0;
+			for (size_t i = 1; i < _views.size(); i++)
+			{
+				if (_views[i].imagePoints.size() > _views[next].imagePoints.size())
+				{
+					next = (int)i;
+				}
+			}
+
+			while (next >= 0)
+			{
+				selected.push_back(next);
+				isSelected[next] = true;
+				covered |= _views[next].coverage;
+
+				if (selected.size() >= maxViews)
+				{
+					break;
+				}
+
+				next = -1;
+				double bestScore = 0.0;
+				for (size_t i = 0; i < _views.size(); i++)
+				{
+					if (isSelected[i])
+					{
+						continue;
+					}
+
+					const double dot = std::abs(_views[i].normal.dot(_views[selected.back()].normal));
+					minTilt[i] = (std::min)(minTilt[i], std::acos((std::min)(dot, 1.0)));
+
+					const double newCells =
+						(double)std::bitset<64>(_views[i].coverage & ~covered).count() / (GridSize * GridSize);
+					const double tilt = (std::min)(minTilt[i] / DistinctTilt, 1.0);
+					const double score = newCells + 0.5 * tilt;
+
+					if (score > bestScore)
+					{
+						bestScore = score;
+						next = (int)i;
+					}
+				}
+			}
+
+			return selected;
+		}
+
+		bool IntrinsicCalibrator::Calibrate(
+			const std::vector<int>& selectedViews,
+			CameraIntrinsics& intrinsics) const
+		{
+			if (selectedViews.size() < 3)
+			{
+				return false;
+			}
+
+			std::vector<std::vector<cv::Point3f>> objectPoints;
+			std::vector<std::vector<cv::Point2f>> imagePoints;
+			for (int index : selectedViews)
+			{
+				objectPoints.push_back(_views[index].objectPoints);
+				imagePoints.push_back(_views[index].imagePoints);
+			}
+
+			CameraIntrinsics result;
+			std::vector<cv::Mat> rVecs, tVecs;
+			try
+			{
+				result.reprojectionRms = cv::calibrateCamera(
+					objectPoints,
+					imagePoints,
+					_imageSize,
+					result.cameraMatrix,
+					result.distortionCoefficients,
+					rVecs,
+					tVecs,
+					_settings.flags);
+			}
+			catch (const cv::Exception&)
+			{
+				return false;
+			}
+			result.imageSize = _imageSize;
+
+			intrinsics = result;
+			return true;
+		}
+	}
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <opencv2/core.hpp>
+#include <opencv2/aruco.hpp>
+#include <opencv2/aruco/charuco.hpp>
+
+namespace OpenCVRuntimeComponent
+{
+	namespace ArUcoTracking
+	{
+		// Pinhole intrinsics with distortion (k1, k2, p1, p2, k3)
+		struct CameraIntrinsics
+		{
+			cv::Mat cameraMatrix;
+			cv::Mat distortionCoefficients;
+			cv::Size imageSize;
+			double reprojectionRms = 0.0; // pixels, of the calibration
+		};
+
+		// Intrinsics as an OpenCV FileStorage document (YAML, or XML by
+		// extension) with the keys image_width, image_height,
+		// camera_matrix, distortion_coefficients and
+		// avg_reprojection_error, the layout of the OpenCV calibration
+		// samples
+		bool WriteCameraIntrinsics(
+			const std::string& path,
+			const CameraIntrinsics& intrinsics);
+		bool ReadCameraIntrinsicsFile(
+			const std::string& path,
+			CameraIntrinsics& intrinsics);
+		bool ParseCameraIntrinsics(
+			const std::string& text,
+			CameraIntrinsics& intrinsics);
+
+		struct IntrinsicCalibrationSettings
+		{
+			// ChArUco board (chessboard corners are used) or marker board
+			// (marker corners are used), planar
+			cv::Ptr<cv::aruco::Board> board;
+
+			// Views with fewer corners are not used
+			int minCorners = 12;
+
+			// Views passed to the calibration, selected from all views
+			int maxViews = 40;
+
+			// cv::calibrateCamera flags
+			int flags = 0;
+		};
+
+		// Board corners of one image
+		struct CalibrationView
+		{
+			int imageIndex = -1;
+			std::vector<cv::Point3f> objectPoints;
+			std::vector<cv::Point2f> imagePoints;
+
+			// Cells of an 8 x 8 image grid that hold corners, and the
+			// board normal in the camera frame for the initial guess of
+			// the intrinsics
+			uint64_t coverage = 0;
+			cv::Vec3d normal;
+		};
+
+		// Camera calibration from many images of a board. Corners are
+		// detected in all images in parallel, then a subset of views that
+		// covers the image and the board orientations is selected
+		// greedily so the calibration solves with a bounded number of
+		// views however many images are given.
+		class IntrinsicCalibrator
+		{
+		public:
+			explicit IntrinsicCalibrator(const IntrinsicCalibrationSettings& settings);
+
+			// Decode (gray) and detect the images in parallel, images that
+			// fail to decode or have another size than the first are
+			// skipped
+			void DetectViews(const std::vector<std::string>& imagePaths);
+			void DetectViews(const std::vector<cv::Mat>& images);
+
+			const std::vector<CalibrationView>& Views() const { return _views; }
+			cv::Size ImageSize() const { return _imageSize; }
+
+			// Indices into Views of a well-conditioned subset: starting
+			// from the view with most corners, add the view that covers
+			// most new grid cells and is tilted furthest from the selected
+			// views until maxViews are selected or no view adds either
+			std::vector<int> SelectViews() const;
+
+			// Calibrate from the selected views, false if there are fewer
+			// than three
+			bool Calibrate(
+				const std::vector<int>& selectedViews,
+				CameraIntrinsics& intrinsics) const;
+
+		private:
+			IntrinsicCalibrationSettings _settings;
+			cv::Ptr<cv::aruco::CharucoBoard> _charucoBoard;
+			cv::Ptr<cv::aruco::DetectorParameters> _detectorParams;
+
+			cv::Size _imageSize;
+			std::vector<CalibrationView> _views;
+
+			bool DetectView(
+				const cv::Mat& grayImage,
+				CalibrationView& view) const;
+
+			// Keep the detected views of the size of the first image and
+			// estimate their board normals
+			void CollectViews(
+				std::vector<CalibrationView>& views,
+				const std::vector<cv::Size>& imageSizes);
+		};
+	}
+}
@@ -0,0 +1,162 @@
+#include "MarkerBitSampler.h"
+
+#include <opencv2/imgproc.hpp>
+
+namespace OpenCVRuntimeComponent
+{
+	namespace ArUcoTracking
+	{
+		namespace
+		{
+			int CountBorderErrors(
+				const cv::Mat& bits,
+				int border)
+			{
+				const int n = bits.rows;
+				int errors = 0;
+				for (int r = 0; r < n; r++)
+				{
+					for (int c = 0; c < n; c++)
+					{
+						const bool isBorder = r < border || c < border || r >= n - border || c >= n - border;
+						if (isBorder && bits.at<uint8_t>(r, c) != 0)
+						{
+							errors++;
+						}
+					}
+				}
+				return errors;
+			}
+
+			// Warped candidate, reused by the calls of a thread
+			thread_local cv::Mat Patch;
+		}
+
+		void ExtractCandidateBits(
+			const cv::Mat& grayImage,
+			const std::vector<cv::Point2f>& corners,
+			int markerSize,
+			const cv::aruco::DetectorParameters& params,
+			cv::Mat& bits)
+		{
+			CV_Assert(grayImage.type() == CV_8UC1 && corners.size() == 4);
+			CV_Assert(params.markerBorderBits > 0 && params.perspectiveRemovePixelPerCell > 0);
+
+			const int n = markerSize + 2 * params.markerBorderBits;
+			const int cellSize = params.perspectiveRemovePixelPerCell;
+			const int cellMargin = (int)(params.perspectiveRemoveIgnoredMarginPerCell * cellSize);
+			const int patchSize = n * cellSize;
+
+			// Corners clockwise from the top left onto the patch square
+			const float last = (float)patchSize - 1;
+			const std::vector<cv::Point2f> patchCorners =
+			{
+				cv::Point2f(0, 0),
+				cv::Point2f(last, 0),
+				cv::Point2f(last, last),
+				cv::Point2f(0, last)
+			};
+			cv::warpPerspective(
+				grayImage,
+				Patch,
+				cv::getPerspectiveTransform(corners, patchCorners),
+				cv::Size(patchSize, patchSize),
+				cv::INTER_NEAREST);
+
+			bits = cv::Mat::zeros(n, n, CV_8UC1);
+
+			// Too little contrast for Otsu, the candidate is a uniform
+			// region. Half a cell is left out against the warp border.
+			const int inset = cellSize / 2;
+			cv::Scalar mean, stdDev;
+			cv::meanStdDev(
+				Patch(cv::Rect(inset, inset, patchSize - 2 * inset, patchSize - 2 * inset)),
+				mean,
+				stdDev);
+			if (stdDev[0] < params.minOtsuStdDev)
+			{
+				bits.setTo(mean[0] > 127 ? 1 : 0);
+				return;
+			}
+
+			cv::threshold(Patch, Patch, 125, 255, cv::THRESH_BINARY | cv::THRESH_OTSU);
+
+			// A cell is white if more than half of its pixels inside the
+			// margin are
+			const int cellPixels = cellSize - 2 * cellMargin;
+			for (int r = 0; r < n; r++)
+			{
+				for (int c = 0; c < n; c++)
+				{
+					const cv::Mat cell = Patch(cv::Rect(
+						c * cellSize + cellMargin,
+						r * cellSize + cellMargin,
+						cellPixels,
+						cellPixels));
+					if ((size_t)cv::countNonZero(cell) > cell.total() / 2)
+					{
+						bits.at<uint8_t>(r, c) = 1;
+					}
+				}
+			}
+		}
+
+		bool ExtractMarkerBits(
+			const cv::Mat& grayImage,
+			const std::vector<cv::Point2f>& corners,
+			int markerSize,
+			const cv::aruco::DetectorParameters& params,
+			cv::Mat& bits)
+		{
+			if (corners.size() != 4)
+			{
+				return false;
+			}
+
+			cv::Mat candidateBits;
+			ExtractCandidateBits(grayImage, corners, markerSize, params, candidateBits);
+
+			// Border cells must be black, or white for an inverted marker
+			const int border = params.markerBorderBits;
+			int borderErrors = CountBorderErrors(candidateBits, border);
+			if (params.detectInvertedMarker)
+			{
+				cv::Mat invertedBits = ~candidateBits - 254;
+				const int invertedErrors = CountBorderErrors(invertedBits, border);
+				if (invertedErrors < borderErrors)
+				{
+					borderErrors = invertedErrors;
+					candidateBits = invertedBits;
+				}
+			}
+
+			const int maxBorderErrors = (int)(markerSize * markerSize * params.maxErroneousBitsInBorderRate);
+			if (borderErrors > maxBorderErrors)
+			{
+				return false;
+			}
+
+			candidateBits(cv::Rect(border, border, markerSize, markerSize)).copyTo(bits);
+			return true;
+		}
+
+		bool VerifyMarker(
+			const cv::Mat& grayImage,
+			const std::vector<cv::Point2f>& corners,
+			const cv::aruco::Dictionary& dictionary,
+			int markerId,
+			const cv::aruco::DetectorParameters& params)
+		{
+			cv::Mat bits;
+			if (!ExtractMarkerBits(grayImage, corners, dictionary.markerSize, params, bits))
+			{
+				return false;
+			}
+
+			int id = -1;
+			int rotation = -1;
+			return dictionary.identify(bits, id, rotation, params.errorCorrectionRate) &&
+				id == markerId && rotation == 0;
+		}
+	}
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <vector>
+#include <opencv2/aruco.hpp>
+
+namespace OpenCVRuntimeComponent
+{
+	namespace ArUcoTracking
+	{
+		// Bits of a candidate including its border, the bit extraction of
+		// cv::aruco::detectMarkers (_extractBits, which is not exported):
+		// the candidate is warped to a patch of perspectiveRemovePixelPerCell
+		// pixels per cell, thresholded with Otsu and each cell, less its
+		// ignored margin, is 1 if more than half its pixels are white.
+		// Patches with a standard deviation below minOtsuStdDev are all
+		// white or all black by their mean.
+		void ExtractCandidateBits(
+			const cv::Mat& grayImage,
+			const std::vector<cv::Point2f>& corners,
+			int markerSize,
+			const cv::aruco::DetectorParameters& params,
+			cv::Mat& bits);
+
+		// Inner bits of a candidate as cv::aruco identifies them: false if
+		// more border cells are white than maxErroneousBitsInBorderRate
+		// allows, inverted markers are accepted if detectInvertedMarker
+		// is set.
+		bool ExtractMarkerBits(
+			const cv::Mat& grayImage,
+			const std::vector<cv::Point2f>& corners,
+			int markerSize,
+			const cv::aruco::DetectorParameters& params,
+			cv::Mat& bits);
+
+		// True if the candidate decodes to markerId without rotation. This
+		// is an extra check on markers found without detectMarkers (tracked
+		// corners), it costs one candidate identification per marker.
+		bool VerifyMarker(
+			const cv::Mat& grayImage,
+			const std::vector<cv::Point2f>& corners,
+			const cv::aruco::Dictionary& dictionary,
+			int markerId,
+			const cv::aruco::DetectorParameters& params);
+	}
+}
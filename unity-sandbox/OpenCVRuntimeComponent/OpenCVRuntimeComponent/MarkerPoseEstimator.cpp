@@ -0,0 +1,198 @@
+#include "MarkerPoseEstimator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <opencv2/calib3d.hpp>
+
+namespace OpenCVRuntimeComponent
+{
+	namespace ArUcoTracking
+	{
+		namespace
+		{
+			// Markers solved per thread, fewer are solved on the caller
+			// thread as dispatch would cost more than the solves
+			const int MarkersPerThread = 4;
+			const int MinParallelMarkers = 2 * MarkersPerThread;
+
+			// Ratio of the reprojection errors of the two solutions below
+			// which the pose is ambiguous
+			const double AmbiguityRatio = 2.0;
+
+			double RotationAngle(const cv::Matx33d& a, const cv::Matx33d& b)
+			{
+				const double c = 0.5 * (cv::trace(a.t() * b) - 1.0);
+				return std::acos((std::max)(-1.0, (std::min)(1.0, c)));
+			}
+
+			struct Solution
+			{
+				cv::Vec3d rVec;
+				cv::Vec3d tVec;
+				cv::Matx33d rotation;
+				bool isValid;
+			};
+
+			class SolveBody : public cv::ParallelLoopBody
+			{
+			public:
+				SolveBody(
+					const std::vector<cv::Point3f>& objectPoints,
+					const std::vector<cv::Point2f>& normalizedCorners,
+					const std::vector<int32_t>& markerIds,
+					const std::map<int32_t, cv::Matx33d>& previousRotations,
+					std::vector<Solution>& solutions)
+					: _objectPoints(objectPoints),
+					_normalizedCorners(normalizedCorners),
+					_markerIds(markerIds),
+					_previousRotations(previousRotations),
+					_solutions(solutions)
+				{
+				}
+
+				void operator()(const cv::Range& range) const override
+				{
+					std::vector<cv::Mat> rVecs, tVecs;
+					cv::Mat reprojectionErrors;
+
+					for (int i = range.start; i < range.end; i++)
+					{
+						Solution& solution = _solutions[i];
+						solution.isValid = false;
+
+						const std::vector<cv::Point2f> imagePoints(
+							_normalizedCorners.begin() + 4 * i,
+							_normalizedCorners.begin() + 4 * i + 4);
+
+						// Corners are undistorted and normalized already
+						const int numSolutions = cv::solvePnPGeneric(
+							_objectPoints, imagePoints,
+							cv::Matx33d::eye(), cv::noArray(),
+							rVecs, tVecs,
+							false, cv::SOLVEPNP_IPPE_SQUARE,
+							cv::noArray(), cv::noArray(),
+							reprojectionErrors);
+						if (numSolutions == 0)
+						{
+							continue;
+						}
+
+						int best = 0;
+						if (numSolutions > 1)
+						{
+							const double e0 = reprojectionErrors.at<double>(0);
+							const double e1 = reprojectionErrors.at<double>(1);
+							best = e1 < e0 ? 1 : 0;
+
+							// Ambiguous pose, keep the solution closest to the
+							// rotation of the previous frame
+							const auto previous = _previousRotations.find(_markerIds[i]);
+							if (previous != _previousRotations.end() &&
+								(std::max)(e0, e1) < AmbiguityRatio * (std::min)(e0, e1))
+							{
+								cv::Matx33d r0, r1;
+								cv::Rodrigues(rVecs[0], r0);
+								cv::Rodrigues(rVecs[1], r1);
+								best = RotationAngle(r1, previous->second) < RotationAngle(r0, previous->second) ? 1 : 0;
+							}
+						}
+
+						solution.rVec = rVecs[best];
+						solution.tVec = tVecs[best];
+						cv::Rodrigues(solution.rVec, solution.rotation);
+						solution.isValid = true;
+					}
+				}
+
+			private:
+				const std::vector<cv::Point3f>& _objectPoints;
+				const std::vector<cv::Point2f>& _normalizedCorners;
+				const std::vector<int32_t>& _markerIds;
+				const std::map<int32_t, cv::Matx33d>& _previousRotations;
+				std::vector<Solution>& _solutions;
+			};
+		}
+
+		MarkerPoseEstimator::MarkerPoseEstimator()
+		{
+			SetMarkerLength(1.0f);
+		}
+
+		void MarkerPoseEstimator::SetMarkerLength(float markerLength)
+		{
+			// Corner order required by SOLVEPNP_IPPE_SQUARE, the same as
+			// estimatePoseSingleMarkers
+			const float half = markerLength / 2.0f;
+			_objectPoints =
+			{
+				cv::Point3f(-half, half, 0.0f),
+				cv::Point3f(half, half, 0.0f),
+				cv::Point3f(half, -half, 0.0f),
+				cv::Point3f(-half, -half, 0.0f)
+			};
+			Reset();
+		}
+
+		void MarkerPoseEstimator::Reset()
+		{
+			_previousRotations.clear();
+		}
+
+		int MarkerPoseEstimator::Estimate(
+			const std::vector<std::vector<cv::Point2f>>& markers,
+			const std::vector<int32_t>& markerIds,
+			const cv::Mat& cameraMatrix,
+			const cv::Mat& distortionCoefficients,
+			std::vector<cv::Vec3d>& rVecs,
+			std::vector<cv::Vec3d>& tVecs,
+			std::vector<uchar>& isSolved)
+		{
+			const int numMarkers = (int)markers.size();
+			rVecs.assign(numMarkers, cv::Vec3d());
+			tVecs.assign(numMarkers, cv::Vec3d());
+			isSolved.assign(numMarkers, 0);
+			if (numMarkers == 0)
+			{
+				_previousRotations.clear();
+				return 0;
+			}
+
+			// Undistort the corners of all markers in one call
+			_corners.clear();
+			for (const auto& marker : markers)
+			{
+				_corners.insert(_corners.end(), marker.begin(), marker.end());
+			}
+			cv::undistortPoints(_corners, _normalizedCorners, cameraMatrix, distortionCoefficients);
+
+			std::vector<Solution> solutions(numMarkers);
+			SolveBody body(_objectPoints, _normalizedCorners, markerIds, _previousRotations, solutions);
+			if (numMarkers >= MinParallelMarkers)
+			{
+				cv::parallel_for_(cv::Range(0, numMarkers), body, (double)numMarkers / MarkersPerThread);
+			}
+			else
+			{
+				body(cv::Range(0, numMarkers));
+			}
+
+			// Rotations of this frame disambiguate the next one
+			_previousRotations.clear();
+			int numSolved = 0;
+			for (int i = 0; i < numMarkers; i++)
+			{
+				if (!solutions[i].isValid)
+				{
+					continue;
+				}
+				rVecs[i] = solutions[i].rVec;
+				tVecs[i] = solutions[i].tVec;
+				isSolved[i] = 1;
+				numSolved++;
+				_previousRotations[markerIds[i]] = solutions[i].rotation;
+			}
+
+			return numSolved;
+		}
+	}
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <vector>
+#include <opencv2/core.hpp>
+
+namespace OpenCVRuntimeComponent
+{
+	namespace ArUcoTracking
+	{
+		// Pose of each detected square marker from the closed-form planar
+		// square solver (IPPE). The corners of all markers are undistorted
+		// in one batch and the markers are solved in parallel once there
+		// are enough of them. IPPE returns the two poses a square can take
+		// under near-affine projection; when their reprojection errors are
+		// too close to tell apart, the pose nearest to the rotation of the
+		// same marker in the previous frame is kept.
+		class MarkerPoseEstimator
+		{
+		public:
+			MarkerPoseEstimator();
+
+			void SetMarkerLength(float markerLength);
+
+			// Same outputs as cv::aruco::estimatePoseSingleMarkers and the
+			// status of each marker, 0 where the solver found no pose (the
+			// pose is then zero). Returns the number of solved markers.
+			int Estimate(
+				const std::vector<std::vector<cv::Point2f>>& markers,
+				const std::vector<int32_t>& markerIds,
+				const cv::Mat& cameraMatrix,
+				const cv::Mat& distortionCoefficients,
+				std::vector<cv::Vec3d>& rVecs,
+				std::vector<cv::Vec3d>& tVecs,
+				std::vector<uchar>& isSolved);
+
+			// Forget the rotations of the previous frame
+			void Reset();
+
+			// Marker corners in the marker frame, in detection order
+			const std::vector<cv::Point3f>& ObjectPoints() const { return _objectPoints; }
+
+		private:
+			std::vector<cv::Point3f> _objectPoints;
+
+			// Rotation of each marker in the previous frame
+			std::map<int32_t, cv::Matx33d> _previousRotations;
+
+			// Undistorted normalized corners of all markers
+			std::vector<cv::Point2f> _corners;
+			std::vector<cv::Point2f> _normalizedCorners;
+		};
+	}
+}
@@ -0,0 +1,161 @@
+#include "MotionGate.h"
+
+#include <opencv2/imgproc.hpp>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define MOTION_GATE_SSE2
+#elif defined(_M_ARM64)
+#include <arm64_neon.h>
+#define MOTION_GATE_NEON
+#elif defined(_M_ARM) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define MOTION_GATE_NEON
+#endif
+
+namespace OpenCVRuntimeComponent
+{
+	namespace ArUcoTracking
+	{
+		namespace
+		{
+			// Side length (pixels) of the downsampled board region, and
+			// the fraction of the region size added as padding
+			const int SampleSize = 64;
+			const double RegionPadding = 0.25;
+		}
+
+		uint64_t SumOfAbsoluteDifferences(
+			const uint8_t* a,
+			const uint8_t* b,
+			size_t length)
+		{
+			size_t i = 0;
+			uint64_t sum = 0;
+
+#if defined(MOTION_GATE_SSE2)
+			__m128i acc = _mm_setzero_si128();
+			for (; i + 16 <= length; i += 16)
+			{
+				const __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+				const __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+				acc = _mm_add_epi64(acc, _mm_sad_epu8(va, vb));
+			}
+
+			uint64_t lanes[2];
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), acc);
+			sum = lanes[0] + lanes[1];
+#elif defined(MOTION_GATE_NEON)
+			uint32x4_t acc = vdupq_n_u32(0);
+			for (; i + 16 <= length; i += 16)
+			{
+				const uint8x16_t d = vabdq_u8(vld1q_u8(a + i), vld1q_u8(b + i));
+				acc = vpadalq_u16(acc, vpaddlq_u8(d));
+			}
+
+			uint32_t lanes[4];
+			vst1q_u32(lanes, acc);
+			sum = (uint64_t)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#endif
+
+			for (; i < length; i++)
+			{
+				sum += a[i] > b[i] ? a[i] - b[i] : b[i] - a[i];
+			}
+
+			return sum;
+		}
+
+		MotionGate::MotionGate()
+			: _isEnabled(false),
+			_threshold(2.0),
+			_refreshPeriod(10),
+			_hasReference(false),
+			_framesSinceDetection(0),
+			_lastDifference(0.0)
+		{
+		}
+
+		void MotionGate::Configure(
+			bool isEnabled,
+			double threshold,
+			int refreshPeriod)
+		{
+			_isEnabled = isEnabled;
+			_threshold = threshold;
+			_refreshPeriod = refreshPeriod;
+			Invalidate();
+		}
+
+		bool MotionGate::IsDetectionRequired(const cv::Mat& frame)
+		{
+			_lastDifference = 0.0;
+
+			if (!_isEnabled || !_hasReference || frame.empty() ||
+				++_framesSinceDetection >= _refreshPeriod ||
+				(_region & cv::Rect(0, 0, frame.cols, frame.rows)) != _region)
+			{
+				return true;
+			}
+
+			Sample(frame, _current);
+
+			const size_t n = _current.total();
+			_lastDifference = (double)SumOfAbsoluteDifferences(_reference.data, _current.data, n) / n;
+
+			return _lastDifference > _threshold;
+		}
+
+		void MotionGate::SetReference(
+			const cv::Mat& frame,
+			const cv::Rect& boardRegion)
+		{
+			const int padX = (int)(boardRegion.width * RegionPadding);
+			const int padY = (int)(boardRegion.height * RegionPadding);
+
+			_region = cv::Rect(
+				boardRegion.x - padX,
+				boardRegion.y - padY,
+				boardRegion.width + 2 * padX,
+				boardRegion.height + 2 * padY) & cv::Rect(0, 0, frame.cols, frame.rows);
+
+			if (!_isEnabled || _region.area() == 0)
+			{
+				Invalidate();
+				return;
+			}
+
+			Sample(frame, _reference);
+			_hasReference = true;
+			_framesSinceDetection = 0;
+		}
+
+		void MotionGate::Invalidate()
+		{
+			_hasReference = false;
+			_framesSinceDetection = 0;
+		}
+
+		void MotionGate::Sample(
+			const cv::Mat& frame,
+			cv::Mat& sample)
+		{
+			// Area interpolation averages out sensor noise, the gray
+			// conversion then only runs on the small image
+			cv::resize(frame(_region), _sampleScratch, cv::Size(SampleSize, SampleSize), 0, 0, cv::INTER_AREA);
+
+			switch (_sampleScratch.channels())
+			{
+			case 4:
+				cv::cvtColor(_sampleScratch, sample, cv::COLOR_BGRA2GRAY);
+				break;
+			case 3:
+				cv::cvtColor(_sampleScratch, sample, cv::COLOR_BGR2GRAY);
+				break;
+			default:
+				_sampleScratch.convertTo(sample, CV_8U, _sampleScratch.depth() == CV_16U ? 1.0 / 256.0 : 1.0);
+				break;
+			}
+		}
+	}
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <opencv2/core.hpp>
+
+namespace OpenCVRuntimeComponent
+{
+	namespace ArUcoTracking
+	{
+		// Decides per frame whether full marker detection is needed. The
+		// region of the last detected board is downsampled and compared to
+		// the same region when the board was last detected; while the mean
+		// absolute difference stays below the threshold the previous pose
+		// can be reused. Detection is forced every refreshPeriod frames.
+		// Gating is off until configured, every frame is then detected.
+		class MotionGate
+		{
+		public:
+			MotionGate();
+
+			// threshold is the mean absolute gray level difference per
+			// pixel of the downsampled region
+			void Configure(bool isEnabled, double threshold, int refreshPeriod);
+
+			// True if the frame must go through full detection
+			bool IsDetectionRequired(const cv::Mat& frame);
+
+			// Record the region of the board after a successful detection
+			// (in frame pixels), it is padded and becomes the new reference
+			void SetReference(const cv::Mat& frame, const cv::Rect& boardRegion);
+
+			// Drop the reference after a failed detection
+			void Invalidate();
+
+			// Mean absolute difference of the last gated frame
+			double LastDifference() const { return _lastDifference; }
+
+		private:
+			bool _isEnabled;
+			double _threshold;
+			int _refreshPeriod;
+
+			bool _hasReference;
+			cv::Rect _region;
+			cv::Mat _reference;
+			cv::Mat _current;
+			int _framesSinceDetection;
+			double _lastDifference;
+
+			// Downsampled gray copy of the region of a frame
+			void Sample(const cv::Mat& frame, cv::Mat& sample);
+			cv::Mat _sampleScratch;
+		};
+
+		// Sum of absolute differences of two byte buffers
+		// (SSE2 on x86/x64, NEON on ARM, scalar otherwise)
+		uint64_t SumOfAbsoluteDifferences(const uint8_t* a, const uint8_t* b, size_t length);
+	}
+}
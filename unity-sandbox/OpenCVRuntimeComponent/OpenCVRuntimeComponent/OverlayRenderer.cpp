@@ -0,0 +1,211 @@
+#include "pch.h"
+#include "OverlayRenderer.h"
+
+#include <opencv2/aruco.hpp>
+
+using namespace Windows::Graphics::Imaging;
+
+namespace OpenCVRuntimeComponent
+{
+	namespace ArUcoTracking
+	{
+		OverlayRenderer::OverlayRenderer()
+			: _isEnabled(false),
+			_minInterval(std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+				std::chrono::milliseconds(200)).count()),
+			_hasPending(false),
+			_isStopping(false),
+			_publishedSequence(0)
+		{
+			// Published frames plus the one being drawn
+			_outputPool = std::make_shared<FramePool>(PublishedFrames + 1);
+		}
+
+		OverlayRenderer::~OverlayRenderer()
+		{
+			Stop();
+		}
+
+		void OverlayRenderer::Configure(
+			bool isEnabled,
+			double maxFramesPerSecond)
+		{
+			_minInterval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+				std::chrono::duration<double>(1.0 / (std::max)(maxFramesPerSecond, 0.1))).count();
+
+			if (isEnabled && !_isEnabled)
+			{
+				Start();
+			}
+			else if (!isEnabled && _isEnabled)
+			{
+				Stop();
+			}
+		}
+
+		void OverlayRenderer::Submit(
+			const cv::Mat& frame,
+			int64_t frameSequence,
+			const std::vector<std::vector<cv::Point2f>>& markers,
+			const std::vector<int32_t>& markerIds,
+			const std::vector<cv::Vec3d>& rVecs,
+			const std::vector<cv::Vec3d>& tVecs,
+			const cv::Mat& cameraMatrix,
+			const cv::Mat& distortionCoefficients,
+			double axisLength)
+		{
+			if (!_isEnabled || frame.empty())
+			{
+				return;
+			}
+
+			const auto now = std::chrono::steady_clock::now();
+			if (now - _lastAccepted < std::chrono::steady_clock::duration(_minInterval.load()))
+			{
+				return;
+			}
+
+			// The worker only holds the lock to take the pending job
+			std::unique_lock<std::mutex> lock(_lock, std::try_to_lock);
+			if (!lock.owns_lock())
+			{
+				return;
+			}
+
+			_lastAccepted = now;
+
+			frame.copyTo(_pending.image);
+			_pending.frameSequence = frameSequence;
+			_pending.markers = markers;
+			_pending.markerIds = markerIds;
+			_pending.rVecs = rVecs;
+			_pending.tVecs = tVecs;
+			cameraMatrix.copyTo(_pending.cameraMatrix);
+			distortionCoefficients.copyTo(_pending.distortionCoefficients);
+			_pending.axisLength = axisLength;
+			_hasPending = true;
+
+			lock.unlock();
+			_wake.notify_one();
+		}
+
+		SoftwareBitmap^ OverlayRenderer::LatestOverlay(int64_t& frameSequence)
+		{
+			std::lock_guard<std::mutex> lock(_publishLock);
+
+			frameSequence = _publishedSequence;
+			return _published.empty() ? nullptr : _published.back()->Bitmap();
+		}
+
+		void OverlayRenderer::Start()
+		{
+			{
+				std::lock_guard<std::mutex> lock(_lock);
+				_isStopping = false;
+				_hasPending = false;
+			}
+
+			_worker = std::thread(&OverlayRenderer::Run, this);
+			_isEnabled = true;
+		}
+
+		void OverlayRenderer::Stop()
+		{
+			_isEnabled = false;
+
+			{
+				std::lock_guard<std::mutex> lock(_lock);
+				_isStopping = true;
+			}
+			_wake.notify_one();
+
+			if (_worker.joinable())
+			{
+				_worker.join();
+			}
+		}
+
+		void OverlayRenderer::Run()
+		{
+			// Drawing must not compete with detection for the cores
+			SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_LOWEST);
+
+			for (;;)
+			{
+				{
+					std::unique_lock<std::mutex> lock(_lock);
+					_wake.wait(lock, [this] { return _hasPending || _isStopping; });
+					if (_isStopping)
+					{
+						return;
+					}
+
+					std::swap(_pending, _working);
+					_hasPending = false;
+				}
+
+				Render(_working);
+			}
+		}
+
+		void OverlayRenderer::Render(OverlayJob& job)
+		{
+			// The aruco drawing functions need a gray or BGR image
+			switch (job.image.type())
+			{
+			case CV_8UC4:
+				cv::cvtColor(job.image, _bgrImage, cv::COLOR_BGRA2BGR);
+				break;
+			case CV_8UC3:
+				job.image.copyTo(_bgrImage);
+				break;
+			case CV_16UC1:
+				job.image.convertTo(job.image, CV_8U, 1.0 / 256.0);
+				cv::cvtColor(job.image, _bgrImage, cv::COLOR_GRAY2BGR);
+				break;
+			default:
+				cv::cvtColor(job.image, _bgrImage, cv::COLOR_GRAY2BGR);
+				break;
+			}
+
+			if (!job.markerIds.empty())
+			{
+				cv::aruco::drawDetectedMarkers(
+					_bgrImage,
+					job.markers,
+					job.markerIds);
+			}
+
+			for (size_t i = 0; i < job.rVecs.size(); i++)
+			{
+				cv::aruco::drawAxis(
+					_bgrImage,
+					job.cameraMatrix, job.distortionCoefficients,
+					job.rVecs[i], job.tVecs[i], job.axisLength);
+			}
+
+			// Recycled output bitmap, unlocked once drawn so it can be
+			// read for display
+			std::shared_ptr<FrameLease> output = _outputPool->Acquire(
+				BitmapPixelFormat::Bgra8,
+				_bgrImage.cols,
+				_bgrImage.rows);
+			if (output->IsEmpty())
+			{
+				return;
+			}
+
+			cv::Mat outputImage = output->Mat();
+			cv::cvtColor(_bgrImage, outputImage, cv::COLOR_BGR2BGRA);
+			output->Unlock();
+
+			std::lock_guard<std::mutex> lock(_publishLock);
+			_published.push_back(output);
+			if (_published.size() > PublishedFrames)
+			{
+				_published.pop_front();
+			}
+			_publishedSequence = job.frameSequence;
+		}
+	}
+}
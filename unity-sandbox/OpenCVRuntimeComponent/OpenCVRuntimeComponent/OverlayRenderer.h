@@ -0,0 +1,103 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "FrameLease.h"
+
+namespace OpenCVRuntimeComponent
+{
+	namespace ArUcoTracking
+	{
+		// Detection result drawn on one overlay frame
+		struct OverlayJob
+		{
+			cv::Mat image;
+			int64_t frameSequence = 0;
+			std::vector<std::vector<cv::Point2f>> markers;
+			std::vector<int32_t> markerIds;
+			std::vector<cv::Vec3d> rVecs;
+			std::vector<cv::Vec3d> tVecs;
+			cv::Mat cameraMatrix;
+			cv::Mat distortionCoefficients;
+			double axisLength = 0.0;
+		};
+
+		// Debug preview of the detections. Frames are accepted at a reduced
+		// rate, the marker outlines, ids and pose axes are drawn on a low
+		// priority worker into recycled output bitmaps. Submitting never
+		// waits for the worker, a frame arriving while the worker holds the
+		// pending slot is dropped.
+		class OverlayRenderer
+		{
+		public:
+			OverlayRenderer();
+			~OverlayRenderer();
+
+			// Start or stop the worker, at most maxFramesPerSecond frames
+			// are drawn
+			void Configure(bool isEnabled, double maxFramesPerSecond);
+
+			bool IsEnabled() const { return _isEnabled; }
+
+			// Queue the detection result of a frame if an overlay is due.
+			// Due frames are copied into a staging image, the caller keeps
+			// ownership of the frame.
+			void Submit(
+				const cv::Mat& frame,
+				int64_t frameSequence,
+				const std::vector<std::vector<cv::Point2f>>& markers,
+				const std::vector<int32_t>& markerIds,
+				const std::vector<cv::Vec3d>& rVecs,
+				const std::vector<cv::Vec3d>& tVecs,
+				const cv::Mat& cameraMatrix,
+				const cv::Mat& distortionCoefficients,
+				double axisLength);
+
+			// Bitmap (Bgra8) of the newest overlay and its frame sequence,
+			// null before the first overlay. The bitmap is not reused until
+			// PublishedFrames newer overlays have been drawn.
+			Windows::Graphics::Imaging::SoftwareBitmap^ LatestOverlay(int64_t& frameSequence);
+
+		private:
+			static const size_t PublishedFrames = 2;
+
+			void Start();
+			void Stop();
+			void Run();
+			void Render(OverlayJob& job);
+
+			std::atomic<bool> _isEnabled;
+			// Set from the app thread and read on the detection thread,
+			// in steady_clock ticks
+			std::atomic<std::chrono::steady_clock::rep> _minInterval;
+			std::chrono::steady_clock::time_point _lastAccepted;
+
+			// Pending job and its hand-over to the worker, the staging
+			// images of the two jobs are swapped rather than reallocated
+			std::mutex _lock;
+			std::condition_variable _wake;
+			OverlayJob _pending;
+			bool _hasPending;
+			bool _isStopping;
+			std::thread _worker;
+
+			// Worker state
+			OverlayJob _working;
+			cv::Mat _bgrImage;
+
+			// Output bitmaps, the published leases keep their bitmaps out
+			// of the pool while they may still be displayed
+			std::shared_ptr<FramePool> _outputPool;
+			std::mutex _publishLock;
+			std::deque<std::shared_ptr<FrameLease>> _published;
+			int64_t _publishedSequence;
+		};
+	}
+}
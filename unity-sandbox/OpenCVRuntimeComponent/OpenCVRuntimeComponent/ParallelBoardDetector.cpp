@@ -0,0 +1,265 @@
+#include "pch.h"
+#include "ParallelBoardDetector.h"
+
+namespace OpenCVRuntimeComponent
+{
+	namespace ArUcoTracking
+	{
+		ParallelBoardDetector::ParallelBoardDetector(
+			float markerSize,
+			int numMarkers,
+			int dictId,
+			Windows::Foundation::Collections::IVector<Windows::Foundation::Numerics::float3>^ customObjectPoints)
+			: _markerSize(markerSize),
+			_numMarkers(numMarkers),
+			_dictId(dictId),
+			_customObjectPoints(customObjectPoints),
+			_maxInFlight(0),
+			_isQualityControlled(false),
+			_qualityBudgetMilliseconds(0.0f),
+			_slowdown(1.0f),
+			_qualityGeneration(0),
+			_isStopping(false),
+			_nextTicket(0),
+			_nextDelivery(0),
+			_lastCaptureTime(INT64_MIN)
+		{
+		}
+
+		ParallelBoardDetector::~ParallelBoardDetector()
+		{
+			Stop();
+		}
+
+		void ParallelBoardDetector::Configure(
+			int numWorkers,
+			int maxInFlight)
+		{
+			Stop();
+
+			_maxInFlight = (std::max)(maxInFlight, 1);
+			if (numWorkers > 0)
+			{
+				Start(numWorkers);
+			}
+		}
+
+		void ParallelBoardDetector::ConfigureQualityControl(
+			bool isEnabled,
+			float budgetMilliseconds)
+		{
+			std::lock_guard<std::mutex> lock(_lock);
+			_isQualityControlled = isEnabled;
+			_qualityBudgetMilliseconds = budgetMilliseconds;
+			_qualityGeneration++;
+		}
+
+		void ParallelBoardDetector::SetInjectedSlowdown(float factor)
+		{
+			std::lock_guard<std::mutex> lock(_lock);
+			_slowdown = factor;
+			_qualityGeneration++;
+		}
+
+		bool ParallelBoardDetector::Submit(
+			const cv::Mat& frame,
+			OpenCVRuntimeComponent::CameraCalibrationParams^ cameraCalibrationParams,
+			Windows::Foundation::TimeSpan captureTime)
+		{
+			BoardDetectionJob job;
+			{
+				std::lock_guard<std::mutex> lock(_lock);
+				if (_workers.empty() ||
+					_nextTicket - _nextDelivery >= _maxInFlight ||
+					captureTime.Duration <= _lastCaptureTime)
+				{
+					return false;
+				}
+
+				job.ticket = _nextTicket++;
+				_lastCaptureTime = captureTime.Duration;
+
+				if (!_freeImages.empty())
+				{
+					job.image = _freeImages.back();
+					_freeImages.pop_back();
+				}
+			}
+
+			// The caller keeps ownership of the frame, copy outside the lock
+			job.captureTime = captureTime;
+			job.cameraCalibrationParams = cameraCalibrationParams;
+			frame.copyTo(job.image);
+
+			{
+				// Frames of a stopped pool are dropped
+				std::lock_guard<std::mutex> lock(_lock);
+				if (job.ticket < _nextDelivery)
+				{
+					return false;
+				}
+				_queue.push_back(std::move(job));
+			}
+			_wake.notify_one();
+
+			return true;
+		}
+
+		void ParallelBoardDetector::TakeCompleted(std::vector<DetectedArUcoBoard^>& boards)
+		{
+			std::lock_guard<std::mutex> lock(_lock);
+
+			for (auto it = _completed.begin();
+				it != _completed.end() && it->first == _nextDelivery;
+				it = _completed.erase(it))
+			{
+				boards.push_back(it->second);
+				_nextDelivery++;
+			}
+		}
+
+		int ParallelBoardDetector::InFlight()
+		{
+			std::lock_guard<std::mutex> lock(_lock);
+			return (int)(_nextTicket - _nextDelivery);
+		}
+
+		bool ParallelBoardDetector::IsEnabled() const
+		{
+			std::lock_guard<std::mutex> lock(_lock);
+			return !_workers.empty();
+		}
+
+		void ParallelBoardDetector::Start(int numWorkers)
+		{
+			std::lock_guard<std::mutex> lock(_lock);
+			_isStopping = false;
+
+			for (int i = 0; i < numWorkers; i++)
+			{
+				// Each worker sees every n-th frame only, the state that
+				// assumes consecutive frames is disabled
+				auto tracker = ref new ArUcoMarkerTracker(
+					_markerSize,
+					_numMarkers,
+					_dictId,
+					_customObjectPoints);
+				tracker->ConfigureMotionGating(false, 0.0f, 1);
+				tracker->ConfigureCornerTracking(false, 1, 0.0f, 1.0f);
+				tracker->ConfigureDetectorTuning(false, 1);
+
+				_workers.emplace_back(&ParallelBoardDetector::Run, this, tracker);
+			}
+		}
+
+		void ParallelBoardDetector::Stop()
+		{
+			std::vector<std::thread> workers;
+			{
+				std::lock_guard<std::mutex> lock(_lock);
+				_isStopping = true;
+				workers.swap(_workers);
+			}
+			_wake.notify_all();
+
+			for (auto& worker : workers)
+			{
+				worker.join();
+			}
+
+			// Frames in flight are dropped, tickets restart after them
+			std::lock_guard<std::mutex> lock(_lock);
+			_queue.clear();
+			_completed.clear();
+			_nextDelivery = _nextTicket;
+		}
+
+		void ParallelBoardDetector::Run(ArUcoMarkerTracker^ tracker)
+		{
+			// Generation of the quality settings applied to the tracker,
+			// the tracker is only touched by this thread
+			int appliedGeneration = -1;
+
+			for (;;)
+			{
+				BoardDetectionJob job;
+				bool isQualityControlled = false;
+				float qualityBudgetMilliseconds = 0.0f;
+				float slowdown = 1.0f;
+				bool isQualityChanged = false;
+				{
+					std::unique_lock<std::mutex> lock(_lock);
+					_wake.wait(lock, [this] { return !_queue.empty() || _isStopping; });
+					if (_isStopping)
+					{
+						return;
+					}
+
+					job = std::move(_queue.front());
+					_queue.pop_front();
+
+					if (appliedGeneration != _qualityGeneration)
+					{
+						appliedGeneration = _qualityGeneration;
+						isQualityControlled = _isQualityControlled;
+						qualityBudgetMilliseconds = _qualityBudgetMilliseconds;
+						slowdown = _slowdown;
+						isQualityChanged = true;
+					}
+				}
+
+				if (isQualityChanged)
+				{
+					tracker->ConfigureQualityControl(isQualityControlled, qualityBudgetMilliseconds);
+					tracker->SetInjectedSlowdown(slowdown);
+				}
+
+				// Every ticket needs a result, later results wait for it. A
+				// failed detection completes its ticket with an undetected
+				// board, an exception leaving the worker would end the app.
+				DetectedArUcoBoard^ result = nullptr;
+				try
+				{
+					auto board = tracker->DetectBoardInImage(
+						job.image,
+						job.cameraCalibrationParams,
+						job.captureTime);
+
+					// Results are copied, the tracker returns its cached
+					// board for a repeated frame
+					result = ref new DetectedArUcoBoard(
+						board->Position,
+						board->Rotation,
+						board->IsDetected);
+					result->Quality = board->Quality;
+				}
+				catch (Platform::Exception^ e)
+				{
+					dbg::trace(L"ParallelBoardDetector::Run: detection failed (%s)", e->Message->Data());
+				}
+				catch (const std::exception& e)
+				{
+					// Includes cv::Exception
+					dbg::trace(L"ParallelBoardDetector::Run: detection failed (%S)", e.what());
+				}
+
+				if (result == nullptr)
+				{
+					result = ref new DetectedArUcoBoard(
+						Windows::Foundation::Numerics::float3::zero(),
+						Windows::Foundation::Numerics::float3::zero(),
+						false);
+				}
+				result->FrameSequence = job.ticket;
+				result->Timestamp = job.captureTime;
+
+				std::lock_guard<std::mutex> lock(_lock);
+				if (job.ticket >= _nextDelivery)
+				{
+					_completed[job.ticket] = result;
+				}
+				_freeImages.push_back(job.image);
+			}
+		}
+	}
+}
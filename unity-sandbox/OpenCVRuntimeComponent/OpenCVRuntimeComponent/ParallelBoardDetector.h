@@ -0,0 +1,105 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace OpenCVRuntimeComponent
+{
+	namespace ArUcoTracking
+	{
+		// Frame queued for parallel board detection
+		struct BoardDetectionJob
+		{
+			int64_t ticket = 0;
+			Windows::Foundation::TimeSpan captureTime;
+			cv::Mat image;
+			OpenCVRuntimeComponent::CameraCalibrationParams^ cameraCalibrationParams;
+		};
+
+		// Board detection of several frames at once on a pool of workers,
+		// each with its own tracker. Results pass through a reorder buffer
+		// and are delivered strictly in capture time order. Frames count as
+		// in flight from submission until their result is taken, at most
+		// maxInFlight frames are accepted. Motion gating, corner tracking
+		// and detector tuning rely on consecutive frames and are off on
+		// the workers. Quality control is configured for all workers, each
+		// worker adapts its level to the timings of its own frames.
+		class ParallelBoardDetector
+		{
+		public:
+			ParallelBoardDetector(
+				float markerSize,
+				int numMarkers,
+				int dictId,
+				Windows::Foundation::Collections::IVector<Windows::Foundation::Numerics::float3>^ customObjectPoints);
+			~ParallelBoardDetector();
+
+			// Start numWorkers workers, stops the workers and drops all
+			// frames in flight if numWorkers is 0
+			void Configure(int numWorkers, int maxInFlight);
+
+			bool IsEnabled() const;
+
+			// Quality control of the workers, applied by each worker before
+			// its next frame and kept for workers started later
+			void ConfigureQualityControl(bool isEnabled, float budgetMilliseconds);
+			void SetInjectedSlowdown(float factor);
+
+			// Copy the frame and queue it. Returns false if maxInFlight
+			// frames are in flight or the capture time is not later than
+			// that of the last accepted frame.
+			bool Submit(
+				const cv::Mat& frame,
+				OpenCVRuntimeComponent::CameraCalibrationParams^ cameraCalibrationParams,
+				Windows::Foundation::TimeSpan captureTime);
+
+			// Take the completed results in capture time order, stops at
+			// the first frame still being processed
+			void TakeCompleted(std::vector<DetectedArUcoBoard^>& boards);
+
+			int InFlight();
+
+		private:
+			void Start(int numWorkers);
+			void Stop();
+			void Run(ArUcoMarkerTracker^ tracker);
+
+			// Tracker parameters of the workers
+			const float _markerSize;
+			const int _numMarkers;
+			const int _dictId;
+			Windows::Foundation::Collections::IVector<Windows::Foundation::Numerics::float3>^ _customObjectPoints;
+
+			int _maxInFlight;
+
+			// Quality control settings, workers apply them when the
+			// generation differs from the one they last applied
+			bool _isQualityControlled;
+			float _qualityBudgetMilliseconds;
+			float _slowdown;
+			int _qualityGeneration;
+
+			mutable std::mutex _lock;
+			std::condition_variable _wake;
+			bool _isStopping;
+			std::vector<std::thread> _workers;
+
+			// Queued frames, completed results by ticket and the ticket of
+			// the next result to deliver
+			std::deque<BoardDetectionJob> _queue;
+			std::map<int64_t, DetectedArUcoBoard^> _completed;
+			int64_t _nextTicket;
+			int64_t _nextDelivery;
+			int64_t _lastCaptureTime;
+
+			// Staging images of processed frames, reused by later frames
+			std::vector<cv::Mat> _freeImages;
+		};
+	}
+}
@@ -0,0 +1,208 @@
+#include "PoseFusion.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+#include <Eigen/Dense>
+
+namespace OpenCVRuntimeComponent
+{
+	namespace ArUcoTracking
+	{
+		namespace
+		{
+			// Scale factor from MAD to standard deviation, and the
+			// number of deviations accepted as inliers
+			const double MadToSigma = 1.4826;
+			const double InlierSigmas = 3.0;
+
+			Eigen::Quaterniond QuatFromRodrigues(const cv::Vec3d& r)
+			{
+				const Eigen::Vector3d v(r[0], r[1], r[2]);
+				const double angle = v.norm();
+				if (angle < 1e-12)
+				{
+					return Eigen::Quaterniond::Identity();
+				}
+				return Eigen::Quaterniond(Eigen::AngleAxisd(angle, v / angle));
+			}
+
+			cv::Vec3d RodriguesFromQuat(const Eigen::Quaterniond& q)
+			{
+				const Eigen::AngleAxisd aa(q);
+				const Eigen::Vector3d v = aa.axis() * aa.angle();
+				return cv::Vec3d(v.x(), v.y(), v.z());
+			}
+
+			double AngleBetween(const Eigen::Quaterniond& a, const Eigen::Quaterniond& b)
+			{
+				const double d = (std::min)(1.0, std::abs(a.dot(b)));
+				return 2.0 * std::acos(d);
+			}
+
+			double Median(std::vector<double> v)
+			{
+				const size_t mid = v.size() / 2;
+				std::nth_element(v.begin(), v.begin() + mid, v.end());
+				double m = v[mid];
+				if (v.size() % 2 == 0)
+				{
+					m = 0.5 * (m + *std::max_element(v.begin(), v.begin() + mid));
+				}
+				return m;
+			}
+		}
+
+		PoseFusionBuffer::PoseFusionBuffer()
+			: _head(0),
+			_count(0),
+			_minTranslationThreshold(0.002),
+			_minRotationThreshold(0.5 * CV_PI / 180.0)
+		{
+		}
+
+		void PoseFusionBuffer::Push(
+			int64_t frameIndex,
+			const cv::Vec3d& rVec,
+			const cv::Vec3d& tVec)
+		{
+			_samples[_head] = { frameIndex, rVec, tVec };
+			_head = (_head + 1) % Capacity;
+			_count = (std::min)(_count + 1, Capacity);
+		}
+
+		void PoseFusionBuffer::Clear()
+		{
+			_head = 0;
+			_count = 0;
+		}
+
+		void PoseFusionBuffer::SetMinOutlierThresholds(
+			double translation,
+			double rotation)
+		{
+			_minTranslationThreshold = translation;
+			_minRotationThreshold = rotation;
+		}
+
+		FusedPose PoseFusionBuffer::Fuse(
+			int64_t currentFrameIndex,
+			int numFrames) const
+		{
+			FusedPose fused;
+
+			// Collect the samples of the requested frame window, newest first
+			std::vector<Eigen::Vector3d> t;
+			std::vector<Eigen::Quaterniond, Eigen::aligned_allocator<Eigen::Quaterniond>> q;
+			t.reserve(_count);
+			q.reserve(_count);
+
+			for (int i = 0; i < _count; i++)
+			{
+				const Sample& s = _samples[(_head - 1 - i + Capacity) % Capacity];
+				if (s.frameIndex > currentFrameIndex ||
+					s.frameIndex <= currentFrameIndex - numFrames)
+				{
+					continue;
+				}
+
+				t.emplace_back(s.tVec[0], s.tVec[1], s.tVec[2]);
+				q.push_back(QuatFromRodrigues(s.rVec));
+			}
+
+			const int n = (int)t.size();
+			fused.numSamples = n;
+			if (n == 0)
+			{
+				return fused;
+			}
+
+			// Component-wise median translation and the medoid rotation
+			// are the robust reference for outlier rejection
+			Eigen::Vector3d tMedian;
+			std::vector<double> c(n);
+			for (int k = 0; k < 3; k++)
+			{
+				for (int i = 0; i < n; i++) c[i] = t[i](k);
+				tMedian(k) = Median(c);
+			}
+
+			int medoid = 0;
+			double minSum = std::numeric_limits<double>::max();
+			for (int i = 0; i < n; i++)
+			{
+				double sum = 0.0;
+				for (int j = 0; j < n; j++) sum += AngleBetween(q[i], q[j]);
+				if (sum < minSum)
+				{
+					minSum = sum;
+					medoid = i;
+				}
+			}
+
+			std::vector<double> dt(n);
+			std::vector<double> dr(n);
+			for (int i = 0; i < n; i++)
+			{
+				dt[i] = (t[i] - tMedian).norm();
+				dr[i] = AngleBetween(q[i], q[medoid]);
+			}
+
+			const double tThreshold = (std::max)(_minTranslationThreshold, InlierSigmas * MadToSigma * Median(dt));
+			const double rThreshold = (std::max)(_minRotationThreshold, InlierSigmas * MadToSigma * Median(dr));
+
+			// Mean translation and Markley quaternion average of the inliers,
+			// the eigenvector of the largest eigenvalue of sum(q * q^T)
+			Eigen::Vector3d tSum = Eigen::Vector3d::Zero();
+			Eigen::Matrix4d m = Eigen::Matrix4d::Zero();
+			int numInliers = 0;
+			for (int i = 0; i < n; i++)
+			{
+				if (dt[i] > tThreshold || dr[i] > rThreshold)
+				{
+					continue;
+				}
+
+				tSum += t[i];
+				m += q[i].coeffs() * q[i].coeffs().transpose();
+				numInliers++;
+			}
+
+			if (numInliers == 0)
+			{
+				return fused;
+			}
+
+			const Eigen::Vector3d tMean = tSum / numInliers;
+			Eigen::SelfAdjointEigenSolver<Eigen::Matrix4d> eig(m);
+			Eigen::Quaterniond qMean;
+			qMean.coeffs() = eig.eigenvectors().col(3);
+			qMean.normalize();
+
+			// Spread of the inliers around the fused pose
+			double tSq = 0.0;
+			double rSq = 0.0;
+			for (int i = 0; i < n; i++)
+			{
+				if (dt[i] > tThreshold || dr[i] > rThreshold)
+				{
+					continue;
+				}
+
+				tSq += (t[i] - tMean).squaredNorm();
+				const double a = AngleBetween(q[i], qMean);
+				rSq += a * a;
+			}
+
+			fused.tVec = cv::Vec3d(tMean.x(), tMean.y(), tMean.z());
+			fused.rVec = RodriguesFromQuat(qMean);
+			fused.positionSpread = std::sqrt(tSq / numInliers);
+			fused.rotationSpread = std::sqrt(rSq / numInliers);
+			fused.numInliers = numInliers;
+			fused.isValid = true;
+
+			return fused;
+		}
+	}
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <opencv2/core.hpp>
+
+namespace OpenCVRuntimeComponent
+{
+	namespace ArUcoTracking
+	{
+		// Robust average of the poses of one board or marker over the last
+		// frames: median/MAD outlier rejection on translation and rotation,
+		// then the mean translation and the quaternion average of the inliers.
+		struct FusedPose
+		{
+			cv::Vec3d rVec;
+			cv::Vec3d tVec;
+
+			// Rms distance (m) and angle (rad) of the inliers to the fused pose
+			double positionSpread = 0.0;
+			double rotationSpread = 0.0;
+
+			int numSamples = 0;
+			int numInliers = 0;
+			bool isValid = false;
+		};
+
+		// Fixed capacity ring buffer of the poses from consecutive frames.
+		class PoseFusionBuffer
+		{
+		public:
+			static const int Capacity = 32;
+
+			PoseFusionBuffer();
+
+			// Add the pose detected in the given frame
+			void Push(int64_t frameIndex, const cv::Vec3d& rVec, const cv::Vec3d& tVec);
+			void Clear();
+
+			// Fuse the poses detected within the last numFrames frames up to
+			// and including currentFrameIndex.
+			FusedPose Fuse(int64_t currentFrameIndex, int numFrames) const;
+
+			// Lower bounds of the rejection thresholds (m, rad), the MAD based
+			// thresholds are never tighter than these.
+			void SetMinOutlierThresholds(double translation, double rotation);
+
+		private:
+			struct Sample
+			{
+				int64_t frameIndex;
+				cv::Vec3d rVec;
+				cv::Vec3d tVec;
+			};
+
+			std::array<Sample, Capacity> _samples;
+			int _head;
+			int _count;
+
+			double _minTranslationThreshold;
+			double _minRotationThreshold;
+		};
+	}
+}
@@ -0,0 +1,214 @@
+#include "PoseHistory.h"
+
+#include <cmath>
+
+namespace OpenCVRuntimeComponent
+{
+	namespace ArUcoTracking
+	{
+		namespace
+		{
+			// Number of attempts to read a slot that is being written
+			const int MaxReadRetries = 4;
+		}
+
+		PoseHistory::PoseHistory()
+			: _count(0)
+		{
+			for (Slot& slot : _slots)
+			{
+				slot.sequence.store(0, std::memory_order_relaxed);
+				slot.timestamp.store(0, std::memory_order_relaxed);
+				for (std::atomic<float>& v : slot.values)
+				{
+					v.store(0.0f, std::memory_order_relaxed);
+				}
+			}
+		}
+
+		void PoseHistory::Push(
+			int64_t timestamp,
+			const float position[3],
+			const float orientation[4])
+		{
+			const uint64_t count = _count.load(std::memory_order_relaxed);
+			Slot& slot = _slots[count % Capacity];
+
+			// Odd sequence marks the slot as being written
+			const uint32_t sequence = slot.sequence.load(std::memory_order_relaxed);
+			slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_release);
+
+			slot.timestamp.store(timestamp, std::memory_order_relaxed);
+			for (int i = 0; i < 3; i++)
+			{
+				slot.values[i].store(position[i], std::memory_order_relaxed);
+			}
+			for (int i = 0; i < 4; i++)
+			{
+				slot.values[3 + i].store(orientation[i], std::memory_order_relaxed);
+			}
+
+			slot.sequence.store(sequence + 2, std::memory_order_release);
+			_count.store(count + 1, std::memory_order_release);
+		}
+
+		void PoseHistory::Clear()
+		{
+			_count.store(0, std::memory_order_release);
+		}
+
+		bool PoseHistory::Read(
+			const Slot& slot,
+			TimedPoseSample& sample) const
+		{
+			for (int attempt = 0; attempt < MaxReadRetries; attempt++)
+			{
+				const uint32_t before = slot.sequence.load(std::memory_order_acquire);
+				if (before & 1)
+				{
+					continue;
+				}
+
+				sample.timestamp = slot.timestamp.load(std::memory_order_relaxed);
+				for (int i = 0; i < 3; i++)
+				{
+					sample.position[i] = slot.values[i].load(std::memory_order_relaxed);
+				}
+				for (int i = 0; i < 4; i++)
+				{
+					sample.orientation[i] = slot.values[3 + i].load(std::memory_order_relaxed);
+				}
+
+				std::atomic_thread_fence(std::memory_order_acquire);
+				if (slot.sequence.load(std::memory_order_relaxed) == before)
+				{
+					sample.isValid = true;
+					return true;
+				}
+			}
+
+			return false;
+		}
+
+		TimedPoseSample PoseHistory::Latest() const
+		{
+			TimedPoseSample sample;
+			const uint64_t count = _count.load(std::memory_order_acquire);
+			if (count > 0)
+			{
+				Read(_slots[(count - 1) % Capacity], sample);
+			}
+			return sample;
+		}
+
+		TimedPoseSample PoseHistory::Query(
+			int64_t timestamp,
+			int64_t maxGap,
+			int64_t maxExtrapolation) const
+		{
+			TimedPoseSample before;
+			TimedPoseSample after;
+
+			// Walk from the newest sample back until the query time is
+			// bracketed. The oldest slot may be overwritten meanwhile,
+			// the sequence check discards it in that case.
+			const uint64_t count = _count.load(std::memory_order_acquire);
+			const uint64_t available = count < (uint64_t)Capacity ? count : (uint64_t)Capacity;
+
+			for (uint64_t i = 0; i < available; i++)
+			{
+				TimedPoseSample sample;
+				if (!Read(_slots[(count - 1 - i) % Capacity], sample))
+				{
+					continue;
+				}
+
+				if (sample.timestamp >= timestamp)
+				{
+					after = sample;
+				}
+				else
+				{
+					before = sample;
+					break;
+				}
+
+				if (sample.timestamp == timestamp)
+				{
+					return sample;
+				}
+			}
+
+			if (before.isValid && after.isValid)
+			{
+				if (after.timestamp - before.timestamp > maxGap)
+				{
+					return TimedPoseSample();
+				}
+				return InterpolatePose(before, after, timestamp);
+			}
+
+			// Hold the newest sample briefly past the end of the history
+			if (before.isValid && !after.isValid &&
+				timestamp - before.timestamp <= maxExtrapolation)
+			{
+				before.timestamp = timestamp;
+				return before;
+			}
+
+			return TimedPoseSample();
+		}
+
+		TimedPoseSample InterpolatePose(
+			const TimedPoseSample& a,
+			const TimedPoseSample& b,
+			int64_t timestamp)
+		{
+			TimedPoseSample result;
+			result.timestamp = timestamp;
+			result.isValid = true;
+
+			const int64_t span = b.timestamp - a.timestamp;
+			const float t = span > 0 ? (float)((double)(timestamp - a.timestamp) / (double)span) : 0.0f;
+
+			for (int i = 0; i < 3; i++)
+			{
+				result.position[i] = a.position[i] + t * (b.position[i] - a.position[i]);
+			}
+
+			// Slerp along the shorter arc
+			float dot = 0.0f;
+			for (int i = 0; i < 4; i++)
+			{
+				dot += a.orientation[i] * b.orientation[i];
+			}
+			const float sign = dot < 0.0f ? -1.0f : 1.0f;
+			dot *= sign;
+
+			float wa = 1.0f - t;
+			float wb = t * sign;
+			if (dot < 0.9995f)
+			{
+				const float theta = std::acos(dot);
+				const float sinTheta = std::sin(theta);
+				wa = std::sin((1.0f - t) * theta) / sinTheta;
+				wb = sign * std::sin(t * theta) / sinTheta;
+			}
+
+			float norm = 0.0f;
+			for (int i = 0; i < 4; i++)
+			{
+				result.orientation[i] = wa * a.orientation[i] + wb * b.orientation[i];
+				norm += result.orientation[i] * result.orientation[i];
+			}
+			norm = std::sqrt(norm);
+			for (int i = 0; i < 4; i++)
+			{
+				result.orientation[i] /= norm;
+			}
+
+			return result;
+		}
+	}
+}
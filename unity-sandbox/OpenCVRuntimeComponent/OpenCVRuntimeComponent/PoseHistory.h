@@ -0,0 +1,63 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace OpenCVRuntimeComponent
+{
+	namespace ArUcoTracking
+	{
+		// Pose sample keyed by capture time (100 ns ticks, the unit of
+		// the system relative time of media frames).
+		struct TimedPoseSample
+		{
+			int64_t timestamp = 0;
+			float position[3] = { 0.0f, 0.0f, 0.0f };
+			float orientation[4] = { 0.0f, 0.0f, 0.0f, 1.0f }; // x, y, z, w
+			bool isValid = false;
+		};
+
+		// Fixed capacity history of poses indexed by timestamp. Lock-free:
+		// a single producer pushes samples while any number of readers query
+		// interpolated poses. Each slot is guarded by a sequence counter so
+		// readers retry instead of reading a slot that is being overwritten.
+		class PoseHistory
+		{
+		public:
+			static const int Capacity = 128;
+
+			PoseHistory();
+
+			// Single producer. Samples are expected in increasing time order.
+			void Push(int64_t timestamp, const float position[3], const float orientation[4]);
+			void Clear();
+
+			// Pose at an arbitrary time: position is linearly interpolated and
+			// orientation spherically interpolated between the two samples
+			// around the query time. Queries past the newest sample are held
+			// at the newest sample for up to maxExtrapolation ticks; samples
+			// further than maxGap ticks apart are not interpolated.
+			TimedPoseSample Query(int64_t timestamp, int64_t maxGap, int64_t maxExtrapolation) const;
+
+			// Newest sample in the history
+			TimedPoseSample Latest() const;
+
+		private:
+			struct Slot
+			{
+				std::atomic<uint32_t> sequence;
+				std::atomic<int64_t> timestamp;
+				std::atomic<float> values[7];
+			};
+
+			std::array<Slot, Capacity> _slots;
+			std::atomic<uint64_t> _count;
+
+			// Consistent copy of a slot, false if it is being written
+			bool Read(const Slot& slot, TimedPoseSample& sample) const;
+		};
+
+		TimedPoseSample InterpolatePose(const TimedPoseSample& a, const TimedPoseSample& b, int64_t timestamp);
+	}
+}
@@ -0,0 +1,98 @@
+#include "PoseQuality.h"
+
+#include <cmath>
+#include <opencv2/calib3d.hpp>
+#include <opencv2/imgproc.hpp>
+
+namespace OpenCVRuntimeComponent
+{
+	namespace ArUcoTracking
+	{
+		namespace
+		{
+			// Number of pose parameters
+			const int PoseDof = 6;
+		}
+
+		PoseQuality ComputePoseQuality(
+			const std::vector<cv::Point3f>& objectPoints,
+			const std::vector<cv::Point2f>& imagePoints,
+			const cv::Mat& cameraMatrix,
+			const cv::Mat& distortionCoefficients,
+			const cv::Vec3d& rVec,
+			const cv::Vec3d& tVec)
+		{
+			PoseQuality quality;
+
+			const int n = (int)imagePoints.size();
+			if (n == 0 || objectPoints.size() != imagePoints.size())
+			{
+				return quality;
+			}
+
+			quality.numCorners = n;
+			quality.numMarkers = n / 4;
+			for (int m = 0; m + 4 <= n; m += 4)
+			{
+				const std::vector<cv::Point2f> marker(imagePoints.begin() + m, imagePoints.begin() + m + 4);
+				quality.markerArea += cv::contourArea(marker);
+			}
+
+			// Residuals and the jacobian of the projection with respect to
+			// the pose, the first six columns of the projectPoints jacobian
+			std::vector<cv::Point2f> projected;
+			cv::Mat jacobian;
+			cv::projectPoints(objectPoints, rVec, tVec, cameraMatrix, distortionCoefficients, projected, jacobian);
+
+			double sumSq = 0.0;
+			for (int i = 0; i < n; i++)
+			{
+				const cv::Point2f d = imagePoints[i] - projected[i];
+				sumSq += d.x * d.x + d.y * d.y;
+			}
+			quality.reprojectionRms = std::sqrt(sumSq / n);
+			quality.isValid = true;
+
+			const cv::Mat j = jacobian.colRange(0, PoseDof);
+			const cv::Mat jtj = j.t() * j;
+			cv::Mat jtjInv;
+			if (cv::invert(jtj, jtjInv, cv::DECOMP_CHOLESKY) == 0)
+			{
+				return quality;
+			}
+
+			// Residual variance per coordinate, with the degrees of freedom
+			// left after fitting the pose
+			const int dof = 2 * n - PoseDof;
+			const double variance = sumSq / (dof > 0 ? dof : 2 * n);
+
+			quality.covariance = cv::Matx66d(jtjInv) * variance;
+			quality.hasCovariance = true;
+
+			return quality;
+		}
+
+		PoseQuality ComputeBoardPoseQuality(
+			const cv::Ptr<cv::aruco::Board>& board,
+			const std::vector<std::vector<cv::Point2f>>& markers,
+			const std::vector<int32_t>& markerIds,
+			const cv::Mat& cameraMatrix,
+			const cv::Mat& distortionCoefficients,
+			const cv::Vec3d& rVec,
+			const cv::Vec3d& tVec)
+		{
+			// Only the markers that belong to the board
+			std::vector<cv::Point3f> objectPoints;
+			std::vector<cv::Point2f> imagePoints;
+			cv::aruco::getBoardObjectAndImagePoints(board, markers, markerIds, objectPoints, imagePoints);
+
+			return ComputePoseQuality(
+				objectPoints,
+				imagePoints,
+				cameraMatrix,
+				distortionCoefficients,
+				rVec,
+				tVec);
+		}
+	}
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <vector>
+#include <opencv2/core.hpp>
+#include <opencv2/aruco.hpp>
+
+namespace OpenCVRuntimeComponent
+{
+	namespace ArUcoTracking
+	{
+		// Quality of a solved pose from the correspondences it was solved
+		// with. The covariance is the first order estimate
+		// sigma^2 * (J^T J)^-1 of the pose parameters (rx, ry, rz, tx, ty,
+		// tz), with J the jacobian of the projected points and sigma^2 the
+		// residual variance.
+		struct PoseQuality
+		{
+			double reprojectionRms = 0.0; // pixels
+			int numMarkers = 0;
+			int numCorners = 0;
+			double markerArea = 0.0;      // pixels^2, all markers
+			cv::Matx66d covariance = cv::Matx66d::zeros();
+			bool hasCovariance = false;
+			bool isValid = false;
+		};
+
+		// Correspondences are four corners per marker
+		PoseQuality ComputePoseQuality(
+			const std::vector<cv::Point3f>& objectPoints,
+			const std::vector<cv::Point2f>& imagePoints,
+			const cv::Mat& cameraMatrix,
+			const cv::Mat& distortionCoefficients,
+			const cv::Vec3d& rVec,
+			const cv::Vec3d& tVec);
+
+		// Quality of a board pose from the detected markers of the board
+		PoseQuality ComputeBoardPoseQuality(
+			const cv::Ptr<cv::aruco::Board>& board,
+			const std::vector<std::vector<cv::Point2f>>& markers,
+			const std::vector<int32_t>& markerIds,
+			const cv::Mat& cameraMatrix,
+			const cv::Mat& distortionCoefficients,
+			const cv::Vec3d& rVec,
+			const cv::Vec3d& tVec);
+	}
+}
@@ -0,0 +1,36 @@
+#include "pch.h"
+#include "PoseQualityMetrics.h"
+
+using namespace OpenCVRuntimeComponent;
+
+ArUcoTracking::PoseQualityMetrics::PoseQualityMetrics(
+	float reprojectionError,
+	int numMarkers,
+	int numCorners,
+	float markerArea,
+	IVector<float>^ covariance,
+	bool isValid)
+{
+	ReprojectionError = reprojectionError;
+	NumMarkers = numMarkers;
+	NumCorners = numCorners;
+	MarkerArea = markerArea;
+	Covariance = covariance;
+	IsValid = isValid;
+}
+
+float3 ArUcoTracking::PoseQualityMetrics::PositionStdDev::get()
+{
+	return float3(
+		sqrtf(Covariance->GetAt(3 * 6 + 3)),
+		sqrtf(Covariance->GetAt(4 * 6 + 4)),
+		sqrtf(Covariance->GetAt(5 * 6 + 5)));
+}
+
+float3 ArUcoTracking::PoseQualityMetrics::RotationStdDev::get()
+{
+	return float3(
+		sqrtf(Covariance->GetAt(0 * 6 + 0)),
+		sqrtf(Covariance->GetAt(1 * 6 + 1)),
+		sqrtf(Covariance->GetAt(2 * 6 + 2)));
+}
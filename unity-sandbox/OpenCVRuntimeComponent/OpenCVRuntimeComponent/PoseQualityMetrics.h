@@ -0,0 +1,39 @@
+#pragma once
+
+using namespace Windows::Foundation::Collections;
+using namespace Windows::Foundation::Numerics;
+
+namespace OpenCVRuntimeComponent
+{
+	namespace ArUcoTracking
+	{
+		public ref class PoseQualityMetrics sealed
+		{
+		public:
+			PoseQualityMetrics(
+				_In_ float reprojectionError,
+				_In_ int numMarkers,
+				_In_ int numCorners,
+				_In_ float markerArea,
+				_In_ IVector<float>^ covariance,
+				_In_ bool isValid);
+
+			// Rms reprojection error (pixels) of the corners the pose was
+			// solved with, and their total marker area (pixels^2)
+			property float ReprojectionError;
+			property int NumMarkers;
+			property int NumCorners;
+			property float MarkerArea;
+
+			// 6x6 row-major covariance of (rx, ry, rz, tx, ty, tz), all
+			// zero if the pose is not constrained enough to compute it
+			property IVector<float>^ Covariance;
+
+			// Standard deviation of the position (m) and rotation (rad)
+			property float3 PositionStdDev { float3 get(); }
+			property float3 RotationStdDev { float3 get(); }
+
+			property bool IsValid;
+		};
+	}
+}
@@ -0,0 +1,89 @@
+#include "pch.h"
+#include "ProjectionCalibration.h"
+
+using namespace OpenCVRuntimeComponent;
+
+HMDCalibration::ProjectionCalibration::ProjectionCalibration()
+	: _solver(new DltProjectionSolver())
+{
+}
+
+float HMDCalibration::ProjectionCalibration::AddCorrespondence(
+	float3 headRelativeMarkerPoint3D,
+	float2 screenPoint2D)
+{
+	const bool isAdded = _solver->Add(
+		Eigen::Vector3d(headRelativeMarkerPoint3D.x, headRelativeMarkerPoint3D.y, headRelativeMarkerPoint3D.z),
+		Eigen::Vector2d(screenPoint2D.x, screenPoint2D.y));
+
+	if (!isAdded)
+	{
+		dbg::trace(L"ProjectionCalibration::AddCorrespondence: correspondence buffer is full.");
+	}
+
+	if (!_solver->IsSolved())
+	{
+		return -1.0f;
+	}
+
+	dbg::trace(
+		L"ProjectionCalibration::AddCorrespondence: %i points, rms error: %f px, last residual: %f px",
+		_solver->Count(), _solver->RmsError(), _solver->LastResidual());
+
+	return (float)_solver->RmsError();
+}
+
+void HMDCalibration::ProjectionCalibration::Reset()
+{
+	_solver->Reset();
+}
+
+float2 HMDCalibration::ProjectionCalibration::Project(
+	float3 headRelativePoint3D)
+{
+	if (!_solver->IsSolved())
+	{
+		return float2::zero();
+	}
+
+	const Eigen::Vector2d x = _solver->Project(
+		Eigen::Vector3d(headRelativePoint3D.x, headRelativePoint3D.y, headRelativePoint3D.z));
+
+	return float2((float)x.x(), (float)x.y());
+}
+
+int HMDCalibration::ProjectionCalibration::Count::get()
+{
+	return _solver->Count();
+}
+
+int HMDCalibration::ProjectionCalibration::MinCorrespondences::get()
+{
+	return DltProjectionSolver::MinCorrespondences;
+}
+
+bool HMDCalibration::ProjectionCalibration::IsSolved::get()
+{
+	return _solver->IsSolved();
+}
+
+float HMDCalibration::ProjectionCalibration::RmsError::get()
+{
+	return (float)_solver->RmsError();
+}
+
+float HMDCalibration::ProjectionCalibration::LastResidual::get()
+{
+	return (float)_solver->LastResidual();
+}
+
+float4x4 HMDCalibration::ProjectionCalibration::Projection::get()
+{
+	const DltProjectionSolver::Projection& p = _solver->P();
+
+	return float4x4(
+		(float)p(0, 0), (float)p(0, 1), (float)p(0, 2), (float)p(0, 3),
+		(float)p(1, 0), (float)p(1, 1), (float)p(1, 2), (float)p(1, 3),
+		(float)p(2, 0), (float)p(2, 1), (float)p(2, 2), (float)p(2, 3),
+		0, 0, 0, 0);
+}
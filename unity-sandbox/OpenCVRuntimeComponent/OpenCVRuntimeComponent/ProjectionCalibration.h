@@ -0,0 +1,49 @@
+#pragma once
+#include "DltProjectionSolver.h"
+
+using namespace Windows::Foundation::Collections;
+using namespace Windows::Foundation::Numerics;
+
+namespace OpenCVRuntimeComponent
+{
+	namespace HMDCalibration
+	{
+		// 3D-2D display calibration for one eye. Head-relative 3D marker
+		// points are paired with the 2D screen location of the reticle they
+		// were aligned to, and the full 3x4 projection is updated as each
+		// correspondence arrives.
+		public ref class ProjectionCalibration sealed
+		{
+		public:
+			ProjectionCalibration();
+
+			// Add a correspondence, returns the rms reprojection error
+			// (pixels) of the updated solution, or -1 while fewer than
+			// MinCorrespondences points have been collected.
+			float AddCorrespondence(
+				_In_ float3 headRelativeMarkerPoint3D,
+				_In_ float2 screenPoint2D);
+
+			void Reset();
+
+			// Project a head-relative 3D point with the current solution
+			float2 Project(_In_ float3 headRelativePoint3D);
+
+			property int Count { int get(); }
+			property int MinCorrespondences { int get(); }
+			property bool IsSolved { bool get(); }
+
+			// Residuals in pixels of all points and of the newest point
+			property float RmsError { float get(); }
+			property float LastResidual { float get(); }
+
+			// The 3x4 projection is held in m11 ... m34, the last
+			// row is zero. Scaled to unit frobenius norm.
+			property float4x4 Projection { float4x4 get(); }
+
+		private:
+			// Allocated once, updates do not allocate
+			std::unique_ptr<DltProjectionSolver> _solver;
+		};
+	}
+}
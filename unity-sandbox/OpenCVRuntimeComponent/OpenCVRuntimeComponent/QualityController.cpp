@@ -0,0 +1,176 @@
+#include "QualityController.h"
+
+#include <algorithm>
+
+namespace OpenCVRuntimeComponent
+{
+	namespace ArUcoTracking
+	{
+		namespace
+		{
+			// cv::aruco::CORNER_REFINE_NONE and CORNER_REFINE_SUBPIX
+			const int CornerRefineNone = 0;
+			const int CornerRefineSubpix = 1;
+
+			// Level 0 is DetectorParameters::create() with subpixel corner
+			// refinement, later levels try fewer threshold windows, only
+			// search around the last board, downscale and skip refinement
+			const QualitySettings Levels[QualityController::NumLevels] =
+			{
+				{ 1.0, 3, 23, 10, CornerRefineSubpix, -1.0 },
+				{ 1.0, 3, 13, 10, CornerRefineSubpix, 0.5 },
+				{ 0.75, 3, 13, 10, CornerRefineNone, 0.5 },
+				{ 0.5, 5, 5, 10, CornerRefineNone, 0.25 },
+			};
+
+			// Smoothing factor of the moving averages of the timings
+			const double Smoothing = 0.2;
+
+			// Frames over the budget before degrading, and frames with
+			// headroom before restoring quality
+			const int DegradeFrames = 3;
+			const int RestoreFrames = 30;
+
+			// Fraction of the budget the predicted frame time must stay
+			// under to restore a higher quality level
+			const double RestoreMargin = 0.8;
+		}
+
+		double DetectionCost(const QualitySettings& settings)
+		{
+			// Each threshold window is a full pass over the (scaled) image
+			const int windows = 1 +
+				(settings.adaptiveThreshWinSizeMax - settings.adaptiveThreshWinSizeMin) /
+				settings.adaptiveThreshWinSizeStep;
+			const QualitySettings& full = Levels[0];
+			const int fullWindows = 1 +
+				(full.adaptiveThreshWinSizeMax - full.adaptiveThreshWinSizeMin) /
+				full.adaptiveThreshWinSizeStep;
+
+			return settings.processingScale * settings.processingScale * windows / fullWindows;
+		}
+
+		const QualitySettings& QualityLevelSettings(int level)
+		{
+			return Levels[(std::min)((std::max)(level, 0), QualityController::NumLevels - 1)];
+		}
+
+		QualityController::QualityController()
+			: _isEnabled(false),
+			_budgetMs(33.0),
+			_slowdown(1.0),
+			_isHeld(false),
+			_heldSettings(Levels[0])
+		{
+			Reset();
+		}
+
+		void QualityController::Configure(
+			bool isEnabled,
+			double budgetMs)
+		{
+			_isEnabled = isEnabled;
+			_budgetMs = budgetMs;
+			_isHeld = false;
+			Reset();
+		}
+
+		void QualityController::Hold(const QualitySettings& settings)
+		{
+			_heldSettings = settings;
+			_isHeld = true;
+			Reset();
+		}
+
+		void QualityController::SetInjectedSlowdown(double factor)
+		{
+			_slowdown = factor;
+		}
+
+		void QualityController::Reset()
+		{
+			_level = 0;
+			_hasAverage = false;
+			_averageFrameMs = 0.0;
+			_averageFixedMs = 0.0;
+			_averageDetectMs = 0.0;
+			_framesOverBudget = 0;
+			_framesUnderBudget = 0;
+		}
+
+		const QualitySettings& QualityController::Settings() const
+		{
+			return _isHeld ? _heldSettings : Levels[_level];
+		}
+
+		void QualityController::Report(const StageTimings& timings)
+		{
+			const double fixedMs = _slowdown * (timings.convertMs + timings.poseMs);
+			const double detectMs = _slowdown * timings.detectMs;
+
+			if (!_hasAverage)
+			{
+				_averageFixedMs = fixedMs;
+				_averageDetectMs = detectMs;
+				_hasAverage = true;
+			}
+			else
+			{
+				_averageFixedMs += Smoothing * (fixedMs - _averageFixedMs);
+				_averageDetectMs += Smoothing * (detectMs - _averageDetectMs);
+			}
+			_averageFrameMs = _averageFixedMs + _averageDetectMs;
+
+			if (!_isEnabled || _isHeld)
+			{
+				return;
+			}
+
+			// Degrade quickly when falling behind
+			if (_averageFrameMs > _budgetMs)
+			{
+				_framesUnderBudget = 0;
+				if (++_framesOverBudget >= DegradeFrames && _level < NumLevels - 1)
+				{
+					SetLevel(_level + 1);
+				}
+				return;
+			}
+			_framesOverBudget = 0;
+
+			// Restore slowly, and only if the detection stage scaled to the
+			// cost of the higher level is predicted to fit in the budget
+			if (_level == 0)
+			{
+				return;
+			}
+
+			const double predictedMs = _averageFixedMs + _averageDetectMs *
+				DetectionCost(Levels[_level - 1]) / DetectionCost(Levels[_level]);
+
+			if (predictedMs < RestoreMargin * _budgetMs)
+			{
+				if (++_framesUnderBudget >= RestoreFrames)
+				{
+					SetLevel(_level - 1);
+				}
+			}
+			else
+			{
+				_framesUnderBudget = 0;
+			}
+		}
+
+		void QualityController::SetLevel(int level)
+		{
+			// Rescale the detection average to the expected cost of the
+			// new level so the next decision does not act on stale timings
+			_averageDetectMs *= DetectionCost(Levels[level]) / DetectionCost(Levels[_level]);
+			_averageFrameMs = _averageFixedMs + _averageDetectMs;
+
+			_level = level;
+			_framesOverBudget = 0;
+			_framesUnderBudget = 0;
+		}
+	}
+}
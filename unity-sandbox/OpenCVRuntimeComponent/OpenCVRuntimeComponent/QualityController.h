@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstdint>
+
+namespace OpenCVRuntimeComponent
+{
+	namespace ArUcoTracking
+	{
+		// Measured duration (milliseconds) of the stages of one frame
+		struct StageTimings
+		{
+			double convertMs = 0.0; // wrap and gray conversion
+			double detectMs = 0.0;  // marker detection or corner tracking
+			double poseMs = 0.0;    // board pose estimation
+
+			double Total() const { return convertMs + detectMs + poseMs; }
+		};
+
+		// Detection settings of one quality level
+		struct QualitySettings
+		{
+			// Scale of the image marker detection runs on
+			double processingScale;
+
+			// Adaptive threshold window sizes tried by detectMarkers
+			int adaptiveThreshWinSizeMin;
+			int adaptiveThreshWinSizeMax;
+			int adaptiveThreshWinSizeStep;
+
+			// cv::aruco::CornerRefineMethod
+			int cornerRefinementMethod;
+
+			// Detection is restricted to the last board region padded by
+			// this fraction of its size, full frame if negative
+			double roiPadding;
+		};
+
+		// Keeps the per-frame processing time within a latency budget by
+		// stepping through a ladder of detection quality levels. Level 0 is
+		// full quality, higher levels trade
+		// accuracy for time. The controller only depends on the reported
+		// timings, so replaying a capture with the same (or uniformly
+		// slowed down) timings reproduces the same level changes.
+		class QualityController
+		{
+		public:
+			static const int NumLevels = 4;
+
+			QualityController();
+
+			// Also releases a hold
+			void Configure(bool isEnabled, double budgetMs);
+
+			// Detect with fixed settings instead of a level of the ladder,
+			// timings are still averaged but the level no longer changes
+			void Hold(const QualitySettings& settings);
+
+			// Scale applied to all reported timings, used to emulate a
+			// throttled device when replaying captures
+			void SetInjectedSlowdown(double factor);
+
+			// Record the timings of a processed frame and update the level
+			void Report(const StageTimings& timings);
+
+			void Reset();
+
+			bool IsEnabled() const { return _isEnabled || _isHeld; }
+			bool IsHeld() const { return _isHeld; }
+			int Level() const { return _level; }
+			const QualitySettings& Settings() const;
+
+			// Smoothed frame time (milliseconds, slowdown applied)
+			double AverageFrameMs() const { return _averageFrameMs; }
+
+		private:
+			bool _isEnabled;
+			double _budgetMs;
+			double _slowdown;
+
+			bool _isHeld;
+			QualitySettings _heldSettings;
+
+			int _level;
+			bool _hasAverage;
+			double _averageFrameMs;
+			double _averageFixedMs;
+			double _averageDetectMs;
+			int _framesOverBudget;
+			int _framesUnderBudget;
+
+			void SetLevel(int level);
+		};
+
+		// Relative cost of the detection stage at a level, compared to level 0
+		double DetectionCost(const QualitySettings& settings);
+
+		// Settings of a quality level, clamped to the valid levels
+		const QualitySettings& QualityLevelSettings(int level);
+	}
+}
@@ -0,0 +1,416 @@
+#include "SyntheticFrames.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <opencv2/calib3d.hpp>
+#include <opencv2/imgproc.hpp>
+
+namespace OpenCVRuntimeComponent
+{
+	namespace ArUcoTracking
+	{
+		namespace
+		{
+			// Key poses of a trajectory are this many frames apart
+			const int TrajectoryKeyInterval = 30;
+
+			// Coarsest level of the printed board pyramid
+			const int MaxPrintedLevel = 6;
+
+			cv::Matx33d RotationOf(const cv::Vec3d& rVec)
+			{
+				cv::Matx33d rotation;
+				cv::Rodrigues(rVec, rotation);
+				return rotation;
+			}
+
+			cv::Vec3d RotationVectorOf(const cv::Matx33d& rotation)
+			{
+				cv::Vec3d rVec;
+				cv::Rodrigues(rotation, rVec);
+				return rVec;
+			}
+
+			cv::Point3d BoardCenter(const cv::Ptr<cv::aruco::Board>& board)
+			{
+				cv::Point3d sum;
+				int count = 0;
+				for (const auto& corners : board->objPoints)
+				{
+					for (const auto& corner : corners)
+					{
+						sum += cv::Point3d(corner);
+						count++;
+					}
+				}
+				return count > 0 ? sum * (1.0 / count) : sum;
+			}
+
+			SyntheticPose SamplePose(
+				const CameraIntrinsics& camera,
+				const SyntheticPoseRange& range,
+				const cv::Point3d& boardCenter,
+				cv::RNG& rng)
+			{
+				const cv::Matx33d k = camera.cameraMatrix;
+				const double degrees = CV_PI / 180.0;
+
+				// Board center along the ray of a point near the image center
+				const double u = k(0, 2) + rng.uniform(-range.maxOffset, range.maxOffset) * 0.5 * camera.imageSize.width;
+				const double v = k(1, 2) + rng.uniform(-range.maxOffset, range.maxOffset) * 0.5 * camera.imageSize.height;
+				const cv::Vec3d ray = cv::normalize(cv::Vec3d((u - k(0, 2)) / k(0, 0), (v - k(1, 2)) / k(1, 1), 1.0));
+				const cv::Vec3d center = ray * rng.uniform(range.minDistance, range.maxDistance);
+
+				// Board facing the camera (board y up is camera y down),
+				// rolled in plane then tilted about an axis in the plane
+				const double roll = rng.uniform(-range.maxRoll, range.maxRoll) * degrees;
+				const double tilt = rng.uniform(0.0, range.maxTilt) * degrees;
+				const double tiltAxis = rng.uniform(0.0, 2.0 * CV_PI);
+
+				const cv::Matx33d facing = RotationOf(cv::Vec3d(CV_PI, 0.0, 0.0));
+				const cv::Matx33d rotation =
+					facing *
+					RotationOf(cv::Vec3d(std::cos(tiltAxis), std::sin(tiltAxis), 0.0) * tilt) *
+					RotationOf(cv::Vec3d(0.0, 0.0, roll));
+
+				SyntheticPose pose;
+				pose.rVec = RotationVectorOf(rotation);
+				pose.tVec = center - rotation * cv::Vec3d(boardCenter.x, boardCenter.y, boardCenter.z);
+				return pose;
+			}
+
+			// Pose at fraction alpha from one pose to the next, rotation
+			// along the shortest arc
+			SyntheticPose Interpolate(
+				const SyntheticPose& from,
+				const SyntheticPose& to,
+				double alpha)
+			{
+				const cv::Matx33d r0 = RotationOf(from.rVec);
+				const cv::Matx33d r1 = RotationOf(to.rVec);
+
+				SyntheticPose pose;
+				pose.rVec = RotationVectorOf(r0 * RotationOf(RotationVectorOf(r0.t() * r1) * alpha));
+				pose.tVec = from.tVec * (1.0 - alpha) + to.tVec * alpha;
+				return pose;
+			}
+		}
+
+		std::vector<SyntheticPose> SampleSyntheticPoses(
+			const CameraIntrinsics& camera,
+			const cv::Ptr<cv::aruco::Board>& board,
+			const SyntheticPoseRange& range,
+			int count,
+			uint64_t seed)
+		{
+			const cv::Point3d origin = BoardCenter(board);
+			cv::RNG rng(seed);
+			std::vector<SyntheticPose> poses;
+			poses.reserve((size_t)(std::max)(count, 0));
+
+			if (!range.isTrajectory)
+			{
+				for (int i = 0; i < count; i++)
+				{
+					poses.push_back(SamplePose(camera, range, origin, rng));
+				}
+				return poses;
+			}
+
+			SyntheticPose from = SamplePose(camera, range, origin, rng);
+			SyntheticPose to = SamplePose(camera, range, origin, rng);
+			for (int i = 0; i < count; i++)
+			{
+				const int step = i % TrajectoryKeyInterval;
+				if (i > 0 && step == 0)
+				{
+					from = to;
+					to = SamplePose(camera, range, origin, rng);
+				}
+
+				// Smoothstep, the motion eases in and out of each key pose
+				const double x = (double)step / TrajectoryKeyInterval;
+				poses.push_back(Interpolate(from, to, x * x * (3.0 - 2.0 * x)));
+			}
+
+			return poses;
+		}
+
+		cv::Ptr<cv::aruco::Board> CreateSingleMarkerBoard(
+			const cv::Ptr<cv::aruco::Dictionary>& dictionary,
+			int markerId,
+			float markerLength)
+		{
+			const float h = 0.5f * markerLength;
+			const std::vector<std::vector<cv::Point3f>> objPoints = { {
+				cv::Point3f(-h, h, 0.0f),
+				cv::Point3f(h, h, 0.0f),
+				cv::Point3f(h, -h, 0.0f),
+				cv::Point3f(-h, -h, 0.0f) } };
+
+			return cv::aruco::Board::create(objPoints, dictionary, std::vector<int>{ markerId });
+		}
+
+		SyntheticFrameGenerator::SyntheticFrameGenerator(
+			const CameraIntrinsics& camera,
+			const cv::Ptr<cv::aruco::Board>& board,
+			const SyntheticFrameSettings& settings)
+			: _camera(camera),
+			_board(board),
+			_settings(settings)
+		{
+			_camera.cameraMatrix.convertTo(_camera.cameraMatrix, CV_64F);
+			_camera.distortionCoefficients.convertTo(_camera.distortionCoefficients, CV_64F);
+
+			// Undistorted normalized coordinates of every pixel center
+			std::vector<cv::Point2f> pixels;
+			pixels.reserve((size_t)_camera.imageSize.area());
+			for (int y = 0; y < _camera.imageSize.height; y++)
+			{
+				for (int x = 0; x < _camera.imageSize.width; x++)
+				{
+					pixels.push_back(cv::Point2f((float)x, (float)y));
+				}
+			}
+
+			std::vector<cv::Point2f> normalized;
+			cv::undistortPoints(pixels, normalized, _camera.cameraMatrix, _camera.distortionCoefficients);
+			_normalizedGrid = cv::Mat(normalized, true).reshape(2, _camera.imageSize.height);
+
+			PrintBoard();
+		}
+
+		void SyntheticFrameGenerator::PrintBoard()
+		{
+			float minX = FLT_MAX, maxX = -FLT_MAX, minY = FLT_MAX, maxY = -FLT_MAX;
+			for (const auto& corners : _board->objPoints)
+			{
+				for (const auto& corner : corners)
+				{
+					minX = (std::min)(minX, corner.x);
+					maxX = (std::max)(maxX, corner.x);
+					minY = (std::min)(minY, corner.y);
+					maxY = (std::max)(maxY, corner.y);
+				}
+			}
+
+			const double ppm = _settings.pixelsPerMeter;
+			const double margin = _settings.paperMargin;
+			_printedOrigin = cv::Point2d(minX - margin, maxY + margin);
+			cv::Mat printed(
+				(int)std::ceil((maxY - minY + 2.0 * margin) * ppm),
+				(int)std::ceil((maxX - minX + 2.0 * margin) * ppm),
+				CV_8U,
+				cv::Scalar(255));
+
+			// Markers are drawn one pixel per bit then scaled into place
+			// with nearest sampling, the marker edges stay at their exact
+			// board coordinates whatever the print resolution
+			const int bitsSide = _board->dictionary->markerSize + 2;
+			for (size_t i = 0; i < _board->objPoints.size(); i++)
+			{
+				const cv::Point3f& topLeft = _board->objPoints[i][0];
+				const double side = cv::norm(_board->objPoints[i][1] - topLeft);
+				const double scale = side * ppm / bitsSide;
+
+				cv::Mat bits;
+				cv::aruco::drawMarker(_board->dictionary, _board->ids[i], bitsSide, bits, 1);
+
+				const cv::Matx23d toPrinted(
+					scale, 0.0, (topLeft.x - _printedOrigin.x) * ppm + 0.5 * scale - 0.5,
+					0.0, scale, (_printedOrigin.y - topLeft.y) * ppm + 0.5 * scale - 0.5);
+				cv::warpAffine(
+					bits,
+					printed,
+					toPrinted,
+					printed.size(),
+					cv::INTER_NEAREST,
+					cv::BORDER_TRANSPARENT);
+			}
+
+			// Pixel i of a level is centered on pixel 2i of the level below
+			_printedLevels.assign(1, printed);
+			for (int level = 1; level <= MaxPrintedLevel; level++)
+			{
+				cv::Mat down;
+				cv::pyrDown(_printedLevels.back(), down);
+				_printedLevels.push_back(down);
+			}
+		}
+
+		void SyntheticFrameGenerator::Render(
+			const SyntheticPose& pose,
+			int64_t frameIndex,
+			SyntheticFrame& frame) const
+		{
+			frame.frameIndex = frameIndex;
+			frame.pose = pose;
+			frame.visibleMarkerIds.clear();
+
+			// Homography from normalized image coordinates to the board
+			// plane, w is the inverse depth of the plane point
+			const cv::Matx33d r = RotationOf(pose.rVec);
+			const cv::Matx33d toImage(
+				r(0, 0), r(0, 1), pose.tVec[0],
+				r(1, 0), r(1, 1), pose.tVec[1],
+				r(2, 0), r(2, 1), pose.tVec[2]);
+			const cv::Matx33d toBoard = toImage.inv();
+
+			// Sample the print at the level of a pyramid closest to the
+			// image resolution of the board, to avoid aliasing
+			const double depth = (std::max)(pose.tVec[2], 1e-3);
+			const double imagePixelsPerMeter = _camera.cameraMatrix.at<double>(0, 0) / depth;
+			int level = 0;
+			double levelPixelsPerMeter = _settings.pixelsPerMeter;
+			while (levelPixelsPerMeter > 2.0 * imagePixelsPerMeter && level < MaxPrintedLevel)
+			{
+				levelPixelsPerMeter *= 0.5;
+				level++;
+			}
+			const cv::Mat& printed = _printedLevels[level];
+
+			const cv::Size size = _camera.imageSize;
+			cv::Mat mapX(size, CV_32F), mapY(size, CV_32F);
+			const double ppm = _settings.pixelsPerMeter;
+			const double levelScale = 1.0 / (double)(1 << level);
+
+			for (int y = 0; y < size.height; y++)
+			{
+				const cv::Point2f* grid = _normalizedGrid.ptr<cv::Point2f>(y);
+				float* mx = mapX.ptr<float>(y);
+				float* my = mapY.ptr<float>(y);
+
+				for (int x = 0; x < size.width; x++)
+				{
+					const double xn = grid[x].x, yn = grid[x].y;
+					const double w = toBoard(2, 0) * xn + toBoard(2, 1) * yn + toBoard(2, 2);
+					if (w <= 1e-9)
+					{
+						// Plane behind the camera
+						mx[x] = -1.0f;
+						my[x] = -1.0f;
+						continue;
+					}
+
+					const double bx = (toBoard(0, 0) * xn + toBoard(0, 1) * yn + toBoard(0, 2)) / w;
+					const double by = (toBoard(1, 0) * xn + toBoard(1, 1) * yn + toBoard(1, 2)) / w;
+					mx[x] = (float)(((bx - _printedOrigin.x) * ppm - 0.5) * levelScale);
+					my[x] = (float)(((_printedOrigin.y - by) * ppm - 0.5) * levelScale);
+				}
+			}
+
+			cv::Mat image;
+			cv::remap(
+				printed,
+				image,
+				mapX,
+				mapY,
+				cv::INTER_LINEAR,
+				cv::BORDER_CONSTANT,
+				cv::Scalar(_settings.backgroundLevel));
+
+			// Lighting
+			cv::Mat lit;
+			image.convertTo(lit, CV_32F, _settings.gain, _settings.offset);
+			if (_settings.lightingGradient != 0.0)
+			{
+				cv::Mat gradient(1, size.width, CV_32F);
+				for (int x = 0; x < size.width; x++)
+				{
+					gradient.at<float>(0, x) = (float)(_settings.lightingGradient * 255.0 * ((x + 0.5) / size.width - 0.5));
+				}
+				lit += cv::repeat(gradient, size.height, 1);
+			}
+
+			// Projected marker corners, for occluder placement and
+			// marker visibility
+			std::vector<cv::Point3f> corners;
+			for (const auto& markerCorners : _board->objPoints)
+			{
+				corners.insert(corners.end(), markerCorners.begin(), markerCorners.end());
+			}
+			std::vector<cv::Point2f> projected;
+			cv::projectPoints(
+				corners,
+				pose.rVec,
+				pose.tVec,
+				_camera.cameraMatrix,
+				_camera.distortionCoefficients,
+				projected);
+
+			const cv::Rect imageRect(cv::Point(), size);
+			for (size_t i = 0; i < _board->ids.size(); i++)
+			{
+				bool isVisible = true;
+				for (size_t c = 0; c < 4; c++)
+				{
+					const cv::Point3f& corner = corners[4 * i + c];
+					const cv::Vec3d inCamera = r * cv::Vec3d(corner.x, corner.y, corner.z) + pose.tVec;
+					isVisible = isVisible && inCamera[2] > 0.0 && imageRect.contains(projected[4 * i + c]);
+				}
+				if (isVisible)
+				{
+					frame.visibleMarkerIds.push_back(_board->ids[i]);
+				}
+			}
+
+			// Effects of the frame from its own generator, independent of
+			// the order frames are rendered in
+			cv::RNG rng(_settings.seed ^ ((uint64_t)frameIndex * 0x9E3779B97F4A7C15ull));
+
+			const cv::Rect boardRect = cv::boundingRect(projected) & imageRect;
+			for (int i = 0; i < _settings.numOccluders && boardRect.area() > 0; i++)
+			{
+				const int w = (std::max)(1, (int)(rng.uniform(0.1, 1.0) * _settings.maxOccluderSize * boardRect.width));
+				const int h = (std::max)(1, (int)(rng.uniform(0.1, 1.0) * _settings.maxOccluderSize * boardRect.height));
+				const cv::Rect occluder(
+					boardRect.x + rng.uniform(0, (std::max)(1, boardRect.width - w)),
+					boardRect.y + rng.uniform(0, (std::max)(1, boardRect.height - h)),
+					w,
+					h);
+				lit(occluder & imageRect).setTo(cv::Scalar(rng.uniform(0.0, 255.0)));
+			}
+
+			if (_settings.blurSigma > 0.0)
+			{
+				cv::GaussianBlur(lit, lit, cv::Size(), _settings.blurSigma);
+			}
+
+			if (_settings.noiseSigma > 0.0)
+			{
+				cv::Mat noise(size, CV_32F);
+				rng.fill(noise, cv::RNG::NORMAL, 0.0, _settings.noiseSigma);
+				lit += noise;
+			}
+
+			lit.convertTo(frame.image, CV_8U);
+		}
+
+		void SyntheticFrameGenerator::Generate(
+			const std::vector<SyntheticPose>& poses,
+			const std::function<void(const std::vector<SyntheticFrame>&)>& onFrames,
+			int64_t firstFrameIndex,
+			int blockSize) const
+		{
+			blockSize = (std::max)(blockSize, 1);
+			std::vector<SyntheticFrame> block;
+
+			for (size_t first = 0; first < poses.size(); first += blockSize)
+			{
+				const size_t last = (std::min)(first + (size_t)blockSize, poses.size());
+				block.resize(last - first);
+
+				cv::parallel_for_(cv::Range((int)first, (int)last), [&](const cv::Range& range)
+				{
+					for (int i = range.start; i < range.end; i++)
+					{
+						Render(poses[i], firstFrameIndex + i, block[i - first]);
+					}
+				});
+
+				onFrames(block);
+			}
+		}
+	}
+}
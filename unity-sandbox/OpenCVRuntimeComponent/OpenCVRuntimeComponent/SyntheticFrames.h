@@ -0,0 +1,140 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include <opencv2/core.hpp>
+#include <opencv2/aruco.hpp>
+#include "IntrinsicCalibration.h"
+
+namespace OpenCVRuntimeComponent
+{
+	namespace ArUcoTracking
+	{
+		// Pose of the board frame in the camera frame, as returned by
+		// cv::aruco::estimatePoseBoard
+		struct SyntheticPose
+		{
+			cv::Vec3d rVec;
+			cv::Vec3d tVec;
+		};
+
+		struct SyntheticFrame
+		{
+			int64_t frameIndex = 0;
+			cv::Mat image; // 8 bit gray
+			SyntheticPose pose;
+
+			// Markers with all corners in the image
+			std::vector<int> visibleMarkerIds;
+		};
+
+		struct SyntheticFrameSettings
+		{
+			// Resolution of the printed board, pixels per meter
+			double pixelsPerMeter = 5000.0;
+
+			// Paper around the markers and the gray level outside it
+			double paperMargin = 0.02; // meters
+			int backgroundLevel = 70;
+
+			// Lighting: level = gain * printed level + offset, plus a
+			// horizontal gradient of lightingGradient over the image width
+			double gain = 0.85;
+			double offset = 20.0;
+			double lightingGradient = 0.0;
+
+			// Gaussian blur and additive gaussian noise, gray levels
+			double blurSigma = 0.0;
+			double noiseSigma = 0.0;
+
+			// Random rectangles over the board region, each up to
+			// maxOccluderSize of the board region extent
+			int numOccluders = 0;
+			double maxOccluderSize = 0.3;
+
+			// Seed of the per-frame random effects, the effects of a frame
+			// depend on the seed and the frame index only
+			uint64_t seed = 0;
+		};
+
+		// Range of the sampled poses
+		struct SyntheticPoseRange
+		{
+			double minDistance = 0.3; // meters
+			double maxDistance = 0.8;
+			double maxTilt = 50.0;     // degrees, out of plane
+			double maxRoll = 180.0;    // degrees, in plane
+			double maxOffset = 0.3;    // board center offset, fraction of the view
+
+			// Smooth motion between consecutive poses (for tracking)
+			// instead of independent poses
+			bool isTrajectory = false;
+		};
+
+		// Poses with the board center in front of the camera and within
+		// view
+		std::vector<SyntheticPose> SampleSyntheticPoses(
+			const CameraIntrinsics& camera,
+			const cv::Ptr<cv::aruco::Board>& board,
+			const SyntheticPoseRange& range,
+			int count,
+			uint64_t seed);
+
+		// Board of a single marker of the dictionary, corners around the
+		// marker center as used by cv::aruco::estimatePoseSingleMarkers
+		cv::Ptr<cv::aruco::Board> CreateSingleMarkerBoard(
+			const cv::Ptr<cv::aruco::Dictionary>& dictionary,
+			int markerId,
+			float markerLength);
+
+		// Renders a printed planar board through the pinhole and
+		// distortion model of the camera. Each image pixel is undistorted
+		// once, a frame then maps the undistorted grid to the board plane
+		// with the homography of its pose and samples the printed board,
+		// so the markers are drawn exactly where the camera model puts
+		// them. Rendering is const and frames are rendered in parallel.
+		class SyntheticFrameGenerator
+		{
+		public:
+			// Markers of the board are axis aligned squares in the board
+			// plane (z = 0) with corner 0 at the top left
+			SyntheticFrameGenerator(
+				const CameraIntrinsics& camera,
+				const cv::Ptr<cv::aruco::Board>& board,
+				const SyntheticFrameSettings& settings);
+
+			void Render(
+				const SyntheticPose& pose,
+				int64_t frameIndex,
+				SyntheticFrame& frame) const;
+
+			// Render the frames of the poses in parallel, frames are
+			// passed to the callback in frame order in blocks of
+			// blockSize. Frame i has index firstFrameIndex + i.
+			void Generate(
+				const std::vector<SyntheticPose>& poses,
+				const std::function<void(const std::vector<SyntheticFrame>&)>& onFrames,
+				int64_t firstFrameIndex = 0,
+				int blockSize = 64) const;
+
+			const CameraIntrinsics& Camera() const { return _camera; }
+			const cv::Ptr<cv::aruco::Board>& Board() const { return _board; }
+
+		private:
+			CameraIntrinsics _camera;
+			cv::Ptr<cv::aruco::Board> _board;
+			SyntheticFrameSettings _settings;
+
+			// Undistorted normalized coordinates of each pixel
+			cv::Mat _normalizedGrid;
+
+			// Pyramid of the printed board, level 0 at pixelsPerMeter, and
+			// the board coordinates of the top left corner of the print
+			std::vector<cv::Mat> _printedLevels;
+			cv::Point2d _printedOrigin;
+
+			void PrintBoard();
+		};
+	}
+}
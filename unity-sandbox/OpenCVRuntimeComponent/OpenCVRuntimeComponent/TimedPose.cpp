@@ -0,0 +1,17 @@
+#include "pch.h"
+#include "TimedPose.h"
+
+using namespace OpenCVRuntimeComponent;
+
+ArUcoTracking::TimedPose::TimedPose(
+	Windows::Foundation::TimeSpan timestamp,
+	float3 position,
+	quaternion orientation,
+	bool isValid)
+{
+	// Set the capture time and the (interpolated) pose at that time
+	Timestamp = timestamp;
+	Position = position;
+	Orientation = orientation;
+	IsValid = isValid;
+}
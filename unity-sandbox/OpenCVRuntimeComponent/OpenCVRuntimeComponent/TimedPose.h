@@ -0,0 +1,25 @@
+#pragma once
+
+using namespace Windows::Foundation::Collections;
+using namespace Windows::Foundation::Numerics;
+
+namespace OpenCVRuntimeComponent
+{
+	namespace ArUcoTracking
+	{
+		public ref class TimedPose sealed
+		{
+		public:
+			TimedPose(
+				_In_ Windows::Foundation::TimeSpan timestamp,
+				_In_ float3 position,
+				_In_ quaternion orientation,
+				_In_ bool isValid);
+
+			property Windows::Foundation::TimeSpan Timestamp;
+			property float3 Position;
+			property quaternion Orientation;
+			property bool IsValid;
+		};
+	}
+}
@@ -21,10 +21,17 @@
 // Eigen
 #include <Eigen/Eigen>
 
+#include "FrameLease.h"
+#include "PoseQualityMetrics.h"
 #include "DetectedArUcoBoard.h"
 #include "DetectedArUcoMarker.h"
+#include "FusedArUcoPose.h"
+#include "TimedPose.h"
 #include "ArUcoMarkerTracker.h"
 #include "CvUtils.h"
 #include "Trace.h"
 #include "BufferHelpers.h"
-#include "CameraCalibrationParams.h"
\ No newline at end of file
+#include "CameraCalibrationParams.h"
+#include "CalibrationProfile.h"
+#include "CalibrationProfileStore.h"
+#include "ProjectionCalibration.h"
\ No newline at end of file